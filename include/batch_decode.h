@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "can_frame.h"
+#include "mux_layout.h"
+
+namespace dbcppp {
+    class ISignal;
+}
+
+// Décodage par blocs des messages à haut débit : les trames d'un même CAN ID
+// sont accumulées puis chaque signal est extrait sur tout le bloc par un
+// noyau vectoriel (NEON, AVX2 ou SSE2, sinon scalaire), choisi à la
+// construction du plan selon l'ordre des octets et le signe du signal.
+// Le résultat est identique bit à bit au décodage trame par trame
+// (ISignal::Decode puis RawToPhys) : chaque noyau est comparé à dbcppp sur
+// des charges de sonde à la construction du plan, un signal qui diffère
+// reste décodé par dbcppp.
+
+constexpr size_t BATCH_MAX_FRAMES = 64;
+
+class BatchDecodePlan {
+public:
+    // Extraction of the raw value of one signal from count payload words
+    using ExtractFn = void (*)(const uint64_t* words, size_t count, uint32_t shift,
+                               uint64_t mask, uint64_t sign, uint64_t* raw);
+    // Raw to physical value, same arithmetic as dbcppp RawToPhys
+    using ScaleFn = void (*)(const uint64_t* raw, size_t count, double factor, double offset, double* values);
+
+private:
+    struct Kernel {
+        const dbcppp::ISignal* signal = nullptr;
+        bool big_endian = false;
+        uint32_t shift = 0;
+        uint64_t mask = 0;
+        uint64_t sign = 0;            // bit de signe après masquage, 0 si non signé
+        double factor = 1.0;
+        double offset = 0.0;
+        ExtractFn extract = nullptr;  // nullptr : ISignal::Decode trame par trame
+        ScaleFn scale = nullptr;      // nullptr : ISignal::RawToPhys valeur par valeur
+    };
+
+    std::vector<Kernel> kernels_;
+    std::vector<BlockSignal> signals_;
+    bool needs_swap_ = false;         // un noyau lit les octets dans l'ordre inverse de l'hôte
+    size_t vector_signals_ = 0;
+
+    static bool compile_kernel(const dbcppp::ISignal& signal, Kernel& kernel);
+    static bool verify_kernel(Kernel& kernel);
+    void decode_signal(const Kernel& kernel, const uint64_t* words, const uint64_t* swapped,
+                       size_t count, uint64_t* raw, double* values) const;
+
+public:
+    // Plan of a non-multiplexed layout; indexes are the DecodedSignal::signal_index
+    // of its signals. False when the layout has no signal.
+    bool build(const MuxLayout& layout, const std::vector<uint32_t>& indexes);
+
+    const std::vector<BlockSignal>& signals() const { return signals_; }
+    // Signals decoded by a block kernel (the others go through dbcppp)
+    size_t vector_signals() const { return vector_signals_; }
+
+    // Decodes count (<= BATCH_MAX_FRAMES) payloads, each the 8 data bytes of
+    // a frame copied into a word. values is signal-major with a stride of
+    // BATCH_MAX_FRAMES: values[s * BATCH_MAX_FRAMES + frame].
+    void decode(const uint64_t* words, size_t count, double* values) const;
+
+    // Instruction set of the extraction kernels of this build
+    static const char* kernel_isa();
+};
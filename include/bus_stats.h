@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <linux/can.h>
+#include "can_frame.h"
+
+namespace dbcppp {
+    class INetwork;
+}
+
+// Statistiques du bus calculées par le reader sur toutes les trames reçues
+// (trames de données et trames d'erreur du contrôleur, CAN_RAW_ERR_FILTER).
+// Publiées à intervalle fixe et enregistrées dans deux channel groups MF4
+// hors DBC, sous des pseudo CAN IDs qui ne peuvent pas appartenir à un DBC
+// (bit CAN_ERR_FLAG).
+
+constexpr uint32_t BUS_STATS_CAN_ID = CAN_ERR_FLAG | 0x1;   // charge, erreurs, état
+constexpr uint32_t BUS_RATES_CAN_ID = CAN_ERR_FLAG | 0x2;   // trames/s par CAN ID du DBC
+// Pseudo-trame poussée par le reader dans la file brute à chaque publication :
+// le décodeur l'écrit à sa place dans le flux
+constexpr uint32_t BUS_STATS_FRAME_ID = CAN_ERR_FLAG | 0xFF;
+
+// Canaux du groupe BusStatistics, dans l'ordre de BusStatsSnapshot::values
+enum BusStatsChannel : size_t {
+    BUS_LOAD,
+    BUS_LOAD_PEAK,
+    BUS_FRAMES_PER_SECOND,
+    BUS_ERROR_FRAMES,
+    BUS_ERR_TX_TIMEOUT,
+    BUS_ERR_LOST_ARBITRATION,
+    BUS_ERR_CONTROLLER,
+    BUS_ERR_PROTOCOL,
+    BUS_ERR_TRANSCEIVER,
+    BUS_ERR_NO_ACK,
+    BUS_ERR_BUS_OFF,
+    BUS_ERR_BUS_ERROR,
+    BUS_ERR_RESTARTED,
+    BUS_STATE,
+    BUS_ERROR_PASSIVE_TRANSITIONS,
+    BUS_OFF_TRANSITIONS,
+    BUS_TX_ERROR_COUNTER,
+    BUS_RX_ERROR_COUNTER,
+    BUS_SOCKET_DROPS,
+    BUS_STATS_CHANNEL_COUNT
+};
+
+struct BusStatsChannelInfo {
+    const char* name;
+    const char* unit;
+};
+
+extern const BusStatsChannelInfo BUS_STATS_CHANNELS[BUS_STATS_CHANNEL_COUNT];
+
+// État du contrôleur déduit des trames d'erreur (valeur du canal bus_state)
+enum class BusState : uint8_t {
+    ErrorActive = 0,
+    ErrorWarning = 1,
+    ErrorPassive = 2,
+    BusOff = 3
+};
+
+struct BusStatsSnapshot {
+    std::chrono::steady_clock::time_point timestamp;
+    std::array<double, BUS_STATS_CHANNEL_COUNT> values{};
+    std::unordered_map<uint32_t, double> id_rates;   // trames/s sur l'intervalle
+};
+
+class BusStatistics {
+public:
+    static constexpr auto PUBLISH_INTERVAL = std::chrono::seconds(1);
+
+private:
+    // Fenêtre glissante de charge d'une seconde, en tranches de 100 ms (la
+    // charge de pointe est celle de la tranche la plus chargée de l'intervalle)
+    static constexpr size_t LOAD_SLOTS = 10;
+    static constexpr auto SLOT_DURATION = std::chrono::milliseconds(100);
+
+    std::string interface_name_;
+    uint32_t bitrate_;
+
+    // Thread reader uniquement
+    std::array<uint64_t, LOAD_SLOTS> slot_bits_{};
+    uint64_t current_slot_ = 0;
+    bool started_ = false;
+    std::chrono::steady_clock::time_point origin_;
+    std::chrono::steady_clock::time_point interval_start_;
+    uint64_t peak_slot_bits_ = 0;
+    uint64_t interval_frames_ = 0;
+    std::array<uint64_t, 9> interval_error_classes_{};
+    uint64_t interval_error_frames_ = 0;
+    std::unordered_map<uint32_t, uint32_t> interval_id_frames_;
+    BusState state_ = BusState::ErrorActive;
+    uint64_t error_passive_transitions_ = 0;
+    uint64_t bus_off_transitions_ = 0;
+    int tx_error_counter_ = -1;   // -1 : jamais rapporté par le pilote
+    int rx_error_counter_ = -1;
+    uint64_t socket_drops_ = 0;
+
+    // Dernière publication, lue par le thread décodeur
+    mutable std::mutex mutex_;
+    BusStatsSnapshot published_;
+    bool has_published_ = false;
+
+    void advance(std::chrono::steady_clock::time_point now);
+    void set_state(BusState state);
+
+public:
+    BusStatistics(const std::string& interface_name, uint32_t bitrate);
+
+    const std::string& interface_name() const { return interface_name_; }
+    uint32_t bitrate() const { return bitrate_; }
+
+    // Reader thread
+    void on_frame(const struct can_frame& frame, std::chrono::steady_clock::time_point timestamp);
+    void on_error_frame(const struct can_frame& frame, std::chrono::steady_clock::time_point timestamp);
+    // Cumulative count of frames dropped by the kernel socket queue (SO_RXQ_OVFL)
+    void set_socket_drops(uint32_t drops) { socket_drops_ = drops; }
+    // Closes the interval and makes its snapshot available to take_snapshot()
+    void publish(std::chrono::steady_clock::time_point now);
+
+    // Decoder thread: latest published snapshot, false before the first one
+    bool take_snapshot(BusStatsSnapshot& snapshot) const;
+
+    // Group names of the MF4 file, per interface
+    std::string stats_group_name() const { return "BusStatistics_" + interface_name_; }
+    std::string rates_group_name() const { return "BusFrameRates_" + interface_name_; }
+
+    // Bits on the wire of a classic CAN frame, stuff bits computed from the
+    // actual bit stream (ID, DLC, data and CRC), interframe space included
+    static uint32_t frame_bits(const struct can_frame& frame);
+
+    // Messages written to the outputs for a snapshot: the statistics group and
+    // the frame rate of each DBC CAN ID in rate_ids (other IDs summed in fps_other)
+    static void to_messages(const BusStatsSnapshot& snapshot, const std::vector<uint32_t>& rate_ids,
+                            CanMessage& stats, CanMessage& rates);
+};
+
+// CAN IDs of every message of the DBC (rates group channels), sorted
+std::vector<uint32_t> bus_rate_ids(const dbcppp::INetwork& network);
+// Channel name of the frame rate of a CAN ID in the rates group
+std::string bus_rate_channel_name(uint32_t can_id);
+constexpr const char* BUS_RATE_OTHER_CHANNEL = "fps_other";
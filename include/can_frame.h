@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <chrono>
 #include <string>
+#include <vector>
 #include <linux/can.h>
 
 struct CanFrame {
@@ -29,6 +30,7 @@ struct DecodedSignal {
     double value;
     std::string unit;
     std::chrono::steady_clock::time_point timestamp;
+    uint32_t signal_index = UINT32_MAX;  // index stable du signal dans le DBC chargé
     
     DecodedSignal() = default;
     
@@ -36,3 +38,54 @@ struct DecodedSignal {
                  const std::string& u, std::chrono::steady_clock::time_point ts)
         : can_id(id), signal_name(name), value(val), unit(u), timestamp(ts) {}
 };
+
+// Structure pour regrouper les signaux par message CAN
+struct CanMessage {
+    uint32_t can_id;
+    uint32_t layout_id = 0;  // layout de multiplexage (0 si non multiplexé)
+    std::chrono::steady_clock::time_point timestamp;
+    std::vector<DecodedSignal> signals;
+};
+
+// Instant remarquable du flux (message cyclique manquant, rétabli, ...),
+// écrit en bloc d'événement EV par le MF4
+struct StreamEvent {
+    std::string name;
+    std::string description;
+    std::chrono::steady_clock::time_point timestamp;
+};
+
+// Signal d'un bloc de trames décodées ensemble
+struct BlockSignal {
+    std::string name;
+    std::string unit;
+    uint32_t signal_index = UINT32_MAX;
+};
+
+// Trames d'un même CAN ID décodées en un bloc : une colonne de valeurs
+// contiguës par signal, values[signal * stride + trame]
+struct MessageBlock {
+    uint32_t can_id = 0;
+    uint32_t layout_id = 0;
+    size_t frame_count = 0;
+    size_t stride = 0;
+    const std::vector<BlockSignal>* signals = nullptr;
+    const std::chrono::steady_clock::time_point* timestamps = nullptr;
+    const double* values = nullptr;
+
+    const double* column(size_t signal) const { return values + signal * stride; }
+
+    // Message of one frame of the block, for consumers without a block path
+    void to_message(size_t frame, CanMessage& message) const {
+        message.can_id = can_id;
+        message.layout_id = layout_id;
+        message.timestamp = timestamps[frame];
+        message.signals.clear();
+        message.signals.reserve(signals->size());
+        for (size_t s = 0; s < signals->size(); ++s) {
+            const BlockSignal& signal = (*signals)[s];
+            message.signals.emplace_back(can_id, signal.name, column(s)[frame], signal.unit, timestamps[frame]);
+            message.signals.back().signal_index = signal.signal_index;
+        }
+    }
+};
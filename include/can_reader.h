@@ -4,16 +4,40 @@
 #include <atomic>
 #include <thread>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include "thread_safe_queue.h"
 #include "can_frame.h"
+#include "thread_tuning.h"
+
+class BusStatistics;
 
 class CanReader {
 private:
     std::string interface_name_;
     int socket_fd_;
+    int epoll_fd_ = -1;
+    int stop_fd_ = -1;     // eventfd signalé par stop()
+    int timer_fd_ = -1;    // publication des statistiques du bus
     std::atomic<bool> running_;
     std::shared_ptr<ThreadSafeQueue<CanFrame>> output_queue_;
     std::unique_ptr<std::thread> reader_thread_;
+    std::vector<uint32_t> id_filter_;
+    // id_filter_ et l'ouverture / fermeture de socket_fd_, partagés avec
+    // update_id_filter() appelé par le thread du décodeur
+    std::mutex filter_mutex_;
+    ThreadTuning thread_tuning_;
+    BusStatistics* bus_stats_ = nullptr;
+    size_t max_queued_ = 0;              // 0 : file brute non bornée
+    bool queue_full_ = false;            // évalué une fois par lot de lecture
+    std::atomic<uint64_t> queue_drops_{0};
+
+    bool apply_id_filter();
+    // read(), or recvmsg() with the socket drop counter when statistics are on
+    ssize_t receive_frame(struct can_frame& frame);
+    // Counts and forwards one received frame; error frames are never queued
+    void handle_frame(const struct can_frame& frame);
+    void publish_bus_statistics();
 
     bool open_can_socket();
     void close_can_socket();
@@ -27,6 +51,27 @@ public:
     CanReader(const CanReader&) = delete;
     CanReader& operator=(const CanReader&) = delete;
 
+    // Kernel-side acceptance filter (CAN_RAW_FILTER), empty = all IDs. Must be called before start().
+    void set_id_filter(std::vector<uint32_t> can_ids) {
+        std::lock_guard<std::mutex> lock(filter_mutex_);
+        id_filter_ = std::move(can_ids);
+    }
+    // Replaces the filter on the open socket (DBC reload), from any thread;
+    // serialized with the opening and closing of the socket
+    void update_id_filter(std::vector<uint32_t> can_ids);
+
+    void set_thread_tuning(const ThreadTuning& tuning) { thread_tuning_ = tuning; }
+
+    // Receives error frames and computes bus statistics in the reader thread,
+    // published every BusStatistics::PUBLISH_INTERVAL through a marker frame
+    // in the queue. Must be called before start().
+    void set_bus_statistics(BusStatistics* stats) { bus_stats_ = stats; }
+    // Frames are dropped (and counted) while the queue holds max_frames or
+    // more, e.g. while the decoder opens an event file. Must be called before start().
+    void set_max_queued(size_t max_frames) { max_queued_ = max_frames; }
+    // Frames dropped because the queue was full
+    uint64_t queue_drops() const { return queue_drops_.load(); }
+
     bool start(std::shared_ptr<ThreadSafeQueue<CanFrame>> queue);
     void stop();
     bool is_running() const { return running_.load(); }
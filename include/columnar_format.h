@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+
+// Format colonnes .cck : lisible par mmap sans mdflib. Little-endian, toutes
+// les structures et tous les tableaux sont alignés sur 8 octets.
+//
+//   ColumnarFileHeader
+//   chunk*    : ColumnarChunkHeader, ColumnarChunkColumn[column_count], puis
+//               pour chaque colonne : int64 timestamps_ns[count], double values[count]
+//   index     : ColumnarFooterHeader, ColumnarColumnEntry[column_count],
+//               ColumnarSegmentEntry[segment_count]
+//   ColumnarTrailer (32 derniers octets du fichier)
+//
+// Lecture : le trailer donne l'index ; chaque colonne (un signal) pointe sur
+// ses segments contigus, triés dans le temps (recherche dichotomique sur
+// first_ns). Horodatages en ns depuis l'epoch Unix. Un fichier non finalisé
+// (footer_offset == 0 dans l'en-tête, pas de trailer) reste parcourable
+// chunk par chunk, sans les noms de signaux.
+
+namespace columnar {
+
+constexpr char FILE_MAGIC[8] = {'C', 'A', 'N', 'C', 'O', 'L', '1', '\0'};
+constexpr char CHUNK_MAGIC[4] = {'C', 'H', 'N', 'K'};
+constexpr char FOOTER_MAGIC[8] = {'C', 'C', 'K', 'I', 'N', 'D', 'E', 'X'};
+constexpr char TRAILER_MAGIC[8] = {'C', 'C', 'K', 'E', 'N', 'D', '1', '\0'};
+constexpr uint32_t FORMAT_VERSION = 1;
+constexpr size_t NAME_SIZE = 96;
+constexpr size_t UNIT_SIZE = 24;
+constexpr const char* FILE_EXTENSION = ".cck";
+
+}  // namespace columnar
+
+struct ColumnarFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int64_t created_ns;
+    uint64_t footer_offset;   // 0 tant que le fichier n'est pas finalisé
+    uint8_t reserved[32];
+};
+
+struct ColumnarChunkHeader {
+    char magic[4];
+    uint32_t column_count;
+    uint64_t payload_bytes;   // colonnes et tableaux qui suivent
+};
+
+struct ColumnarChunkColumn {
+    uint32_t column;          // index dans ColumnarColumnEntry
+    uint32_t reserved;
+    uint64_t count;
+};
+
+struct ColumnarFooterHeader {
+    char magic[8];
+    uint32_t column_count;
+    uint32_t reserved;
+    uint64_t segment_count;
+};
+
+struct ColumnarColumnEntry {
+    uint32_t can_id;
+    uint32_t first_segment;
+    uint32_t segment_count;
+    uint32_t reserved;
+    uint64_t sample_count;
+    char name[columnar::NAME_SIZE];
+    char unit[columnar::UNIT_SIZE];
+};
+
+struct ColumnarSegmentEntry {
+    uint64_t timestamps_offset;
+    uint64_t values_offset;
+    uint64_t count;
+    int64_t first_ns;
+    int64_t last_ns;
+};
+
+struct ColumnarTrailer {
+    uint64_t footer_offset;
+    uint64_t footer_size;
+    uint64_t reserved;
+    char magic[8];
+};
+
+static_assert(sizeof(ColumnarFileHeader) == 64, "ColumnarFileHeader layout");
+static_assert(sizeof(ColumnarChunkHeader) == 16, "ColumnarChunkHeader layout");
+static_assert(sizeof(ColumnarChunkColumn) == 16, "ColumnarChunkColumn layout");
+static_assert(sizeof(ColumnarFooterHeader) == 24, "ColumnarFooterHeader layout");
+static_assert(sizeof(ColumnarColumnEntry) == 144, "ColumnarColumnEntry layout");
+static_assert(sizeof(ColumnarSegmentEntry) == 40, "ColumnarSegmentEntry layout");
+static_assert(sizeof(ColumnarTrailer) == 32, "ColumnarTrailer layout");
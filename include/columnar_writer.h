@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
+#include "output_sink.h"
+#include "storage_file.h"
+#include "columnar_format.h"
+
+class RetentionManager;
+
+// Sink colonnes (columnar_format.h) : les échantillons de chaque signal sont
+// accumulés en mémoire puis écrits par chunks, valeurs et horodatages contigus.
+// Même rotation, même stockage flash et même nommage que le MF4 (.cck).
+class ColumnarWriter : public OutputSink {
+private:
+    struct Column {
+        std::string name;
+        std::string unit;
+        uint32_t can_id = 0;
+        uint32_t column = 0;                 // position dans l'index du fichier
+        bool in_file = false;
+        std::vector<int64_t> timestamps;     // chunk en cours
+        std::vector<double> values;
+        std::vector<ColumnarSegmentEntry> segments;
+        uint64_t sample_count = 0;
+    };
+
+    static constexpr size_t CHUNK_BYTES = 256 * 1024;        // échantillons en attente avant écriture
+    static constexpr size_t PREALLOCATION_SLACK = 1024 * 1024;
+
+    std::string output_directory_;
+    std::string file_prefix_ = "can_data_";
+    StoragePolicy storage_policy_;
+    StorageFile storage_;
+    RetentionManager* retention_ = nullptr;
+
+    int fd_ = -1;
+    std::string current_file_path_;
+    uint64_t file_offset_ = 0;
+    size_t buffered_bytes_ = 0;
+    int64_t epoch_offset_ns_ = 0;            // steady_clock -> epoch Unix
+    std::vector<Column> columns_;            // indexé par DecodedSignal::signal_index
+    std::vector<uint32_t> file_columns_;     // signal_index des colonnes du fichier courant
+    // Rotation calée sur celle du MF4 : demandée par le writer MF4, appliquée
+    // avant le message suivant (le même que le premier du nouveau fichier MF4)
+    bool follow_rotation_ = false;
+    std::atomic<bool> rotation_requested_{false};
+
+    bool create_new_file();
+    void close_current_file();
+    std::string generate_filename() const;
+    bool write_all(const void* data, size_t size);
+    bool flush_chunk();
+    bool write_footer();
+
+public:
+    explicit ColumnarWriter(const std::string& output_dir);
+    ~ColumnarWriter() override;
+
+    // Non-copyable
+    ColumnarWriter(const ColumnarWriter&) = delete;
+    ColumnarWriter& operator=(const ColumnarWriter&) = delete;
+
+    // Must be called before start()
+    void set_storage_policy(const StoragePolicy& policy) { storage_policy_ = policy; }
+    void set_retention_manager(RetentionManager* retention) { retention_ = retention; }
+    void set_file_prefix(const std::string& prefix) { file_prefix_ = prefix; }
+    // Rotates when request_rotation() is called (MF4 rotation listener) instead
+    // of on its own size, so each .cck file covers the same window as its MF4
+    // file. The size only forces a rotation past the preallocated space.
+    void follow_rotation(bool follow) { follow_rotation_ = follow; }
+    // Any thread; the file rotates before the next message
+    void request_rotation() { rotation_requested_.store(true); }
+
+    const char* name() const override { return "columnar"; }
+    bool start() override;
+    void stop() override;
+    void write_can_message(const CanMessage& message) override;
+    bool is_running() const override { return fd_ >= 0; }
+    // Signal indexes change with the DBC: rotates to a new file
+    void dbc_changed(const std::shared_ptr<const dbcppp::INetwork>& network) override;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <linux/can.h>
+#include "can_frame.h"
+
+namespace dbcppp {
+    class INetwork;
+    class IMessage;
+}
+
+// Surveillance des temps de cycle : le décodeur mesure l'intervalle entre
+// deux trames de chaque message ayant un GenMsgCycleTime dans le DBC, avant
+// décimation. Un message sans trame depuis K cycles est déclaré manquant
+// (événement MF4 et journal), puis rétabli à sa trame suivante. Les
+// statistiques sont enregistrées à intervalle fixe dans un channel group
+// hors DBC, sous un pseudo CAN ID (bit CAN_ERR_FLAG, voir bus_stats.h).
+
+constexpr uint32_t CYCLE_STATS_CAN_ID = CAN_ERR_FLAG | 0x3;
+constexpr const char* CYCLE_STATS_GROUP_NAME = "CycleTimes";
+
+// GenMsgCycleTime du message, ou valeur par défaut de l'attribut ; 0 si absent
+double dbc_cycle_time_ms(const dbcppp::INetwork& network, const dbcppp::IMessage& message);
+
+struct CycleEntry {
+    uint32_t can_id = 0;
+    std::string name;
+    double cycle_ms = 0.0;
+};
+
+// Channels of a message in the CycleTimes group, in CycleMonitor output order
+struct CycleChannel {
+    const char* suffix;
+    const char* unit;
+    const char* description;
+};
+constexpr size_t CYCLE_CHANNELS_PER_MESSAGE = 4;
+extern const CycleChannel CYCLE_CHANNELS[CYCLE_CHANNELS_PER_MESSAGE];
+inline std::string cycle_channel_name(const std::string& message_name, const CycleChannel& channel) {
+    return message_name + "_" + channel.suffix;
+}
+
+class CycleMonitor {
+public:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    static constexpr auto CHECK_INTERVAL = std::chrono::milliseconds(100);
+    static constexpr auto PUBLISH_INTERVAL = std::chrono::seconds(1);
+
+private:
+    // Un état par message surveillé, indexé par CompiledMessage::cycle_slot
+    struct State {
+        std::chrono::steady_clock::time_point last;
+        std::chrono::nanoseconds timeout{0};
+        bool seen = false;       // au moins une trame : intervalle mesurable
+        bool missing = false;
+        bool recovered = false;  // rétabli depuis le dernier contrôle
+        std::chrono::steady_clock::time_point recovered_at;
+        std::chrono::nanoseconds recovered_gap{0};
+        // Intervalle de publication en cours
+        uint64_t count = 0;
+        double sum_ms = 0.0;
+        double sum_sq_ms = 0.0;
+        double max_ms = 0.0;
+        uint64_t timeouts = 0;   // cumulé
+    };
+
+    double timeout_cycles_;
+    std::vector<CycleEntry> entries_;
+    std::vector<State> states_;
+    std::chrono::steady_clock::time_point next_check_;
+    std::chrono::steady_clock::time_point next_publish_;
+    uint64_t total_timeouts_ = 0;
+
+public:
+    explicit CycleMonitor(double timeout_cycles);
+
+    double timeout_cycles() const { return timeout_cycles_; }
+    uint64_t total_timeouts() const { return total_timeouts_; }
+    size_t size() const { return entries_.size(); }
+
+    // Monitored messages of a (re)loaded DBC, slot i = entries[i]. A message
+    // kept with the same cycle time keeps its state across a reload.
+    void configure(const std::vector<CycleEntry>& entries, std::chrono::steady_clock::time_point now);
+
+    // Hot path: one frame of the message in slot
+    void on_frame(uint32_t slot, std::chrono::steady_clock::time_point timestamp) {
+        State& state = states_[slot];
+        if (state.seen) {
+            const double interval_ms = std::chrono::duration<double, std::milli>(timestamp - state.last).count();
+            ++state.count;
+            state.sum_ms += interval_ms;
+            state.sum_sq_ms += interval_ms * interval_ms;
+            state.max_ms = interval_ms > state.max_ms ? interval_ms : state.max_ms;
+        }
+        if (state.missing) {
+            state.missing = false;
+            state.recovered = true;
+            state.recovered_at = timestamp;
+            state.recovered_gap = timestamp - state.last;
+        }
+        state.last = timestamp;
+        state.seen = true;
+    }
+
+    // Next time poll() has something to do
+    std::chrono::steady_clock::time_point next_poll() const { return std::min(next_check_, next_publish_); }
+
+    // Timeout and recovery detection (every CHECK_INTERVAL), events appended in
+    // time order; true when the statistics of the interval were written to stats
+    bool poll(std::chrono::steady_clock::time_point now, std::vector<StreamEvent>& events, CanMessage& stats);
+};
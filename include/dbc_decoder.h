@@ -5,8 +5,20 @@
 #include <thread>
 #include <memory>
 #include <unordered_map>
+#include <vector>
+#include <functional>
+#include <algorithm>
 #include "thread_safe_queue.h"
 #include "can_frame.h"
+#include "decimation.h"
+#include "mux_layout.h"
+#include "selection_profile.h"
+#include "thread_tuning.h"
+#include "trigger.h"
+#include "signal_table_publisher.h"
+#include "cycle_monitor.h"
+#include "batch_decode.h"
+#include "transport_reader.h"
 
 namespace dbcppp {
     class INetwork;
@@ -14,22 +26,206 @@ namespace dbcppp {
     class ISignal;
 }
 
-class Mf4Writer;
+class OutputSink;
+class StreamServer;
+class BusStatistics;
+
+// Bilan de l'arrêt ordonné du décodeur
+struct DrainStats {
+    uint64_t pending = 0;         // trames en file, en bloc ou à fusionner au début de l'arrêt
+    uint64_t lost = 0;            // abandonnées à l'échéance
+    bool deadline_reached = false;
+
+    uint64_t flushed() const { return pending > lost ? pending - lost : 0; }
+};
 
 class DbcDecoder {
 private:
+    static constexpr uint32_t NO_BATCH_SLOT = UINT32_MAX;
+
+    struct CompiledMessage {
+        const dbcppp::IMessage* message = nullptr;
+        MuxLayoutTable mux;
+        std::vector<std::vector<uint32_t>> signal_indexes;  // [layout.id][position du signal]
+        SignalTablePublisher* signal_table = nullptr;        // celle du même DBC, nullptr si désactivée
+        uint32_t cycle_slot = CycleMonitor::NO_SLOT;         // index dans CompiledDbc::cycle_entries
+        std::unique_ptr<BatchDecodePlan> batch;              // messages non multiplexés, si activé
+        uint32_t batch_slot = NO_BATCH_SLOT;                 // haut débit : décodé par blocs dans le pipeline
+        bool transport = false;                              // reçu réassemblé (transport_reader.h), trames brutes ignorées
+    };
+
+    // DBC chargé et compilé, immuable une fois publié. Un rechargement en
+    // construit un nouveau en arrière-plan ; le thread décodeur l'échange
+    // entre deux trames, l'ancien est libéré quand plus aucune trame en vol
+    // ne le référence (marqueur dans la fusion en mode parallèle).
+    struct CompiledDbc {
+        std::shared_ptr<const dbcppp::INetwork> network;
+        std::unordered_map<uint32_t, CompiledMessage> message_map;
+        std::vector<SignalTablePublisher::Entry> signal_entries;
+        std::unique_ptr<SignalTablePublisher> signal_table;
+        TriggerEngine triggers;    // repris par le thread décodeur à l'échange
+        std::vector<uint32_t> rate_ids;   // CAN IDs du groupe des débits du bus
+        std::vector<CycleEntry> cycle_entries;   // messages cycliques surveillés
+        uint32_t batch_slots = 0;
+        size_t batch_max_signals = 0;
+        std::unordered_map<uint32_t, const CompiledMessage*> transport_map;   // clé : transport_key()
+        uint64_t generation = 0;
+
+        ~CompiledDbc();
+    };
+
+    // État propre à un thread de décodage (un CAN ID n'est décodé que par un seul thread)
+    struct DecodeContext {
+        DecimationFilter decimation;  // moyennes par bloc
+        bool first_frame_logged = false;
+        std::chrono::steady_clock::time_point first_frame_time;
+        bool publish = true;          // faux pour le rejeu pré-déclenchement
+    };
+
+    struct SequencedFrame {
+        uint64_t seq = 0;
+        const CompiledMessage* compiled = nullptr;
+        CanFrame frame;
+    };
+
+    struct DecodeResult {
+        uint64_t seq = 0;
+        bool ready = false;
+        bool has_message = false;
+        CanMessage message;
+        bool has_event = false;
+        StreamEvent event;
+        // Marqueur d'échange de DBC : tout ce qui précède a été décodé avec retired
+        std::shared_ptr<const CompiledDbc> reload;
+        std::shared_ptr<const CompiledDbc> retired;
+    };
+
+    struct DecodeWorker {
+        size_t index = 0;
+        ThreadSafeQueue<SequencedFrame> queue;
+        std::unique_ptr<std::thread> thread;
+        DecodeContext context;
+    };
+
     std::string dbc_file_path_;
     std::atomic<bool> running_;
     std::shared_ptr<ThreadSafeQueue<CanFrame>> input_queue_;
     std::unique_ptr<std::thread> decoder_thread_;
-    Mf4Writer* writer_ = nullptr;
-    
-    std::unique_ptr<dbcppp::INetwork> network_;
-    std::unordered_map<uint32_t, const dbcppp::IMessage*> message_map_;
+    OutputSink* output_ = nullptr;
+
+    std::shared_ptr<const CompiledDbc> dbc_;   // thread décodeur une fois démarré
+    DecimationRules decimation_rules_;
+    DecimationFilter decimation_;  // filtre avant décodage, thread décodeur uniquement
+    std::shared_ptr<const SelectionProfile> selection_;
+
+    // Décodage parallèle : routage par CAN ID puis fusion dans l'ordre d'arrivée
+    size_t worker_count_ = 1;
+    DecodeContext main_context_;
+    std::vector<std::unique_ptr<DecodeWorker>> workers_;
+    ThreadSafeQueue<DecodeResult> results_;
+    std::unique_ptr<std::thread> merger_thread_;
+    uint64_t next_seq_ = 0;
+
+    ThreadTuning decoder_tuning_;
+    ThreadTuning writer_tuning_;
+
+    // Dernières valeurs publiées en mémoire partagée pour les autres processus
+    std::string shared_table_name_;
+    StreamServer* stream_ = nullptr;
+    BusStatistics* bus_stats_ = nullptr;
 
-    bool load_dbc_file();
+    // Temps de cycle, thread décodeur (avant décimation)
+    double cycle_timeout_cycles_ = 0.0;   // 0 : désactivé
+    std::unique_ptr<CycleMonitor> cycle_monitor_;
+    std::vector<StreamEvent> cycle_events_;
+    CanMessage cycle_stats_;
+
+    // Décodage par blocs des messages à haut débit, décodeur mono-thread hors
+    // mode déclenché : une trame attend au plus BATCH_MAX_DELAY dans son bloc
+    static constexpr double BATCH_MAX_CYCLE_MS = 10.0;   // 100 Hz et plus
+    struct PendingBlock {
+        const CompiledMessage* compiled = nullptr;
+        size_t count = 0;
+        bool queued = false;   // présent dans batch_pending_
+        uint64_t words[BATCH_MAX_FRAMES];
+        std::chrono::steady_clock::time_point timestamps[BATCH_MAX_FRAMES];
+    };
+    size_t batch_frames_ = 0;   // 0 : désactivé
+    std::vector<PendingBlock> batch_blocks_;   // indexé par CompiledMessage::batch_slot
+    std::vector<uint32_t> batch_pending_;
+    std::chrono::steady_clock::time_point batch_flush_at_ = std::chrono::steady_clock::time_point::max();
+    std::vector<double> batch_values_;
+    PendingBlock offline_block_;   // decode_block_offline()
+
+    // Charges multi-trames réassemblées par le noyau, thread décodeur
+    TransportProtocol transport_protocol_ = TransportProtocol::None;
+    TransportInbox* transport_inbox_ = nullptr;
+    TransportPayload transport_payload_;
+
+    // Rechargement à chaud : SIGHUP (request_reload) ou modification du fichier
+    static constexpr int RELOAD_SETTLE_MS = 500;  // délai après la dernière écriture du fichier
+    bool watch_dbc_ = false;
+    std::unique_ptr<std::thread> reload_thread_;
+    int reload_event_fd_ = -1;
+    std::atomic<bool> reload_stop_{false};
+    std::shared_ptr<CompiledDbc> pending_dbc_;    // std::atomic_load / atomic_exchange
+    std::atomic<bool> reload_pending_{false};
+    uint64_t generation_ = 0;                     // thread de rechargement
+    std::function<void(const std::vector<uint32_t>&)> can_ids_listener_;
+
+    // Enregistrement sur événement : output_ n'est ouvert que pendant une fenêtre
+    TriggerSettings trigger_settings_;
+    TriggerEngine triggers_;
+    FrameRing pre_trigger_ring_;
+    bool event_active_ = false;
+    std::chrono::steady_clock::time_point event_end_;
+    uint64_t event_count_ = 0;
+    bool ring_short_logged_ = false;
+
+    // Arrêt ordonné : au-delà de l'échéance, les files sont vidées sans décoder
+    std::chrono::steady_clock::time_point drain_deadline_;
+    std::atomic<bool> draining_{false};
+    std::atomic<uint64_t> drain_lost_{0};
+    // Trames hors des files, comptées dans DrainStats::pending : en attente
+    // dans un bloc (thread décodeur) et décodées dans la fenêtre de la fusion
+    std::atomic<uint64_t> batch_queued_frames_{0};
+    std::atomic<uint64_t> merger_ready_{0};
+
+    std::shared_ptr<CompiledDbc> load_dbc_file();
+    void reload_loop();
+    void reload_dbc(const char* reason);
+    void apply_pending_dbc();
+    void switch_outputs(const CompiledDbc& dbc);
+    static std::vector<uint32_t> can_ids_of(const CompiledDbc& dbc);
     void decoder_loop();
-    void decode_frame(const CanFrame& frame);
+    void worker_loop(DecodeWorker* worker);
+    void merger_loop();
+    void process_frame(const CanFrame& frame);
+    const CompiledMessage* accept_frame(const CanFrame& frame);
+    bool decode_frame(const CanFrame& frame, const CompiledMessage& compiled,
+                      DecodeContext& context, CanMessage& decoded_message);
+    static size_t worker_index(uint32_t can_id, size_t worker_count);
+    void process_triggered_frame(const CanFrame& frame, const CompiledMessage& compiled);
+    void open_event(const CanFrame& frame, const std::string& expression);
+    void close_event();
+    void emit(const CanMessage& message);
+    void emit_generated(CanMessage& message);
+    void emit_event(StreamEvent& event);
+    void emit_bus_statistics();
+    void poll_cycle_monitor(std::chrono::steady_clock::time_point now);
+    void reset_batches(const CompiledDbc& dbc);
+    void queue_batch_frame(const CanFrame& frame, const CompiledMessage& compiled);
+    void decode_block(const CompiledMessage& compiled, const uint64_t* words,
+                      const std::chrono::steady_clock::time_point* timestamps, size_t count, MessageBlock& block);
+    void emit_block(PendingBlock& pending);
+    void flush_batches();
+    // Blocs en attente abandonnés sans décodage, retourne le nombre de trames
+    uint64_t drop_batches();
+    void process_transport_frame(const CanFrame& marker);
+    bool decode_transport(const TransportPayload& payload, const CompiledMessage& compiled, CanMessage& decoded_message);
+    bool past_drain_deadline() const {
+        return draining_.load(std::memory_order_acquire) && std::chrono::steady_clock::now() >= drain_deadline_;
+    }
 
 public:
     explicit DbcDecoder(const std::string& dbc_file);
@@ -39,8 +235,88 @@ public:
     DbcDecoder(const DbcDecoder&) = delete;
     DbcDecoder& operator=(const DbcDecoder&) = delete;
 
+    // Must be called before start()
+    void set_decimation_rules(const DecimationRules& rules) { decimation_rules_ = rules; }
+    void set_selection_profile(std::shared_ptr<const SelectionProfile> profile) { selection_ = std::move(profile); }
+    void set_worker_count(size_t count) { worker_count_ = count > 0 ? count : 1; }
+    // The writer stage is the merger thread in parallel mode; with a single
+    // worker the output sinks run on the decoder thread.
+    void set_thread_tuning(const ThreadTuning& decoder, const ThreadTuning& writer) {
+        decoder_tuning_ = decoder;
+        writer_tuning_ = writer;
+    }
+
+    // Trigger mode: the output is started for each event and stopped after the
+    // post-trigger window. Forces a single decoding thread.
+    void set_trigger_settings(const TriggerSettings& settings) { trigger_settings_ = settings; }
+
+    // Publishes the latest value of every decoded signal in the POSIX shared
+    // memory object NAME (see shm_signal_table.h). Empty disables it.
+    void set_shared_table_name(const std::string& name) { shared_table_name_ = name; }
+    // Decoded messages are also published to this server (live values only,
+    // the pre-trigger replay is not streamed)
+    void set_stream_server(StreamServer* server) { stream_ = server; }
+    // Writes the bus statistics published by the reader at the position of
+    // its marker frame (BUS_STATS_FRAME_ID) in the stream
+    void set_bus_statistics(BusStatistics* stats) { bus_stats_ = stats; }
+    // Monitors the interval between frames of every message with a
+    // GenMsgCycleTime; missing after timeout_cycles cycles. 0 disables it.
+    void set_cycle_monitoring(double timeout_cycles) { cycle_timeout_cycles_ = timeout_cycles; }
+    // Decodes messages with a GenMsgCycleTime of BATCH_MAX_CYCLE_MS or less in
+    // blocks of up to frames frames (batch_decode.h). Single decoding thread
+    // only; messages with an averaging decimation rule stay frame by frame.
+    void set_batch_decode(size_t frames) { batch_frames_ = std::min(frames, BATCH_MAX_FRAMES); }
+    // Longest time a frame can wait in its block before being written
+    static constexpr auto BATCH_MAX_DELAY = std::chrono::milliseconds(50);
+    // DBC messages longer than 8 bytes are decoded from the payloads the
+    // transport reader reassembles (marker frame TRANSPORT_FRAME_ID) instead
+    // of raw frames. Not decimated, and not part of the pre-trigger window in
+    // trigger mode.
+    void set_transport(TransportProtocol protocol, TransportInbox* inbox) {
+        transport_protocol_ = protocol;
+        transport_inbox_ = inbox;
+    }
+
+    // Reloads the DBC when its file is replaced or rewritten (inotify)
+    void set_watch_dbc(bool enabled) { watch_dbc_ = enabled; }
+    // Called from the pipeline after a reload with the new selected CAN IDs
+    void set_can_ids_listener(std::function<void(const std::vector<uint32_t>&)> listener) {
+        can_ids_listener_ = std::move(listener);
+    }
+
+    // Signal names by index (DecodedSignal::signal_index) of the DBC loaded by
+    // start(); a reload sends the new catalog to the stream server itself
+    const std::vector<SignalTablePublisher::Entry>& signal_catalog() const { return dbc_->signal_entries; }
+
+    // CAN IDs with at least one selected signal in the DBC loaded by start(),
+    // transport messages excepted (their fragments are not decoded)
+    std::vector<uint32_t> selected_can_ids() const { return can_ids_of(*dbc_); }
+    // Transport messages of the DBC loaded by start(), for the transport reader
+    std::vector<TransportFlow> transport_flows() const;
+
+    // Parses and compiles the DBC again on a background thread; the decoder
+    // switches to it between two frames and the outputs rotate to a file with
+    // the new layout. The current DBC stays in use if the new one is invalid.
+    void request_reload();
+
     bool start(std::shared_ptr<ThreadSafeQueue<CanFrame>> input_queue,
-               Mf4Writer* writer);
-    void stop();
+               OutputSink* output);
+
+    // Offline use on the calling thread, without queue, thread or output
+    // (tools/decode_bench, tools/decode_fuzz). load_offline() replaces start();
+    // decode_offline() runs the pipeline path of one frame: CAN ID lookup,
+    // decimation, multiplexer resolution and signal extraction.
+    bool load_offline();
+    bool decode_offline(const CanFrame& frame, CanMessage& decoded_message);
+    // Block path of up to BATCH_MAX_FRAMES frames of one CAN ID, after
+    // set_batch_decode(). False when the message has no block plan
+    // (multiplexed or unknown); the block points into the decoder's buffers.
+    bool decode_block_offline(const CanFrame* frames, size_t count, MessageBlock& block);
+
+    // Decodes and writes every queued frame, then stops. Frames still queued
+    // at the deadline are discarded and reported as lost. The output must
+    // still be running; the reader should already be stopped.
+    DrainStats drain_and_stop(std::chrono::steady_clock::time_point deadline);
+    void stop() { drain_and_stop(std::chrono::steady_clock::time_point::max()); }
     bool is_running() const { return running_.load(); }
 };
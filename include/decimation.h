@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "can_frame.h"
+
+// Réduction de débit par CAN ID, appliquée dans le décodeur
+enum class DecimationMode {
+    None,
+    EveryNth,       // garde une trame sur N (avant décodage)
+    MinInterval,    // garde une trame au plus toutes les min_interval (avant décodage)
+    BlockAverage    // moyenne des valeurs décodées sur des blocs de N trames
+};
+
+struct DecimationRule {
+    DecimationMode mode = DecimationMode::None;
+    uint32_t factor = 1;
+    std::chrono::microseconds min_interval{0};
+
+    // Human readable description, with the effective rate when the source
+    // cycle time is known (cycle_time_ms <= 0 means unknown)
+    std::string describe(double cycle_time_ms) const;
+};
+
+using DecimationRules = std::unordered_map<uint32_t, DecimationRule>;
+
+// Parse "ID:nth:N", "ID:interval:T" (T in ms, or with us/ms/s suffix) or "ID:avg:N"
+bool parse_decimation_spec(const std::string& spec, uint32_t& can_id,
+                           DecimationRule& rule, std::string& error);
+
+class DecimationFilter {
+private:
+    struct Block {
+        uint32_t counter = 0;
+        std::vector<double> sums;
+    };
+
+    struct State {
+        DecimationRule rule;
+        uint32_t counter = 0;
+        bool has_last = false;
+        std::chrono::steady_clock::time_point last_kept;
+        std::unordered_map<uint32_t, Block> blocks;  // un bloc par layout de multiplexage
+    };
+
+    std::unordered_map<uint32_t, State> states_;
+
+public:
+    void set_rules(const DecimationRules& rules);
+    bool empty() const { return states_.empty(); }
+
+    // Pre-decode check. Returns false when the frame must be dropped.
+    bool accept(const CanFrame& frame);
+
+    // Post-decode accumulation for BlockAverage rules, per multiplexer layout.
+    // Returns true when the signals must be forwarded; on block completion the
+    // values are replaced by the block mean.
+    bool accumulate(uint32_t can_id, uint32_t layout_id, std::vector<DecodedSignal>& signals);
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+// Valeur JSON minimale pour les fichiers de configuration livrés avec le collecteur
+class JsonValue {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    using Array = std::vector<JsonValue>;
+    using Object = std::vector<std::pair<std::string, JsonValue>>;
+
+private:
+    Type type_ = Type::Null;
+    bool bool_ = false;
+    double number_ = 0.0;
+    std::string string_;
+    Array array_;
+    Object object_;
+
+    friend class JsonParser;
+
+public:
+    JsonValue() = default;
+
+    static bool parse(const std::string& text, JsonValue& out, std::string& error);
+    static bool parse_file(const std::string& path, JsonValue& out, std::string& error);
+
+    Type type() const { return type_; }
+    bool is_null() const { return type_ == Type::Null; }
+    bool is_bool() const { return type_ == Type::Bool; }
+    bool is_number() const { return type_ == Type::Number; }
+    bool is_string() const { return type_ == Type::String; }
+    bool is_array() const { return type_ == Type::Array; }
+    bool is_object() const { return type_ == Type::Object; }
+
+    bool as_bool(bool fallback = false) const { return is_bool() ? bool_ : fallback; }
+    double as_number(double fallback = 0.0) const { return is_number() ? number_ : fallback; }
+    const std::string& as_string() const { return string_; }
+    const Array& as_array() const { return array_; }
+    const Object& members() const { return object_; }
+
+    // Object member lookup, nullptr if absent or not an object
+    const JsonValue* find(const std::string& key) const;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Accès bas niveau aux blocs MDF4 (sans mdflib) pour les checkpoints pendant
+// l'enregistrement et la réparation des fichiers non finalisés après une coupure.
+// Seul le cas écrit par Mf4Writer est géré : un data group ouvert dont les
+// enregistrements sont ajoutés en fin de fichier dans un bloc DT.
+
+struct Mf4GroupLayout {
+    uint64_t block_offset = 0;        // bloc CG
+    uint64_t record_id = 0;
+    uint32_t record_bytes = 0;        // cg_data_bytes + cg_inval_bytes
+    bool vlsd = false;
+    uint64_t cycle_count = 0;         // valeur lue dans le fichier
+    uint64_t cycle_count_offset = 0;  // position de cg_cycle_count dans le fichier
+    bool has_master = false;          // canal maître double (secondes relatives)
+    uint32_t master_byte_offset = 0;  // dans l'enregistrement, après le record ID
+};
+
+struct Mf4DataLayout {
+    bool finalized_id = false;        // id_file "MDF     " (sinon "UnFinMF ")
+    uint8_t record_id_size = 0;
+    uint64_t dt_offset = 0;           // bloc DT du data group ouvert
+    uint64_t dt_length = 0;           // longueur inscrite dans l'en-tête DT
+    std::vector<Mf4GroupLayout> groups;
+
+    uint64_t data_start() const { return dt_offset + 24; }
+};
+
+// Reads the ID/HD/DG/CG chain and locates the DT block of the open data group
+bool read_mf4_layout(int fd, Mf4DataLayout& layout, std::string& error);
+
+// Début d'une tranche de temps : premier enregistrement dont le maître
+// franchit une nouvelle tranche
+struct Mf4TimeSlice {
+    double time_s = 0.0;     // valeur du canal maître (secondes depuis le début de mesure)
+    uint64_t offset = 0;     // position de l'enregistrement dans le fichier
+};
+
+struct Mf4TimeIndex {
+    double slice_seconds = 1.0;
+    double next_time_s = 0.0;
+    std::vector<Mf4TimeSlice> slices;
+
+    void observe(double time_s, uint64_t offset) {
+        if (time_s >= next_time_s) {
+            slices.push_back({time_s, offset});
+            next_time_s = (static_cast<uint64_t>(time_s / slice_seconds) + 1) * slice_seconds;
+        }
+    }
+};
+
+// Walks complete records in [from, limit) and adds them to counts (one entry
+// per group). Records with a master channel feed index when given. Returns
+// the end offset of the last complete record.
+uint64_t scan_mf4_records(int fd, const Mf4DataLayout& layout, uint64_t from, uint64_t limit,
+                          std::vector<uint64_t>& counts, Mf4TimeIndex* index = nullptr);
+
+class Mf4Checkpointer {
+private:
+    Mf4DataLayout layout_;
+    bool layout_loaded_ = false;
+    bool disabled_ = false;
+    uint64_t scan_offset_ = 0;
+    std::vector<uint64_t> counts_;
+    uint64_t checkpoints_ = 0;
+    Mf4TimeIndex time_index_;   // construit au fil des checkpoints, complété par finish()
+
+public:
+    void reset();
+
+    // Scans the records appended since the previous call, then patches the DT
+    // block length and the CG cycle counters in place so that the file is
+    // readable up to this point. The caller syncs the file afterwards.
+    bool checkpoint(int fd);
+
+    // Scans the records not seen by the last checkpoint once the file is
+    // finalized, up to the end of the DT block. Builds the whole index when
+    // checkpoints are disabled.
+    bool finish(int fd);
+
+    uint64_t checkpoint_count() const { return checkpoints_; }
+    const Mf4TimeIndex& time_index() const { return time_index_; }
+    uint64_t data_offset() const { return layout_loaded_ ? layout_.data_start() : 0; }
+    uint64_t checkpointed_bytes() const { return layout_loaded_ ? scan_offset_ - layout_.data_start() : 0; }
+};
+
+struct Mf4RepairResult {
+    bool needed = false;
+    bool repaired = false;
+    uint64_t records = 0;
+    uint64_t truncated_bytes = 0;
+    std::string message;
+};
+
+// Repairs a file left unfinalized by a power loss: DT length, cycle counters,
+// partial trailing record and ID block. With dry_run nothing is written.
+Mf4RepairResult repair_mf4_file(const std::string& path, bool dry_run = false);
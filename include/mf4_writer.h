@@ -7,7 +7,15 @@
 #include <vector>
 #include <filesystem>
 #include <atomic>
+#include <functional>
 #include "can_frame.h"
+#include "decimation.h"
+#include "selection_profile.h"
+#include "storage_file.h"
+#include "signal_stats.h"
+#include "mf4_repair.h"
+#include "output_sink.h"
+#include "transport_reader.h"
 
 namespace mdf {
     class MdfWriter;
@@ -20,77 +28,258 @@ namespace dbcppp {
     class INetwork;
 }
 
-// Structure pour regrouper les signaux par message CAN
-struct CanMessage {
-    uint32_t can_id;
-    std::chrono::steady_clock::time_point timestamp;
-    std::vector<DecodedSignal> signals;
+struct ChannelInfo {
+    mdf::IChannel* channel = nullptr;
+    std::string name;
+    std::string unit;
+    uint32_t byte_offset = 0;   // position de la valeur dans l'enregistrement du groupe
+    SignalStats stats;   // remis à zéro à chaque fichier
 };
 
 // Structure pour gérer un channel group par message CAN
 struct ChannelGroupInfo {
     mdf::IChannelGroup* channel_group = nullptr;
     mdf::IChannel* master_channel = nullptr;
-    std::unordered_map<std::string, mdf::IChannel*> channels;
+    std::unordered_map<std::string, ChannelInfo> channels;
     std::string message_name;
+    std::string mux_label;
+    uint32_t can_id = 0;
+    uint64_t sample_count = 0;
+    // Enregistrement encodé directement dans le tampon du groupe (append_samples)
+    bool layout_resolved = false;
+    bool direct_record = false;
+    uint32_t master_offset = 0;
+    // Channels des derniers signaux écrits, réutilisés tant que les
+    // DecodedSignal::signal_index arrivent dans le même ordre
+    std::vector<ChannelInfo*> resolved_channels;
+    std::vector<uint32_t> resolved_indexes;
 };
 
 struct SignalDefinition {
     std::string name;
     std::string unit;
+    std::string description;   // groupes hors DBC : description du channel
 };
 
 struct MessageDefinition {
     uint32_t can_id = 0;
+    uint32_t layout_id = 0;
     std::string name;
+    std::string mux_label;       // vide si non multiplexé
+    double cycle_time_ms = 0.0;  // GenMsgCycleTime, 0 si absent
+    std::string comment;         // groupes hors DBC : remplace le commentaire du message CAN
     std::vector<SignalDefinition> signals;
 };
 
-class Mf4Writer {
+// Layout des channel groups calculé une fois par DBC (noms, commentaires,
+// descriptions) : un nouveau fichier ne fait plus que recréer les blocs
+// mdflib et rattacher les entrées de channel_groups_, qui persistent
+struct ChannelTemplate {
+    ChannelInfo* info = nullptr;
+    std::string name;
+    std::string unit;
+    std::string description;
+};
+
+struct GroupTemplate {
+    ChannelGroupInfo* info = nullptr;
+    std::string name;
+    std::string comment;
+    std::vector<ChannelTemplate> channels;
+};
+
+// Durée des rotations : finalisation du fichier plein puis ouverture du suivant
+struct RotationStats {
+    uint64_t count = 0;
+    double last_ms = 0.0;
+    double max_ms = 0.0;
+    double total_ms = 0.0;
+
+    double mean_ms() const { return count > 0 ? total_ms / static_cast<double>(count) : 0.0; }
+};
+
+// Base de temps imposée aux fichiers d'une fenêtre de rotation (écriture en
+// shards, sharded_mf4_writer.h) : même début de mesure dans chaque fichier
+struct MeasurementTimeBase {
+    std::chrono::steady_clock::time_point steady;
+    std::chrono::system_clock::time_point system;
+};
+
+// Shard des CAN IDs quand l'écriture MF4 est répartie sur count writers ;
+// même hachage multiplicatif que la répartition des workers du décodeur
+inline size_t mf4_shard_index(uint32_t can_id, size_t count) {
+    return count > 1 ? ((can_id * 2654435761u) >> 16) % count : 0;
+}
+
+class RetentionManager;
+class BusStatistics;
+
+class Mf4Writer : public OutputSink {
 private:
     std::string output_directory_;
     std::string dbc_file_path_;
     std::unique_ptr<mdf::MdfWriter> mdf_writer_;
     std::string current_file_path_;
+    std::string file_prefix_ = "can_data_";
     size_t current_file_size_;
-    static constexpr size_t MAX_FILE_SIZE = 15 * 1024 * 1024; // 15 MB
+    static constexpr size_t PREALLOCATION_SLACK = 1024 * 1024;  // l'estimation de taille reste approximative
+    StoragePolicy storage_policy_;
+    Mf4Checkpointer checkpointer_;  // déclaré avant storage_ : son thread l'utilise
+    StorageFile storage_;
     
     // Channel management - un channel group par message CAN
     mdf::IDataGroup* data_group_;
-    std::unordered_map<uint32_t, ChannelGroupInfo> channel_groups_;
+    // Clé : layout de multiplexage (32 bits hauts) | CAN ID (32 bits bas)
+    std::unordered_map<uint64_t, ChannelGroupInfo> channel_groups_;
     
     // Gestion du temps de mesure
     std::chrono::steady_clock::time_point measurement_start_steady_;
     std::chrono::system_clock::time_point measurement_start_system_;
     uint64_t measurement_start_ns_;
     bool measurement_started_ = false;
+    std::chrono::steady_clock::duration anchor_margin_{0};
     bool dbc_loaded_ = false;
+    bool recovery_done_ = false;
     std::atomic<bool> shutdown_requested_{false};
+    std::atomic<uint64_t> dropped_messages_{0};
+    // Compteurs des traces de diagnostic, propres à chaque writer (un thread par shard)
+    mutable uint32_t rejected_count_ = 0;
+    uint64_t message_count_ = 0;
+    bool stopping_logged_ = false;
 
-    std::unique_ptr<const dbcppp::INetwork> dbc_network_;
+    std::shared_ptr<const dbcppp::INetwork> dbc_network_;   // partagé avec le décodeur après un rechargement
     std::vector<MessageDefinition> message_definitions_;
+    std::vector<GroupTemplate> layout_template_;
+    bool layout_template_ready_ = false;   // faux après un rechargement, reconstruit au fichier suivant
+    double last_open_ms_ = 0.0;            // ouverture du fichier courant
+    double last_finalize_ms_ = 0.0;        // finalisation du dernier fichier fermé
+    RotationStats rotation_stats_;
+    DecimationRules decimation_rules_;
+    std::shared_ptr<const SelectionProfile> selection_;
+    RetentionManager* retention_ = nullptr;
+    std::function<void()> rotation_listener_;
+    const BusStatistics* bus_stats_ = nullptr;
+    double cycle_timeout_cycles_ = 0.0;   // 0 : pas de groupe CycleTimes
+    TransportProtocol transport_protocol_ = TransportProtocol::None;
+    std::vector<const double*> block_values_;    // colonnes de l'écriture en cours
+
+    // Manifeste du répertoire de sortie : une ligne JSON ajoutée par fichier fermé
+    static constexpr const char* MANIFEST_FILE = "manifest.jsonl";
+    std::string session_id_;          // un par exécution du collecteur
+    uint64_t file_sequence_ = 0;      // rang du fichier dans la session
+
+    // Écriture en shards : groupes des CAN IDs du shard seulement, base de
+    // temps et rotations décidées par le ShardedMf4Writer
+    size_t shard_index_ = 0;
+    size_t shard_count_ = 1;
+    bool shared_time_base_ = false;
+    MeasurementTimeBase time_base_;
+    uint64_t window_ = 0;             // fenêtre de rotation du fichier courant
     
     bool create_new_file();
     void close_current_file();
     std::string generate_filename();
     void write_can_message_internal(const CanMessage& message);
-    ChannelGroupInfo* get_or_create_channel_group(uint32_t can_id);
-    mdf::IChannel* get_or_create_channel(ChannelGroupInfo* cg_info, const DecodedSignal& signal);
+    bool rotate_if_full();
+    void start_measurement(uint32_t can_id, std::chrono::steady_clock::time_point first_timestamp);
+    bool accept_timestamp(uint32_t can_id, std::chrono::steady_clock::time_point timestamp) const;
+    static double sanitize_value(double value, ChannelInfo& channel_info);
+    bool resolve_record_layout(ChannelGroupInfo& cg_info);
+    // signal_at(i) gives {name, signal_index} of the i-th signal written
+    template <typename SignalAt>
+    const std::vector<ChannelInfo*>& resolve_channels(ChannelGroupInfo& cg_info, size_t count, SignalAt signal_at);
+    // Bulk append of count records to one channel group: a timestamp array and
+    // one value array per channel (values[c][i] for channels[c], nullptr
+    // channels skipped). Each record is encoded directly into the group's
+    // sample buffer, then queued with a single SaveSample. Returns the number
+    // of records written; records older than the measurement start are skipped.
+    size_t append_samples(ChannelGroupInfo& cg_info, ChannelInfo* const* channels, const double* const* values,
+                          size_t channel_count, const std::chrono::steady_clock::time_point* timestamps, size_t count);
+    static uint64_t channel_group_key(uint32_t can_id, uint32_t layout_id) {
+        return (static_cast<uint64_t>(layout_id) << 32) | can_id;
+    }
+    ChannelGroupInfo* get_or_create_channel_group(uint32_t can_id, uint32_t layout_id);
+    ChannelInfo* get_or_create_channel(ChannelGroupInfo* cg_info, const std::string& signal_name);
     uint64_t compute_absolute_timestamp(const std::chrono::steady_clock::time_point& timestamp) const;
     double compute_relative_seconds(const std::chrono::steady_clock::time_point& timestamp) const;
     bool load_dbc_definitions();
+    bool build_message_definitions();
+    // Precomputes the layout template and the persistent channel_groups_ entries
+    void build_layout_template();
     bool initialize_channel_groups();
+    void recover_unfinalized_files();
+    // Writes the per-channel statistics of the file being closed next to it
+    void write_stats_sidecar() const;
+    // Appends the manifest line of the file being closed (time range, CAN IDs,
+    // record offset of each time slice)
+    void append_manifest_entry();
 
 public:
     Mf4Writer(const std::string& output_dir, const std::string& dbc_file);
-    ~Mf4Writer();
+    ~Mf4Writer() override;
 
     // Non-copyable
     Mf4Writer(const Mf4Writer&) = delete;
     Mf4Writer& operator=(const Mf4Writer&) = delete;
 
-    bool start();
-    void stop();
-    void write_can_message(const CanMessage& message);
-    bool is_running() const { return mdf_writer_ != nullptr; }
+    // Must be called before start(); only used to document channel groups
+    void set_decimation_rules(const DecimationRules& rules) { decimation_rules_ = rules; }
+    void set_selection_profile(std::shared_ptr<const SelectionProfile> profile) { selection_ = std::move(profile); }
+    void set_storage_policy(const StoragePolicy& policy) { storage_policy_ = policy; }
+    // Notified (non-blocking) of each opened and closed file
+    void set_retention_manager(RetentionManager* retention) { retention_ = retention; }
+    void set_file_prefix(const std::string& prefix) { file_prefix_ = prefix; }
+    // Called on the writer thread after each rotation on size, before the
+    // message that opens the new file (the columnar sink rotates with it)
+    void set_rotation_listener(std::function<void()> listener) { rotation_listener_ = std::move(listener); }
+    // Adds the bus statistics and frame rate channel groups to every file
+    void set_bus_statistics(const BusStatistics* stats) { bus_stats_ = stats; }
+    // Adds the CycleTimes channel group written by the decoder's cycle monitor
+    void set_cycle_monitoring(double timeout_cycles) { cycle_timeout_cycles_ = timeout_cycles; }
+    // Adds the payload length and sender address channels to the groups of
+    // the DBC messages received through the transport reader
+    void set_transport_protocol(TransportProtocol protocol) { transport_protocol_ = protocol; }
+    // Records can reach the writer up to margin older than the first one of a
+    // file (batch decode holds frames back): each measurement starts that much
+    // before its first record instead of rejecting them
+    void set_anchor_margin(std::chrono::steady_clock::duration margin) { anchor_margin_ = margin; }
+    std::chrono::steady_clock::duration anchor_margin() const { return anchor_margin_; }
+    const StoragePolicy& storage_policy() const { return storage_policy_; }
+
+    // New writer with the same settings and session, for another shard
+    std::unique_ptr<Mf4Writer> clone_configuration() const;
+    // Keeps only the channel groups of the CAN IDs of shard index (see
+    // mf4_shard_index); file names get an _s<index> suffix and manifest lines
+    // the shard and window fields. Must be called before start().
+    void set_shard(size_t index, size_t count);
+    // prepare() no longer repairs unfinalized files: another writer of the
+    // same directory does it (the open files of the shards would look interrupted)
+    void skip_recovery() { recovery_done_ = true; }
+    // The following files start their measurement at base instead of their
+    // first record and are named after base.system; the writer no longer
+    // rotates on size, rotate() is called for every shard at the same boundary
+    void set_time_base(const MeasurementTimeBase& base, uint64_t window);
+    // Finalizes the current file and opens the one of window
+    bool rotate(const MeasurementTimeBase& base, uint64_t window);
+    // Size estimate of the current file, read by the thread that writes
+    size_t current_file_size() const { return current_file_size_; }
+
+    // Loads the DBC layout and repairs unfinalized files without opening a
+    // file. start() does it implicitly.
+    bool prepare();
+    const char* name() const override { return "MF4"; }
+    bool start() override;
+    void stop() override;
+    void write_can_message(const CanMessage& message) override;
+    // Point event (EV block) in the current file
+    void write_event(const StreamEvent& event) override;
+    // Channels resolved once per block, then one record per frame
+    void write_message_block(const MessageBlock& block) override;
+    bool is_running() const override { return mdf_writer_ != nullptr; }
+    // Rebuilds the channel layout from the reloaded DBC and rotates to a new file
+    void dbc_changed(const std::shared_ptr<const dbcppp::INetwork>& network) override;
+    // Messages refused because no file was open or the writer was stopping
+    uint64_t dropped_messages() const { return dropped_messages_.load(); }
+    // Rotations of the run (full file or DBC reload); read once the writer is stopped
+    const RotationStats& rotation_stats() const { return rotation_stats_; }
 };
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+namespace dbcppp {
+    class IMessage;
+    class ISignal;
+}
+
+// Ensemble des signaux actifs pour une combinaison de valeurs de multiplexeur.
+// Un message non multiplexé n'a qu'un seul layout (id 0) contenant tous ses signaux.
+struct MuxLayout {
+    uint32_t id = 0;
+    std::string label;   // "" si non multiplexé, sinon "Mux3" ou "Mux3_SubMux1"
+    std::vector<const dbcppp::ISignal*> signals;
+};
+
+// Arbre de décision construit une fois par message depuis le DBC. Gère le
+// multiplexage simple (M / mN) et le multiplexage étendu (SG_MUL_VAL_).
+class MuxLayoutTable {
+private:
+    struct Node {
+        const dbcppp::ISignal* switch_signal = nullptr;   // nullptr : feuille
+        std::unordered_map<uint64_t, uint32_t> children;  // valeur du switch -> noeud
+        uint32_t default_child = 0;                       // aucune valeur connue
+        uint32_t layout = 0;                              // feuille uniquement
+    };
+
+    struct Guard {
+        const dbcppp::ISignal* switch_signal = nullptr;
+        std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    };
+
+    struct BuildState {
+        std::vector<bool> active;
+        std::vector<const dbcppp::ISignal*> pending;
+        std::string label;
+    };
+
+    static constexpr size_t MAX_LAYOUTS = 1024;
+    static constexpr uint64_t MAX_RANGE_WIDTH = 256;
+
+    std::vector<Node> nodes_;
+    std::vector<MuxLayout> layouts_;
+    std::vector<const dbcppp::ISignal*> signals_;
+    std::vector<Guard> guards_;
+    bool multiplexed_ = false;
+
+    bool build_node(const BuildState& state, uint32_t& node_index);
+    bool is_switch(const dbcppp::ISignal* signal) const;
+
+public:
+    // Builds the decision tree. On failure (too many combinations) the table
+    // falls back to a single layout containing every signal.
+    bool build(const dbcppp::IMessage& message);
+
+    // Removes unselected signals from every layout. Switch signals keep being
+    // decoded to resolve the layout even when they are not retained.
+    void retain_signals(const std::function<bool(const dbcppp::ISignal&)>& keep);
+    bool has_signals() const;
+
+    bool is_multiplexed() const { return multiplexed_; }
+    const std::vector<MuxLayout>& layouts() const { return layouts_; }
+
+    // Decodes only the switch signals needed to select the active layout
+    const MuxLayout& resolve(const uint8_t* data) const;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include "can_frame.h"
+
+namespace dbcppp {
+    class INetwork;
+}
+
+// Destination des messages décodés (fichier MF4, fichier colonnes, ...).
+// Toutes les méthodes sont appelées depuis l'étage d'écriture du pipeline.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    virtual const char* name() const = 0;
+    // Opens a new file; may be called again after stop() (event recording)
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+    virtual void write_can_message(const CanMessage& message) = 0;
+    virtual bool is_running() const = 0;
+    // Called in stream order when the decoder switches to a reloaded DBC: the
+    // following messages use its signals and multiplexing layouts
+    virtual void dbc_changed(const std::shared_ptr<const dbcppp::INetwork>& network) { (void)network; }
+    // Timestamped event of the stream, in stream order; ignored by sinks without events
+    virtual void write_event(const StreamEvent& event) { (void)event; }
+    // Frames of one CAN ID decoded together (batch decode), in stream order.
+    // The default writes them one by one through write_can_message().
+    virtual void write_message_block(const MessageBlock& block);
+};
+
+// Diffuse chaque message vers plusieurs sinks. Ne possède pas les sinks.
+class SinkFanout : public OutputSink {
+private:
+    std::vector<OutputSink*> sinks_;
+
+public:
+    void add_sink(OutputSink* sink) { sinks_.push_back(sink); }
+    size_t size() const { return sinks_.size(); }
+
+    const char* name() const override { return "fanout"; }
+    // Starts every sink, or none: sinks already started are stopped on failure
+    bool start() override;
+    void stop() override;
+    void write_can_message(const CanMessage& message) override {
+        for (OutputSink* sink : sinks_) {
+            sink->write_can_message(message);
+        }
+    }
+    // True while every sink is running
+    bool is_running() const override;
+    void dbc_changed(const std::shared_ptr<const dbcppp::INetwork>& network) override;
+    void write_event(const StreamEvent& event) override {
+        for (OutputSink* sink : sinks_) {
+            sink->write_event(event);
+        }
+    }
+    void write_message_block(const MessageBlock& block) override {
+        for (OutputSink* sink : sinks_) {
+            sink->write_message_block(block);
+        }
+    }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <system_error>
+
+// Budget disque du répertoire de sortie (0 = pas de limite)
+struct RetentionPolicy {
+    uint64_t max_bytes = 0;          // taille totale des fichiers terminés
+    size_t max_files = 0;            // nombre de fichiers terminés
+    uint64_t min_free_bytes = 0;     // espace libre à garder sur la partition
+    std::string archive_dir;         // déplacer au lieu de supprimer si non vide
+    std::chrono::seconds check_interval{30};
+
+    bool enabled() const { return max_bytes > 0 || max_files > 0 || min_free_bytes > 0; }
+    std::string describe() const;
+};
+
+// Fichiers gérés : can_data_* et event_*, en .mf4 et en .cck (sortie colonnes).
+// L'annexe .stats.json d'un MF4 est supprimée ou archivée avec lui.
+// Applique le budget depuis un thread basse priorité en supprimant (ou
+// déplaçant) les fichiers terminés les plus anciens. La liste des fichiers est
+// tenue en cache à partir des notifications du writer ; le répertoire n'est
+// relu qu'au démarrage et périodiquement. Le writer ne fait que poster.
+class RetentionManager {
+private:
+    struct FileEntry {
+        std::string path;
+        uint64_t size = 0;
+    };
+
+    std::string output_directory_;
+    RetentionPolicy policy_;
+    // Archive sur la partition de sortie : la déplacer ne libère rien, le
+    // critère d'espace libre supprime alors les fichiers
+    bool archive_on_output_device_ = false;
+
+    std::unique_ptr<std::thread> thread_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stop_requested_ = false;
+    std::atomic<bool> abort_enforce_{false};   // arrêt : plus de suppression après celle en cours
+    bool check_requested_ = false;
+    std::vector<std::string> closed_files_;   // postés par le writer
+    std::vector<std::string> active_files_;   // fichiers en cours d'écriture (shards MF4, .cck), jamais supprimés
+
+    // Cache, thread de rétention uniquement (trié du plus ancien au plus récent)
+    std::deque<FileEntry> files_;
+    uint64_t total_bytes_ = 0;
+    std::chrono::steady_clock::time_point last_scan_;
+
+    void retention_loop();
+    void scan_directory();
+    void add_file(const std::string& path);
+    void enforce(const std::vector<std::string>& active_files);
+    // archive false: deleted even with an archive directory
+    bool remove_oldest(bool archive);
+    // Deletes path, or moves it to the archive directory
+    void dispose(const std::string& path, bool archive, std::error_code& ec) const;
+    uint64_t free_bytes() const;
+
+public:
+    RetentionManager(const std::string& output_dir, const RetentionPolicy& policy);
+    ~RetentionManager();
+
+    // Non-copyable
+    RetentionManager(const RetentionManager&) = delete;
+    RetentionManager& operator=(const RetentionManager&) = delete;
+
+    // Scans the directory and enforces the budget once before returning so the
+    // first MF4 file has room, then starts the background thread
+    bool start();
+    void stop();
+
+    // Non-blocking notifications from the writer
+    void notify_file_opened(const std::string& path);
+    void notify_file_closed(const std::string& path);
+    void request_check();
+};
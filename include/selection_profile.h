@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dbcppp {
+    class INetwork;
+}
+
+// Profil de sélection : sous-ensemble des messages / signaux du DBC à enregistrer.
+//
+// {
+//   "messages": [
+//     { "name": "WheelSpeed*" },
+//     { "id": "0x1A0", "signals": ["EngineSpeed", "Coolant*"] },
+//     { "id": "0x18FEF100" }
+//   ]
+// }
+//
+// Les noms acceptent les jokers fnmatch (*, ?, [..]). Une entrée sans "signals"
+// sélectionne tous les signaux du message. Les "id" sont ceux du bus : au-delà
+// de 0x7FF l'ID est étendu (29 bits) et reçoit CAN_EFF_FLAG comme les IDs du
+// DBC ; un ID étendu de 0x7FF ou moins s'écrit avec le bit 31 (0x80000100).
+class SelectionProfile {
+private:
+    struct Entry {
+        bool has_id = false;
+        uint32_t can_id = 0;
+        std::string name_pattern;
+        std::vector<std::string> signal_patterns;
+    };
+
+    std::string path_;
+    std::vector<Entry> entries_;
+
+    static bool matches(const std::string& pattern, const std::string& name);
+    bool entry_matches(const Entry& entry, uint32_t can_id, const std::string& message_name) const;
+
+public:
+    bool load(const std::string& path);
+    const std::string& path() const { return path_; }
+    size_t entry_count() const { return entries_.size(); }
+
+    bool select_message(uint32_t can_id, const std::string& message_name) const;
+    bool select_signal(uint32_t can_id, const std::string& message_name,
+                       const std::string& signal_name) const;
+    // Avertit pour chaque entrée qui ne sélectionne aucun message du DBC
+    void report_unmatched(const dbcppp::INetwork& network) const;
+};
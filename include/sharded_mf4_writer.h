@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "mf4_writer.h"
+#include "thread_safe_queue.h"
+#include "thread_tuning.h"
+
+// Écriture MF4 répartie sur plusieurs threads pour les bus chargés : un seul
+// mdf::MdfWriter sérialise tous les channel groups. Chaque shard a son
+// Mf4Writer, son fichier et son thread, et reçoit les CAN IDs que
+// mf4_shard_index() lui attribue (tous les layouts de multiplexage d'un ID
+// dans le même fichier). Les shards partagent la base de temps et les bornes
+// de rotation : dès qu'un fichier atteint la taille de rotation, tous passent
+// ensemble à la fenêtre suivante, avec le même début de mesure et le même nom
+// au suffixe _s<shard> près. Les lignes du manifeste portent "window", "shard"
+// et "shards" pour regrouper les fichiers d'une même fenêtre.
+class ShardedMf4Writer : public OutputSink {
+public:
+    // Mémoire des éléments en attente par shard (messages copiés, blocs,
+    // événements, marqueurs) au-delà de laquelle les messages sont perdus
+    static constexpr size_t MAX_QUEUED_BYTES = 16 * 1024 * 1024;
+
+private:
+    struct Item {
+        enum class Kind { Message, Block, Event, Rotate, DbcChanged };
+        Kind kind = Kind::Message;
+        size_t bytes = 0;      // estimation de la mémoire de l'élément
+        size_t messages = 0;   // messages perdus si l'élément est abandonné
+        CanMessage message;
+        // Bloc : colonnes copiées (stride = frame_count), signaux partagés
+        // par tous les blocs du même plan de décodage
+        uint32_t can_id = 0;
+        uint32_t layout_id = 0;
+        size_t frame_count = 0;
+        std::shared_ptr<const std::vector<BlockSignal>> block_signals;
+        std::vector<std::chrono::steady_clock::time_point> timestamps;
+        std::vector<double> values;
+        StreamEvent event;
+        // Rotate et DbcChanged : fenêtre ouverte par le shard
+        MeasurementTimeBase time_base;
+        uint64_t window = 0;
+        std::shared_ptr<const dbcppp::INetwork> network;
+    };
+
+    struct Shard {
+        size_t index = 0;
+        std::unique_ptr<Mf4Writer> writer;
+        ThreadSafeQueue<Item> queue;
+        std::atomic<size_t> queued_bytes{0};
+        std::unique_ptr<std::thread> thread;
+        // Fenêtre du fichier ouvert, écrite par le thread du shard : le routage
+        // n'envoie un nouveau marqueur de rotation qu'une fois le précédent appliqué
+        std::atomic<uint64_t> window{0};
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    ThreadTuning thread_tuning_;
+    bool running_ = false;
+    uint64_t window_ = 0;   // fenêtre courante, thread d'écriture du décodeur
+    std::chrono::steady_clock::time_point last_timestamp_;   // dernier enregistrement routé
+    // Fenêtre demandée par un shard dont le fichier est plein ; plus grande
+    // que window_ : tous les shards tournent avant le message suivant
+    std::atomic<uint64_t> rotation_request_{0};
+    std::atomic<uint64_t> dropped_messages_{0};
+    std::atomic<uint64_t> dropped_events_{0};
+    std::function<void()> rotation_listener_;
+    // Arrêt : au-delà de l'échéance, ce qui reste dans les files est abandonné
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> has_deadline_{false};
+    std::atomic<std::chrono::steady_clock::rep> stop_deadline_{0};
+    // Copie partagée des signaux de chaque plan de décodage par blocs, vidée
+    // au changement de DBC (les plans sont reconstruits)
+    std::unordered_map<const std::vector<BlockSignal>*, std::shared_ptr<const std::vector<BlockSignal>>> block_signals_;
+
+    MeasurementTimeBase time_base_at(std::chrono::steady_clock::time_point first_timestamp) const;
+    // All shards move to the next window before the record at timestamp,
+    // once every shard has applied the previous one
+    void rotate_all(std::chrono::steady_clock::time_point timestamp);
+    // False when the shard queue is over MAX_QUEUED_BYTES (the messages of the
+    // item are counted as dropped); required items (rotation and DBC markers,
+    // at most one per window) are always queued
+    bool push(Shard& shard, Item item, bool required = false);
+    // Pops the item that was queued: releases its bytes
+    void release(Shard& shard, const Item& item) { shard.queued_bytes.fetch_sub(item.bytes); }
+    bool deadline_reached() const;
+    Shard& shard_of(uint32_t can_id) { return *shards_[mf4_shard_index(can_id, shards_.size())]; }
+    void shard_loop(Shard& shard);
+    void stop_threads();
+
+public:
+    // count writers with the settings of prototype (clone_configuration())
+    ShardedMf4Writer(const Mf4Writer& prototype, size_t count);
+    ~ShardedMf4Writer() override;
+
+    // Non-copyable
+    ShardedMf4Writer(const ShardedMf4Writer&) = delete;
+    ShardedMf4Writer& operator=(const ShardedMf4Writer&) = delete;
+
+    // Scheduling of the shard threads (writer stage)
+    void set_thread_tuning(const ThreadTuning& tuning) { thread_tuning_ = tuning; }
+    size_t shard_count() const { return shards_.size(); }
+    // Called on the routing thread at each rotation of all shards (not at a
+    // DBC reload), before the first message of the new window
+    void set_rotation_listener(std::function<void()> listener) { rotation_listener_ = std::move(listener); }
+
+    // Loads the DBC layout of every shard and repairs unfinalized files once,
+    // before any shard opens its file
+    bool prepare();
+    const char* name() const override { return "MF4 shards"; }
+    bool start() override;
+    // Bounds the drain of the shard queues in stop(): items still queued at
+    // deadline are dropped and counted. Without it stop() writes them all.
+    void set_stop_deadline(std::chrono::steady_clock::time_point deadline);
+    // Drains the shard queues, then finalizes every file
+    void stop() override;
+    void write_can_message(const CanMessage& message) override;
+    // Written in the file of every shard
+    void write_event(const StreamEvent& event) override;
+    void write_message_block(const MessageBlock& block) override;
+    bool is_running() const override;
+    // Every shard rotates to a new window with the reloaded DBC
+    void dbc_changed(const std::shared_ptr<const dbcppp::INetwork>& network) override;
+
+    // Messages refused by a full shard queue, left at the stop deadline or
+    // refused by a shard writer
+    uint64_t dropped_messages() const;
+    uint64_t dropped_events() const { return dropped_events_.load(); }
+    // Rotations of all shards (one per shard and window); read once stopped
+    RotationStats rotation_stats() const;
+};
@@ -0,0 +1,166 @@
+/*
+ * Table des dernières valeurs de signaux publiée par can_socket_collector
+ * (option --shm-name) dans un segment de mémoire partagée POSIX.
+ *
+ * En-tête C autonome pour les autres processus de l'OWA4X : aucun appel au
+ * collecteur, aucun verrou. Chaque entrée est protégée par un seqlock (un seul
+ * écrivain par entrée) ; un lecteur recommence simplement si une écriture
+ * était en cours.
+ *
+ *   size_t size;
+ *   const can_shm_header* table = can_shm_open(CAN_SHM_DEFAULT_NAME, &size);
+ *   int speed = can_shm_find(table, "VehicleSpeed");   // ou "Message.Signal"
+ *   can_shm_entry entry;
+ *   if (speed >= 0 && can_shm_read(table, (uint32_t)speed, &entry) && entry.update_count > 0)
+ *       printf("%f at %llu ns\n", entry.value, (unsigned long long)entry.timestamp_ns);
+ *   can_shm_close(table, size);
+ *
+ * Le collecteur recrée le segment à chaque démarrage : un lecteur qui voit
+ * state == CAN_SHM_STATE_STOPPED doit rouvrir la table.
+ */
+#ifndef CAN_SHM_SIGNAL_TABLE_H
+#define CAN_SHM_SIGNAL_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAN_SHM_MAGIC 0x314D48534E4143ULL   /* "CANSHM1" */
+#define CAN_SHM_VERSION 1
+#define CAN_SHM_DEFAULT_NAME "/can_signals"
+#define CAN_SHM_NAME_SIZE 96
+#define CAN_SHM_UNIT_SIZE 24
+
+#define CAN_SHM_STATE_RUNNING 1
+#define CAN_SHM_STATE_STOPPED 2
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t state;             /* CAN_SHM_STATE_* */
+    uint32_t entry_count;
+    uint32_t entry_size;        /* sizeof(can_shm_entry) */
+    uint32_t name_size;         /* sizeof(can_shm_name) */
+    int32_t writer_pid;
+    uint64_t entries_offset;    /* depuis le début du segment */
+    uint64_t names_offset;
+    uint64_t total_size;
+    uint64_t created_ns;        /* CLOCK_REALTIME à la création */
+    uint8_t reserved[64];
+} can_shm_header;
+
+/* Une ligne de cache par entrée : les workers du décodeur ne se gênent pas */
+typedef struct {
+    uint32_t sequence;          /* impair pendant une écriture */
+    uint32_t can_id;
+    double value;               /* valeur physique */
+    uint64_t timestamp_ns;      /* CLOCK_MONOTONIC de réception de la trame */
+    uint64_t update_count;      /* 0 : jamais reçu */
+    uint8_t reserved[32];
+} can_shm_entry;
+
+/* Index nom -> entrée, écrit une fois à la création */
+typedef struct {
+    char name[CAN_SHM_NAME_SIZE];   /* "Message.Signal" */
+    char unit[CAN_SHM_UNIT_SIZE];
+    uint32_t can_id;
+    uint32_t reserved;
+} can_shm_name;
+
+static inline const can_shm_entry* can_shm_entries(const can_shm_header* header) {
+    return (const can_shm_entry*)((const uint8_t*)header + header->entries_offset);
+}
+
+static inline const can_shm_name* can_shm_names(const can_shm_header* header) {
+    return (const can_shm_name*)((const uint8_t*)header + header->names_offset);
+}
+
+/* Maps the table read-only. Returns NULL if it does not exist or does not
+ * match this header version. */
+static inline const can_shm_header* can_shm_open(const char* name, size_t* size) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(can_shm_header)) {
+        close(fd);
+        return NULL;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    const can_shm_header* header = (const can_shm_header*)map;
+    if (header->magic != CAN_SHM_MAGIC || header->version != CAN_SHM_VERSION
+        || header->entry_size != sizeof(can_shm_entry) || header->name_size != sizeof(can_shm_name)
+        || header->total_size > (uint64_t)st.st_size) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return header;
+}
+
+static inline void can_shm_close(const can_shm_header* header, size_t size) {
+    if (header) {
+        munmap((void*)header, size);
+    }
+}
+
+/* Index of "Signal" or "Message.Signal", -1 if absent. An unqualified name
+ * returns the first message carrying that signal. Resolve once, then read
+ * by index. */
+static inline int can_shm_find(const can_shm_header* header, const char* name) {
+    const can_shm_name* names = can_shm_names(header);
+    const int qualified = strchr(name, '.') != NULL;
+    uint32_t i;
+    for (i = 0; i < header->entry_count; ++i) {
+        const char* candidate = names[i].name;
+        if (!qualified) {
+            const char* dot = strchr(candidate, '.');
+            candidate = dot ? dot + 1 : candidate;
+        }
+        if (strncmp(candidate, name, CAN_SHM_NAME_SIZE) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/* Consistent snapshot of one entry, retried while the collector writes it.
+ * Returns 0 if index is out of range. */
+static inline int can_shm_read(const can_shm_header* header, uint32_t index, can_shm_entry* out) {
+    if (index >= header->entry_count) {
+        return 0;
+    }
+    const can_shm_entry* entry = can_shm_entries(header) + index;
+    uint32_t before;
+    do {
+        do {
+            before = __atomic_load_n(&entry->sequence, __ATOMIC_ACQUIRE);
+        } while (before & 1u);
+        out->can_id = __atomic_load_n(&entry->can_id, __ATOMIC_RELAXED);
+        __atomic_load(&entry->value, &out->value, __ATOMIC_RELAXED);
+        out->timestamp_ns = __atomic_load_n(&entry->timestamp_ns, __ATOMIC_RELAXED);
+        out->update_count = __atomic_load_n(&entry->update_count, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&entry->sequence, __ATOMIC_RELAXED) != before);
+    out->sequence = before;
+    return 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAN_SHM_SIGNAL_TABLE_H */
@@ -1,25 +1,41 @@
 #pragma once
 
 #include <atomic>
-#include <functional>
 
+// SIGINT/SIGTERM/SIGHUP sont bloqués et lus via signalfd ; request_shutdown()
+// réveille les attentes via un eventfd. Aucun thread n'a besoin de scruter.
+// SIGHUP ne demande pas l'arrêt : il demande le rechargement du DBC.
+// L'arrêt des composants reste à la charge de main(), dans l'ordre du pipeline.
 class SignalHandler {
 private:
     static std::atomic<bool> shutdown_requested_;
-    static std::function<void()> cleanup_callback_;
-    
+    static std::atomic<bool> reload_requested_;
+    static int signal_fd_;
+    static int event_fd_;
+    static int epoll_fd_;
+
     static void signal_handler(int signum);
+    static void on_signal(int signum);
 
 public:
-    // Install signal handlers for graceful shutdown
+    // Blocks the shutdown signals and creates the signalfd. Must be called
+    // before any thread is started so that every thread inherits the mask.
     static void install_handlers();
     
-    // Set callback to be called on shutdown signal
-    static void set_cleanup_callback(std::function<void()> callback);
-    
     // Check if shutdown was requested
     static bool shutdown_requested() { return shutdown_requested_.load(); }
     
-    // Request shutdown programmatically
-    static void request_shutdown() { shutdown_requested_.store(true); }
+    // Request shutdown programmatically (any thread, also used by components
+    // on fatal errors); wakes wait_for_shutdown() immediately
+    static void request_shutdown();
+
+    // Blocks until a signal is received or shutdown is requested, or until
+    // timeout_ms (-1 = no timeout). Returns shutdown_requested().
+    static bool wait_for_shutdown(int timeout_ms = -1);
+
+    // Returns true once per received SIGHUP (DBC reload request)
+    static bool take_reload_request() { return reload_requested_.exchange(false); }
+
+    // Pollable descriptor, readable while a signal or request is pending
+    static int fd() { return epoll_fd_; }
 };
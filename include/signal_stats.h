@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+// Fichier annexe écrit à la fermeture de chaque fichier MF4 :
+// can_data_YYYYMMDD_HHMMSS.mf4 -> can_data_YYYYMMDD_HHMMSS.mf4.stats.json
+constexpr const char* STATS_SIDECAR_SUFFIX = ".stats.json";
+
+// Statistiques d'un canal sur la durée d'un fichier, mises à jour à chaque
+// échantillon écrit (quelques comparaisons et une addition)
+struct SignalStats {
+    uint64_t count = 0;
+    uint64_t nan_count = 0;         // NaN/Inf remplacés par 0.0
+    uint64_t sanitized_count = 0;   // valeurs écrêtées à +/-1e12
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    double sum = 0.0;
+    uint64_t first_ns = 0;
+    uint64_t last_ns = 0;
+
+    void add(double value, uint64_t timestamp_ns) {
+        if (count++ == 0) {
+            first_ns = timestamp_ns;
+        }
+        last_ns = timestamp_ns;
+        min = value < min ? value : min;
+        max = value > max ? value : max;
+        sum += value;
+    }
+
+    double mean() const { return count > 0 ? sum / static_cast<double>(count) : 0.0; }
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "shm_signal_table.h"
+
+// Côté collecteur de la table partagée (shm_signal_table.h). Les index sont
+// attribués au chargement du DBC ; publish() est appelé par le thread qui
+// décode le CAN ID, donc un seul écrivain par entrée.
+class SignalTablePublisher {
+public:
+    struct Entry {
+        std::string name;   // "Message.Signal"
+        std::string unit;
+        uint32_t can_id = 0;
+    };
+
+private:
+    std::string name_;        // nom du segment : provisoire tant que la table n'est pas activée
+    std::string live_name_;   // nom lu par les lecteurs
+    bool live_ = false;
+    can_shm_header* header_ = nullptr;
+    can_shm_entry* entries_ = nullptr;
+    size_t size_ = 0;
+
+public:
+    SignalTablePublisher() = default;
+    ~SignalTablePublisher();
+
+    // Non-copyable
+    SignalTablePublisher(const SignalTablePublisher&) = delete;
+    SignalTablePublisher& operator=(const SignalTablePublisher&) = delete;
+
+    // Builds the table under a staging name (name + ".new"): readers of name
+    // keep the current table until activate()
+    bool create(const std::string& name, const std::vector<Entry>& entries);
+    // Renames the staged segment to its name, atomically replacing the
+    // previous table (called when the DBC is swapped in)
+    bool activate();
+    void close();
+    // Marks the segment stopped and unmaps it. An activated segment keeps its
+    // name, which belongs to the table of the reloaded DBC; a segment never
+    // activated (reload replaced or failed) removes its staging name.
+    void retire();
+    bool is_open() const { return header_ != nullptr; }
+
+    void publish(uint32_t index, double value, std::chrono::steady_clock::time_point timestamp) {
+        can_shm_entry& entry = entries_[index];
+        const uint32_t sequence = __atomic_load_n(&entry.sequence, __ATOMIC_RELAXED);
+        __atomic_store_n(&entry.sequence, sequence + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store(&entry.value, &value, __ATOMIC_RELAXED);
+        // steady_clock est CLOCK_MONOTONIC sous Linux
+        __atomic_store_n(&entry.timestamp_ns, static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count()),
+            __ATOMIC_RELAXED);
+        __atomic_store_n(&entry.update_count, entry.update_count + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&entry.sequence, sequence + 2, __ATOMIC_RELEASE);
+    }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <functional>
+
+// Politique d'écriture sur la flash (eMMC / SD) de l'OWA4X
+struct StoragePolicy {
+    bool preallocate = true;                        // fallocate à la taille de rotation
+    size_t sync_bytes = 1024 * 1024;                // fdatasync tous les N octets écrits (0 = désactivé)
+    std::chrono::seconds sync_interval{5};          // fdatasync au moins toutes les N secondes (0 = désactivé)
+    bool drop_cache = true;                         // posix_fadvise(DONTNEED) sur les pages synchronisées
+    std::chrono::seconds checkpoint_interval{10};   // checkpoint MF4 toutes les N secondes (0 = désactivé)
+    size_t rotation_bytes = 15 * 1024 * 1024;       // rotation des fichiers de sortie (MF4 et colonnes)
+};
+
+// Descripteur annexe sur le fichier MF4 écrit par mdflib. mdflib garde la main
+// sur les écritures ; cette couche préalloue les extents, synchronise par petits
+// incréments depuis un thread dédié (pas de pic de flush du page cache), libère
+// les pages déjà écrites et tronque la préallocation à la fermeture.
+class StorageFile {
+private:
+    std::string path_;
+    StoragePolicy policy_;
+    int fd_ = -1;
+    size_t preallocated_bytes_ = 0;
+
+    std::unique_ptr<std::thread> sync_thread_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stop_requested_ = false;
+    bool sync_requested_ = false;
+    size_t unsynced_bytes_ = 0;
+    std::atomic<uint64_t> synced_offset_{0};
+
+    // Appelé depuis le thread de synchronisation, juste avant fdatasync
+    std::function<void(int fd)> checkpoint_hook_;
+    size_t bytes_since_checkpoint_ = 0;
+
+    void sync_loop();
+    void sync_now();
+    void run_checkpoint();
+    void stop_sync_thread();
+
+public:
+    StorageFile() = default;
+    ~StorageFile();
+
+    // Non-copyable
+    StorageFile(const StorageFile&) = delete;
+    StorageFile& operator=(const StorageFile&) = delete;
+
+    // Attaches to a file already created by mdflib
+    bool open(const std::string& path, size_t expected_size, const StoragePolicy& policy);
+
+    // Called by the writer with the number of bytes appended (estimate)
+    void notify_written(size_t bytes);
+
+    // Requests an immediate background sync
+    void request_sync();
+
+    // Hook run every policy.checkpoint_interval on the sync thread with the
+    // file descriptor, followed by fdatasync. Must be set before open().
+    void set_checkpoint_hook(std::function<void(int fd)> hook) { checkpoint_hook_ = std::move(hook); }
+
+    // Stops the sync thread after a last checkpoint. Must be called before
+    // mdflib finalizes the file since both update the same header fields.
+    void quiesce();
+
+    // Final sync, truncation to the real length and cache release. Must be
+    // called once mdflib has closed the file.
+    void close();
+
+    bool is_open() const { return fd_ >= 0; }
+    const std::string& path() const { return path_; }
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "can_frame.h"
+#include "signal_table_publisher.h"
+
+// Diffusion locale des échantillons décodés sur une socket Unix (SOCK_STREAM).
+// Protocole binaire little-endian, chaque message :
+//   u32 longueur (type + charge) | u8 type | charge
+// Serveur -> client
+//   CATALOG (1) : u32 n, puis n x { u32 index, u32 can_id, u8 l, nom "Message.Signal", u8 l, unité }
+//   BATCH   (2) : u64 t0_ns (CLOCK_MONOTONIC), u32 échantillons perdus avant ce lot,
+//                 u32 n, puis n x { u32 index, u32 dt_ns depuis t0, f64 valeur }
+// Client -> serveur
+//   SUBSCRIBE (1) : u8 politique (0 = perdre les plus récents, 1 = perdre les plus anciens),
+//                   u32 n, puis n x u32 index (n = 0 : tous les signaux)
+// Le catalogue est envoyé à la connexion ; rien d'autre avant SUBSCRIBE.
+// Ordre : chaque signal arrive dans l'ordre de ses horodatages, mais pas les
+// signaux entre eux. Avec --batch-decode, les messages décodés par blocs
+// arrivent par paquets jusqu'à 50 ms après leurs trames, derrière des
+// échantillons plus récents d'autres messages ; un horodatage antérieur au t0
+// du lot ouvert commence un nouveau BATCH. Trier par horodatage si besoin.
+// Après un rechargement du DBC, un nouveau CATALOG annule l'abonnement :
+// les index ont changé, le client doit renvoyer SUBSCRIBE.
+struct StreamSettings {
+    std::string socket_path;
+    size_t buffer_bytes = 1024 * 1024;               // par abonné
+    std::chrono::milliseconds flush_interval{20};    // latence maximale d'un lot
+    size_t max_clients = 8;
+
+    bool enabled() const { return !socket_path.empty(); }
+};
+
+// publish() est appelé par l'étage d'écriture du pipeline : il ne fait
+// qu'ajouter des enregistrements au tampon borné de chaque abonné et ne
+// bloque jamais sur un client. Les envois se font depuis le thread du serveur.
+class StreamServer {
+public:
+    enum class DropPolicy : uint8_t { DropNewest = 0, DropOldest = 1 };
+
+private:
+    struct Batch {
+        std::vector<uint8_t> bytes;   // message complet, en-tête compris
+        uint32_t records = 0;
+    };
+
+    struct Subscriber {
+        int fd = -1;
+
+        // Thread serveur uniquement
+        std::vector<uint8_t> inbox;   // message client incomplet
+        Batch sending;
+        size_t sent = 0;
+        bool want_write = false;
+
+        // Partagé avec publish()
+        std::mutex mutex;
+        bool subscribed = false;
+        DropPolicy policy = DropPolicy::DropNewest;
+        std::vector<bool> filter;     // vide : tous les signaux
+        Batch open;                   // lot en cours de remplissage
+        uint64_t open_base_ns = 0;
+        std::chrono::steady_clock::time_point open_since;
+        std::deque<Batch> ready;      // lots fermés en attente d'envoi
+        size_t buffered = 0;          // octets de open + ready
+        uint32_t dropped = 0;         // depuis le dernier lot fermé
+        uint64_t dropped_total = 0;
+        bool wake_sent = false;
+        bool urgent_sent = false;
+    };
+
+    StreamSettings settings_;
+    std::vector<SignalTablePublisher::Entry> catalog_;   // protégé par subscribers_mutex_
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::unique_ptr<std::thread> thread_;
+
+    std::shared_mutex subscribers_mutex_;
+    std::vector<std::shared_ptr<Subscriber>> subscribers_;
+    std::atomic<bool> has_subscribers_{false};
+
+    void server_loop();
+    void accept_client();
+    void remove_client(const std::shared_ptr<Subscriber>& subscriber);
+    bool read_client(Subscriber& subscriber);
+    void handle_message(Subscriber& subscriber, uint8_t type, const uint8_t* payload, size_t size);
+    bool send_pending(Subscriber& subscriber);
+    void set_write_interest(Subscriber& subscriber, bool enabled);
+    void append_record(Subscriber& subscriber, uint32_t index, uint64_t timestamp_ns, double value);
+    void close_batch(Subscriber& subscriber);
+    void wake();
+    Batch make_catalog() const;
+
+public:
+    explicit StreamServer(const StreamSettings& settings);
+    ~StreamServer();
+
+    // Non-copyable
+    StreamServer(const StreamServer&) = delete;
+    StreamServer& operator=(const StreamServer&) = delete;
+
+    // catalog: signal names by index, as assigned by the decoder
+    bool start(const std::vector<SignalTablePublisher::Entry>& catalog);
+    void stop();
+
+    // Non-blocking, called from the pipeline for every decoded message
+    void publish(const CanMessage& message);
+    // Called from the pipeline, in stream order, when the DBC is reloaded:
+    // sends the new catalog and resets every subscription
+    void update_catalog(const std::vector<SignalTablePublisher::Entry>& catalog);
+};
@@ -11,6 +11,7 @@ private:
     mutable std::mutex mutex_;
     std::queue<T> queue_;
     std::condition_variable condition_;
+    bool closed_ = false;
 
 public:
     ThreadSafeQueue() = default;
@@ -20,8 +21,10 @@ public:
     ThreadSafeQueue& operator=(const ThreadSafeQueue&) = delete;
 
     void push(T item) {
-        std::unique_lock<std::mutex> lock(mutex_);
-        queue_.push(std::move(item));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push(std::move(item));
+        }
         condition_.notify_one();
     }
 
@@ -35,9 +38,10 @@ public:
         return true;
     }
 
-    bool wait_and_pop(T& item, const std::chrono::milliseconds& timeout = std::chrono::milliseconds(100)) {
+    bool wait_and_pop(T& item, const std::chrono::milliseconds& timeout) {
         std::unique_lock<std::mutex> lock(mutex_);
-        if (condition_.wait_for(lock, timeout, [this] { return !queue_.empty(); })) {
+        if (condition_.wait_for(lock, timeout, [this] { return !queue_.empty() || closed_; })
+            && !queue_.empty()) {
             item = std::move(queue_.front());
             queue_.pop();
             return true;
@@ -45,6 +49,38 @@ public:
         return false;
     }
 
+    // Blocks until an item is available. Returns false once the queue is
+    // closed and drained, so consumers need no polling to notice a stop.
+    bool wait_and_pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this] { return !queue_.empty() || closed_; });
+        if (queue_.empty()) {
+            return false;
+        }
+        item = std::move(queue_.front());
+        queue_.pop();
+        return true;
+    }
+
+    // Wakes every waiter; items already queued can still be popped
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        condition_.notify_all();
+    }
+
+    void reopen() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = false;
+    }
+
+    bool is_closed() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_;
+    }
+
     bool empty() const {
         std::lock_guard<std::mutex> lock(mutex_);
         return queue_.empty();
@@ -55,9 +91,12 @@ public:
         return queue_.size();
     }
 
-    void clear() {
+    // Returns the number of discarded items
+    size_t clear() {
         std::lock_guard<std::mutex> lock(mutex_);
+        const size_t count = queue_.size();
         std::queue<T> empty;
         queue_.swap(empty);
+        return count;
     }
 };
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <sched.h>
+
+// Réglages temps réel d'un étage du pipeline (reader, decoder, writer)
+struct ThreadTuning {
+    int policy = SCHED_OTHER;
+    int priority = 0;
+    std::vector<int> cpus;   // affinité, vide = tous les coeurs
+    bool prefault_stack = false;
+
+    bool is_default() const { return policy == SCHED_OTHER && cpus.empty(); }
+    std::string describe() const;
+};
+
+// "STAGE:POLICY:PRIO" with POLICY in other, fifo, rr
+bool parse_sched_spec(const std::string& spec, std::string& stage, ThreadTuning& tuning, std::string& error);
+
+// "STAGE:CPULIST" with CPULIST like "0,2-3"
+bool parse_affinity_spec(const std::string& spec, std::string& stage, ThreadTuning& tuning, std::string& error);
+
+// Names the calling thread and applies policy/priority/affinity. Failures
+// (typically missing CAP_SYS_NICE) are reported, the thread keeps running.
+void apply_thread_tuning(const std::string& thread_name, const ThreadTuning& tuning);
+
+// Names the calling thread and drops it to nice 19 and the idle I/O class,
+// for housekeeping threads that must never compete with the pipeline.
+void apply_background_priority(const std::string& thread_name);
+
+// mlockall() and malloc tuning so locked memory is never given back, then
+// touches prefault_bytes of heap so later allocations do not page-fault.
+bool lock_process_memory(size_t prefault_bytes);
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <linux/can.h>
+#include "thread_safe_queue.h"
+#include "can_frame.h"
+#include "thread_tuning.h"
+
+namespace dbcppp {
+    class IMessage;
+}
+
+// Messages multi-trames réassemblés par le noyau : sockets CAN_J1939
+// (transport BAM et RTS/CTS, jusqu'à 1785 octets) ou CAN_ISOTP (ISO 15765-2,
+// en écoute, jusqu'à 4095 octets). Seule la charge complète remonte en
+// espace utilisateur, aucun travail par fragment. Elle est décodée avec le
+// message du DBC de plus de 8 octets correspondant (même PGN en J1939, même
+// CAN ID en ISO-TP) et enregistrée dans son channel group avec l'adresse de
+// l'émetteur.
+
+enum class TransportProtocol {
+    None,
+    J1939,
+    IsoTp
+};
+
+bool parse_transport_protocol(const std::string& name, TransportProtocol& protocol);
+const char* transport_protocol_name(TransportProtocol protocol);
+
+// Pseudo-trame poussée dans la file brute à chaque charge réassemblée (voir
+// bus_stats.h) : data porte le numéro de séquence de la charge dans la TransportInbox
+constexpr uint32_t TRANSPORT_FRAME_ID = CAN_ERR_FLAG | 0xFE;
+
+// Octets nuls après la charge : ISignal::Decode lit 8 octets à la position du signal
+constexpr size_t TRANSPORT_PADDING = 8;
+
+// PGN d'un identifiant 29 bits ; en PDU1 (PF < 240) l'octet PS est l'adresse de destination
+inline uint32_t j1939_pgn(uint32_t can_id) {
+    const uint32_t pgn = (can_id >> 8) & 0x3FFFF;
+    return ((pgn >> 8) & 0xFF) < 240 ? pgn & 0x3FF00 : pgn;
+}
+
+// Messages du DBC reçus par le socket de transport : plus de 8 octets (BO_),
+// identifiant étendu en J1939. Ils ne sont plus décodés depuis les trames brutes.
+bool is_transport_message(const dbcppp::IMessage& message, TransportProtocol protocol);
+// Clé de la charge : PGN en J1939, CAN ID en ISO-TP
+uint32_t transport_key(uint32_t can_id, TransportProtocol protocol);
+
+// Channels ajoutés aux groupes des messages de transport, hors DBC
+struct TransportChannel {
+    const char* name;
+    const char* unit;
+    const char* description;
+};
+constexpr size_t TRANSPORT_CHANNEL_COUNT = 3;
+extern const TransportChannel TRANSPORT_CHANNELS[TRANSPORT_CHANNEL_COUNT];
+// Length seul en ISO-TP (l'émetteur est le CAN ID du groupe), adresses en J1939
+inline size_t transport_channel_count(TransportProtocol protocol) {
+    return protocol == TransportProtocol::J1939 ? TRANSPORT_CHANNEL_COUNT : 1;
+}
+
+// Message du DBC attendu sur le socket de transport
+struct TransportFlow {
+    uint32_t key = 0;
+    uint32_t can_id = 0;
+    size_t size = 0;   // taille du message dans le DBC
+    std::string name;
+};
+
+struct TransportPayload {
+    uint64_t sequence = 0;
+    uint32_t key = 0;
+    uint8_t source_address = 0xFF;
+    uint8_t destination_address = 0xFF;   // 0xFF : diffusion (BAM)
+    size_t length = 0;                    // octets reçus
+    std::vector<uint8_t> data;            // length octets puis au moins TRANSPORT_PADDING octets nuls
+    std::chrono::steady_clock::time_point timestamp;
+};
+
+// Charges en attente entre le reader de transport et le décodeur, dans
+// l'ordre de leurs pseudo-trames. Les tampons reviennent au reader : pas
+// d'allocation en régime établi.
+class TransportInbox {
+public:
+    static constexpr size_t MAX_PENDING = 1024;
+
+private:
+    mutable std::mutex mutex_;
+    std::deque<TransportPayload> pending_;
+    std::vector<std::vector<uint8_t>> spare_;
+    uint64_t next_sequence_ = 0;
+    uint64_t dropped_ = 0;
+
+public:
+    // Reader thread: copies length bytes and returns the sequence number of
+    // the payload, or false when MAX_PENDING payloads are already waiting
+    bool push(uint32_t key, uint8_t source_address, uint8_t destination_address,
+              const uint8_t* bytes, size_t length, size_t padded_size,
+              std::chrono::steady_clock::time_point timestamp, uint64_t& sequence);
+
+    // Decoder thread: payload of the marker with this sequence number. The
+    // previous buffer of payload is recycled.
+    bool take(uint64_t sequence, TransportPayload& payload);
+
+    uint64_t dropped() const;
+};
+
+class TransportReader {
+private:
+    std::string interface_name_;
+    TransportProtocol protocol_;
+    std::vector<TransportFlow> flows_;
+    std::vector<int> socket_fds_;    // J1939 : un socket ; ISO-TP : un par CAN ID
+    std::vector<size_t> socket_flows_;   // ISO-TP : index dans flows_ de chaque socket
+    int epoll_fd_ = -1;
+    int stop_fd_ = -1;
+    std::atomic<bool> running_;
+    std::shared_ptr<ThreadSafeQueue<CanFrame>> output_queue_;
+    TransportInbox* inbox_;
+    std::unique_ptr<std::thread> reader_thread_;
+    ThreadTuning thread_tuning_;
+    std::vector<uint8_t> buffer_;
+    size_t padded_size_ = 0;
+    uint64_t received_ = 0;
+
+    bool open_j1939_socket(int ifindex);
+    bool open_isotp_sockets(int ifindex);
+    void close_sockets();
+    // Reads every pending payload of one socket; false on a socket error
+    bool receive_payloads(int fd, size_t socket_index);
+    void forward(uint32_t key, uint8_t source_address, uint8_t destination_address, size_t length);
+    void reader_loop();
+
+public:
+    TransportReader(const std::string& interface, TransportProtocol protocol, TransportInbox* inbox);
+    ~TransportReader();
+
+    // Non-copyable
+    TransportReader(const TransportReader&) = delete;
+    TransportReader& operator=(const TransportReader&) = delete;
+
+    // Transport messages of the DBC (DbcDecoder::transport_flows()): J1939
+    // PGN filter or ISO-TP sockets. Must be called before start().
+    void set_flows(std::vector<TransportFlow> flows) { flows_ = std::move(flows); }
+    void set_thread_tuning(const ThreadTuning& tuning) { thread_tuning_ = tuning; }
+
+    // False when the kernel has no socket for the protocol (module not loaded
+    // or headers older than the protocol)
+    bool start(std::shared_ptr<ThreadSafeQueue<CanFrame>> queue);
+    void stop();
+    bool is_running() const { return running_.load(); }
+    uint64_t received() const { return received_; }
+};
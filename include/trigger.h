@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include "can_frame.h"
+
+// Enregistrement sur événement : seules les fenêtres autour des déclenchements
+// sont écrites, dans des fichiers MF4 dédiés
+struct TriggerSettings {
+    std::vector<std::string> expressions;
+    std::chrono::milliseconds pre_trigger{30000};
+    std::chrono::milliseconds post_trigger{10000};
+    size_t buffer_frames = 256 * 1024;   // capacité de l'anneau pré-déclenchement
+
+    bool enabled() const { return !expressions.empty(); }
+};
+
+// Trames brutes des dernières secondes, capacité fixe allouée une fois
+class FrameRing {
+private:
+    std::vector<CanFrame> frames_;
+    size_t head_ = 0;   // prochaine position d'écriture
+    size_t size_ = 0;
+
+public:
+    void reset(size_t capacity) {
+        frames_.assign(capacity, CanFrame{});
+        head_ = 0;
+        size_ = 0;
+    }
+
+    void push(const CanFrame& frame) {
+        if (frames_.empty()) {
+            return;
+        }
+        frames_[head_] = frame;
+        head_ = (head_ + 1) % frames_.size();
+        if (size_ < frames_.size()) {
+            ++size_;
+        }
+    }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return frames_.size(); }
+    bool full() const { return size_ == frames_.size() && size_ > 0; }
+
+    const CanFrame& oldest() const { return frames_[(head_ + frames_.size() - size_) % frames_.size()]; }
+
+    // Calls f on frames with timestamp >= since, oldest first
+    template <typename F>
+    void for_each_since(std::chrono::steady_clock::time_point since, F&& f) const {
+        const size_t start = (head_ + frames_.size() - size_) % frames_.size();
+        for (size_t i = 0; i < size_; ++i) {
+            const CanFrame& frame = frames_[(start + i) % frames_.size()];
+            if (frame.timestamp >= since) {
+                f(frame);
+            }
+        }
+    }
+};
+
+// Expressions de déclenchement sur les signaux DBC :
+//   ABS_Active == 1 && VehicleSpeed > 80 || DTC_Count > 0
+// Opérateurs ==, !=, <, <=, >, >= ; && est prioritaire sur || ; pas de
+// parenthèses. Un signal peut être qualifié par son message (Message.Signal).
+// Chaque expression se déclenche sur front montant.
+class TriggerEngine {
+private:
+    enum class Op { Eq, Ne, Lt, Le, Gt, Ge };
+
+    struct Condition {
+        size_t slot = 0;
+        Op op = Op::Eq;
+        double threshold = 0.0;
+    };
+
+    struct Expression {
+        std::string text;
+        std::vector<std::vector<Condition>> clauses;   // OU de ET
+        bool state = false;
+    };
+
+    struct SignalRef {
+        std::string message;   // vide si non qualifié
+        std::string signal;
+        bool bound = false;
+    };
+
+    std::vector<Expression> expressions_;
+    std::vector<SignalRef> refs_;             // un slot par signal référencé
+    std::vector<double> values_;
+    std::vector<bool> valid_;
+    // CAN ID -> nom du signal -> slots
+    std::unordered_map<uint32_t, std::unordered_map<std::string, std::vector<size_t>>> watched_;
+
+    size_t slot_for(const std::string& name);
+    bool evaluate(const Expression& expression) const;
+
+public:
+    bool add_expression(const std::string& text, std::string& error);
+    bool empty() const { return expressions_.empty(); }
+
+    // Declares a DBC signal; referenced ones are watched
+    void bind_signal(uint32_t can_id, const std::string& message_name, const std::string& signal_name);
+    // Signal references that match nothing in the DBC
+    std::vector<std::string> unbound_signals() const;
+
+    bool watches(uint32_t can_id) const { return watched_.count(can_id) != 0; }
+
+    // Updates the latest values from a decoded message and returns the first
+    // expression that switched from false to true, nullptr otherwise
+    const std::string* update(const CanMessage& message);
+};
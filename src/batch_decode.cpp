@@ -0,0 +1,301 @@
+#include "batch_decode.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <dbcppp/Network.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BATCH_DECODE_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define BATCH_DECODE_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BATCH_DECODE_SSE2 1
+#endif
+
+// La mise à l'échelle doit reproduire RawToPhys à l'arrondi près : pas de
+// contraction implicite en FMA dans ce fichier, la variante fusionnée est
+// explicite (std::fma) et choisie par la sonde si dbcppp l'utilise
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace {
+
+constexpr bool HOST_LITTLE_ENDIAN = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+constexpr unsigned EXHAUSTIVE_BITS = 16;   // vérification de la mise à l'échelle sur toutes les valeurs
+constexpr uint64_t RANDOM_ROUNDS = 256;    // au-delà : RANDOM_ROUNDS * BATCH_MAX_FRAMES valeurs
+
+// Extraction : (mot >> shift) & mask, puis extension du signe par
+// (x ^ sign) - sign. Le mot est déjà dans l'ordre des octets du signal.
+template <bool Signed>
+void extract_block(const uint64_t* words, size_t count, uint32_t shift, uint64_t mask, uint64_t sign, uint64_t* raw) {
+    size_t i = 0;
+#if defined(BATCH_DECODE_NEON)
+    const int64x2_t vshift = vdupq_n_s64(-static_cast<int64_t>(shift));
+    const uint64x2_t vmask = vdupq_n_u64(mask);
+    const uint64x2_t vsign = vdupq_n_u64(sign);
+    for (; i + 2 <= count; i += 2) {
+        uint64x2_t v = vandq_u64(vshlq_u64(vld1q_u64(words + i), vshift), vmask);
+        if (Signed) {
+            v = vsubq_u64(veorq_u64(v, vsign), vsign);
+        }
+        vst1q_u64(raw + i, v);
+    }
+#elif defined(BATCH_DECODE_AVX2)
+    const __m128i vshift = _mm_cvtsi32_si128(static_cast<int>(shift));
+    const __m256i vmask = _mm256_set1_epi64x(static_cast<long long>(mask));
+    const __m256i vsign = _mm256_set1_epi64x(static_cast<long long>(sign));
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+        v = _mm256_and_si256(_mm256_srl_epi64(v, vshift), vmask);
+        if (Signed) {
+            v = _mm256_sub_epi64(_mm256_xor_si256(v, vsign), vsign);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(raw + i), v);
+    }
+#elif defined(BATCH_DECODE_SSE2)
+    const __m128i vshift = _mm_cvtsi32_si128(static_cast<int>(shift));
+    const __m128i vmask = _mm_set1_epi64x(static_cast<long long>(mask));
+    const __m128i vsign = _mm_set1_epi64x(static_cast<long long>(sign));
+    for (; i + 2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+        v = _mm_and_si128(_mm_srl_epi64(v, vshift), vmask);
+        if (Signed) {
+            v = _mm_sub_epi64(_mm_xor_si128(v, vsign), vsign);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(raw + i), v);
+    }
+#endif
+    for (; i < count; ++i) {
+        uint64_t v = (words[i] >> shift) & mask;
+        if (Signed) {
+            v = (v ^ sign) - sign;
+        }
+        raw[i] = v;
+    }
+}
+
+template <bool Signed>
+double to_double(uint64_t raw) {
+    return Signed ? static_cast<double>(static_cast<int64_t>(raw)) : static_cast<double>(raw);
+}
+
+// Produit puis somme, deux arrondis (RawToPhys compilé sans FMA)
+template <bool Signed>
+void scale_block(const uint64_t* raw, size_t count, double factor, double offset, double* values) {
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = to_double<Signed>(raw[i]) * factor + offset;
+    }
+}
+
+// Un seul arrondi (RawToPhys contracté en FMA par le compilateur de dbcppp)
+template <bool Signed>
+void scale_block_fused(const uint64_t* raw, size_t count, double factor, double offset, double* values) {
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = std::fma(to_double<Signed>(raw[i]), factor, offset);
+    }
+}
+
+// Charges de sonde : motifs extrêmes puis pseudo-aléatoires (splitmix64)
+void fill_probes(uint64_t* probes, size_t count, uint64_t seed = 0) {
+    static const uint64_t PATTERNS[] = {
+        0x0000000000000000ull, 0xFFFFFFFFFFFFFFFFull, 0x5555555555555555ull, 0xAAAAAAAAAAAAAAAAull,
+        0x0123456789ABCDEFull, 0x8000000000000001ull, 0x7FFFFFFFFFFFFFFEull, 0x00FF00FF00FF00FFull,
+    };
+    const size_t pattern_count = seed == 0 ? sizeof(PATTERNS) / sizeof(PATTERNS[0]) : 0;
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ (seed * 0xD1B54A32D192ED03ull);
+    for (size_t i = 0; i < count; ++i) {
+        if (i < pattern_count) {
+            probes[i] = PATTERNS[i];
+            continue;
+        }
+        state += 0x9E3779B97F4A7C15ull;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        probes[i] = z ^ (z >> 31);
+    }
+}
+
+uint64_t to_signal_order(uint64_t word, bool big_endian) {
+    // Mot lu par memcpy des octets de la trame : ordre de l'hôte
+    return big_endian == HOST_LITTLE_ENDIAN ? __builtin_bswap64(word) : word;
+}
+
+}  // namespace
+
+bool BatchDecodePlan::compile_kernel(const dbcppp::ISignal& signal, Kernel& kernel) {
+    kernel.signal = &signal;
+    kernel.factor = signal.Factor();
+    kernel.offset = signal.Offset();
+
+    const uint64_t start = signal.StartBit();
+    const uint64_t length = signal.BitSize();
+    if (signal.ExtendedValueType() != dbcppp::ISignal::EExtendedValueType::Integer || length == 0 || length > 64) {
+        return false;
+    }
+
+    kernel.big_endian = signal.ByteOrder() == dbcppp::ISignal::EByteOrder::BigEndian;
+    if (kernel.big_endian) {
+        // Start bit Motorola = MSB en numérotation dent de scie ; dans le mot
+        // big-endian l'octet 0 occupe les bits 56..63
+        if (start >= 64) {
+            return false;
+        }
+        const uint64_t msb = (7 - start / 8) * 8 + start % 8;
+        if (msb + 1 < length) {
+            return false;
+        }
+        kernel.shift = static_cast<uint32_t>(msb + 1 - length);
+    } else {
+        if (start + length > 64) {
+            return false;
+        }
+        kernel.shift = static_cast<uint32_t>(start);
+    }
+    kernel.mask = length == 64 ? ~0ull : (1ull << length) - 1;
+
+    const bool is_signed = signal.ValueType() == dbcppp::ISignal::EValueType::Signed;
+    kernel.sign = is_signed ? 1ull << (length - 1) : 0;
+    kernel.extract = is_signed ? &extract_block<true> : &extract_block<false>;
+    kernel.scale = is_signed ? &scale_block<true> : &scale_block<false>;
+    return true;
+}
+
+bool BatchDecodePlan::verify_kernel(Kernel& kernel) {
+    const dbcppp::ISignal& signal = *kernel.signal;
+    uint64_t probes[BATCH_MAX_FRAMES];
+    uint64_t ordered[BATCH_MAX_FRAMES];
+    uint64_t raw[BATCH_MAX_FRAMES];
+    double values[BATCH_MAX_FRAMES];
+    fill_probes(probes, BATCH_MAX_FRAMES);
+    for (size_t i = 0; i < BATCH_MAX_FRAMES; ++i) {
+        ordered[i] = to_signal_order(probes[i], kernel.big_endian);
+    }
+
+    kernel.extract(ordered, BATCH_MAX_FRAMES, kernel.shift, kernel.mask, kernel.sign, raw);
+    for (size_t i = 0; i < BATCH_MAX_FRAMES; ++i) {
+        if (raw[i] != signal.Decode(&probes[i])) {
+            kernel.extract = nullptr;
+            kernel.scale = nullptr;
+            return false;
+        }
+    }
+
+    // Mise à l'échelle : chaque variante est comparée à RawToPhys sur toutes
+    // les valeurs brutes jusqu'à EXHAUSTIVE_BITS bits, au-delà sur des
+    // valeurs pseudo-aléatoires ; la variante non fusionnée l'emporte si les
+    // deux conviennent (produit exact)
+    const bool is_signed = kernel.sign != 0;
+    const ScaleFn candidates[2] = {
+        is_signed ? &scale_block<true> : &scale_block<false>,
+        is_signed ? &scale_block_fused<true> : &scale_block_fused<false>,
+    };
+    bool identical[2] = {true, true};
+    auto check = [&](const uint64_t* raws, size_t count) {
+        double expected[BATCH_MAX_FRAMES];
+        for (size_t i = 0; i < count; ++i) {
+            expected[i] = signal.RawToPhys(raws[i]);
+        }
+        for (size_t c = 0; c < 2; ++c) {
+            if (identical[c]) {
+                candidates[c](raws, count, kernel.factor, kernel.offset, values);
+                identical[c] = std::memcmp(values, expected, count * sizeof(double)) == 0;
+            }
+        }
+        return identical[0] || identical[1];
+    };
+
+    bool any = check(raw, BATCH_MAX_FRAMES);
+    if (kernel.mask < (1ull << EXHAUSTIVE_BITS)) {
+        for (uint64_t first = 0; any && first <= kernel.mask; first += BATCH_MAX_FRAMES) {
+            const size_t count = static_cast<size_t>(std::min<uint64_t>(BATCH_MAX_FRAMES, kernel.mask - first + 1));
+            for (size_t i = 0; i < count; ++i) {
+                raw[i] = is_signed ? ((first + i) ^ kernel.sign) - kernel.sign : first + i;
+            }
+            any = check(raw, count);
+        }
+    } else {
+        for (uint64_t round = 1; any && round <= RANDOM_ROUNDS; ++round) {
+            fill_probes(probes, BATCH_MAX_FRAMES, round);
+            kernel.extract(probes, BATCH_MAX_FRAMES, kernel.shift, kernel.mask, kernel.sign, raw);
+            any = check(raw, BATCH_MAX_FRAMES);
+        }
+    }
+    kernel.scale = identical[0] ? candidates[0] : identical[1] ? candidates[1] : nullptr;
+    return true;
+}
+
+bool BatchDecodePlan::build(const MuxLayout& layout, const std::vector<uint32_t>& indexes) {
+    kernels_.clear();
+    signals_.clear();
+    needs_swap_ = false;
+    vector_signals_ = 0;
+
+    for (size_t i = 0; i < layout.signals.size(); ++i) {
+        const dbcppp::ISignal* signal = layout.signals[i];
+        Kernel kernel;
+        if (compile_kernel(*signal, kernel) && verify_kernel(kernel)) {
+            needs_swap_ = needs_swap_ || kernel.big_endian == HOST_LITTLE_ENDIAN;
+            if (kernel.scale) {
+                ++vector_signals_;
+            }
+        } else {
+            kernel.extract = nullptr;
+            kernel.scale = nullptr;
+        }
+        kernels_.push_back(kernel);
+        signals_.push_back({signal->Name(), signal->Unit(), i < indexes.size() ? indexes[i] : UINT32_MAX});
+    }
+    return !kernels_.empty();
+}
+
+void BatchDecodePlan::decode_signal(const Kernel& kernel, const uint64_t* words, const uint64_t* swapped,
+                                    size_t count, uint64_t* raw, double* values) const {
+    if (kernel.extract) {
+        kernel.extract(kernel.big_endian == HOST_LITTLE_ENDIAN ? swapped : words,
+                       count, kernel.shift, kernel.mask, kernel.sign, raw);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            raw[i] = kernel.signal->Decode(&words[i]);
+        }
+    }
+    if (kernel.scale) {
+        kernel.scale(raw, count, kernel.factor, kernel.offset, values);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = kernel.signal->RawToPhys(raw[i]);
+        }
+    }
+}
+
+void BatchDecodePlan::decode(const uint64_t* words, size_t count, double* values) const {
+    // Un seul échange d'octets par trame, partagé par les signaux de l'autre ordre
+    uint64_t swapped[BATCH_MAX_FRAMES];
+    uint64_t raw[BATCH_MAX_FRAMES];
+    if (needs_swap_) {
+        for (size_t i = 0; i < count; ++i) {
+            swapped[i] = __builtin_bswap64(words[i]);
+        }
+    }
+    for (size_t s = 0; s < kernels_.size(); ++s) {
+        decode_signal(kernels_[s], words, swapped, count, raw, values + s * BATCH_MAX_FRAMES);
+    }
+}
+
+const char* BatchDecodePlan::kernel_isa() {
+#if defined(BATCH_DECODE_NEON)
+    return "NEON";
+#elif defined(BATCH_DECODE_AVX2)
+    return "AVX2";
+#elif defined(BATCH_DECODE_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,299 @@
+#include "bus_stats.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <linux/can/error.h>
+#include <dbcppp/Network.h>
+
+// Noyaux anciens : bits ajoutés après les premières versions de can/error.h
+#ifndef CAN_ERR_CRTL_ACTIVE
+#define CAN_ERR_CRTL_ACTIVE 0x40
+#endif
+#ifndef CAN_ERR_CNT
+#define CAN_ERR_CNT 0x00000200U
+#endif
+
+const BusStatsChannelInfo BUS_STATS_CHANNELS[BUS_STATS_CHANNEL_COUNT] = {
+    {"bus_load", "%"},
+    {"bus_load_peak", "%"},
+    {"frames_per_second", "1/s"},
+    {"error_frames", ""},
+    {"err_tx_timeout", ""},
+    {"err_lost_arbitration", ""},
+    {"err_controller", ""},
+    {"err_protocol", ""},
+    {"err_transceiver", ""},
+    {"err_no_ack", ""},
+    {"err_bus_off", ""},
+    {"err_bus_error", ""},
+    {"err_restarted", ""},
+    {"bus_state", ""},
+    {"error_passive_transitions", ""},
+    {"bus_off_transitions", ""},
+    {"tx_error_counter", ""},
+    {"rx_error_counter", ""},
+    {"socket_drops", ""},
+};
+
+namespace {
+
+// Délimiteur CRC, ACK et son délimiteur, EOF et espace inter-trame : jamais bourrés
+constexpr uint32_t FRAME_TAIL_BITS = 1 + 2 + 7 + 3;
+
+}  // namespace
+
+BusStatistics::BusStatistics(const std::string& interface_name, uint32_t bitrate)
+    : interface_name_(interface_name)
+    , bitrate_(bitrate > 0 ? bitrate : 500000) {
+}
+
+uint32_t BusStatistics::frame_bits(const struct can_frame& frame) {
+    const bool extended = (frame.can_id & CAN_EFF_FLAG) != 0;
+    const bool remote = (frame.can_id & CAN_RTR_FLAG) != 0;
+    const uint32_t dlc = std::min<uint32_t>(frame.can_dlc, CAN_MAX_DLEN);
+    const uint32_t data_bytes = remote ? 0 : dlc;
+
+    // Flux de bits de SOF à la fin du CRC (118 bits au plus), MSB en premier
+    uint8_t bits[128];
+    size_t count = 0;
+    auto push = [&](uint32_t value, int width) {
+        for (int bit = width - 1; bit >= 0; --bit) {
+            bits[count++] = static_cast<uint8_t>((value >> bit) & 1u);
+        }
+    };
+
+    push(0, 1);  // SOF
+    if (extended) {
+        const uint32_t id = frame.can_id & CAN_EFF_MASK;
+        push(id >> 18, 11);
+        push(1, 1);  // SRR
+        push(1, 1);  // IDE
+        push(id & 0x3FFFF, 18);
+        push(remote ? 1 : 0, 1);
+        push(0, 2);  // r1, r0
+    } else {
+        push(frame.can_id & CAN_SFF_MASK, 11);
+        push(remote ? 1 : 0, 1);
+        push(0, 2);  // IDE, r0
+    }
+    push(dlc, 4);
+    for (uint32_t i = 0; i < data_bytes; ++i) {
+        push(frame.data[i], 8);
+    }
+
+    // CRC-15 CAN (polynôme 0x4599)
+    uint32_t crc = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t next = bits[i] ^ ((crc >> 14) & 1u);
+        crc = (crc << 1) & 0x7FFF;
+        if (next) {
+            crc ^= 0x4599;
+        }
+    }
+    push(crc, 15);
+
+    // Un bit de bourrage après 5 bits identiques ; il compte dans la suite
+    uint32_t stuff_bits = 0;
+    uint8_t last = 2;
+    int run = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (bits[i] != last) {
+            last = bits[i];
+            run = 1;
+        } else if (++run == 5) {
+            ++stuff_bits;
+            last = static_cast<uint8_t>(last ^ 1u);
+            run = 1;
+        }
+    }
+
+    return static_cast<uint32_t>(count) + stuff_bits + FRAME_TAIL_BITS;
+}
+
+void BusStatistics::advance(std::chrono::steady_clock::time_point now) {
+    if (!started_) {
+        started_ = true;
+        origin_ = now;
+        interval_start_ = now;
+        current_slot_ = 0;
+        return;
+    }
+    if (now < origin_) {
+        return;
+    }
+    const uint64_t slot = static_cast<uint64_t>((now - origin_) / SLOT_DURATION);
+    if (slot <= current_slot_) {
+        return;
+    }
+    peak_slot_bits_ = std::max(peak_slot_bits_, slot_bits_[current_slot_ % LOAD_SLOTS]);
+    const uint64_t last = std::min<uint64_t>(slot, current_slot_ + LOAD_SLOTS);
+    for (uint64_t skipped = current_slot_ + 1; skipped <= last; ++skipped) {
+        slot_bits_[skipped % LOAD_SLOTS] = 0;
+    }
+    current_slot_ = slot;
+}
+
+void BusStatistics::set_state(BusState state) {
+    if (state == state_) {
+        return;
+    }
+    if (state == BusState::ErrorPassive && state_ < BusState::ErrorPassive) {
+        ++error_passive_transitions_;
+    }
+    if (state == BusState::BusOff) {
+        ++bus_off_transitions_;
+    }
+    state_ = state;
+}
+
+void BusStatistics::on_frame(const struct can_frame& frame, std::chrono::steady_clock::time_point timestamp) {
+    advance(timestamp);
+    slot_bits_[current_slot_ % LOAD_SLOTS] += frame_bits(frame);
+    ++interval_frames_;
+    // Même représentation que les IDs du DBC : CAN_EFF_FLAG gardé, RTR retiré
+    ++interval_id_frames_[frame.can_id & (CAN_EFF_FLAG | CAN_EFF_MASK)];
+}
+
+void BusStatistics::on_error_frame(const struct can_frame& frame, std::chrono::steady_clock::time_point timestamp) {
+    advance(timestamp);
+    ++interval_error_frames_;
+    const uint32_t classes = frame.can_id & CAN_ERR_MASK;
+    for (size_t bit = 0; bit < interval_error_classes_.size(); ++bit) {
+        if (classes & (1u << bit)) {
+            ++interval_error_classes_[bit];
+        }
+    }
+
+    if (classes & CAN_ERR_BUSOFF) {
+        set_state(BusState::BusOff);
+    } else if (classes & CAN_ERR_RESTARTED) {
+        set_state(BusState::ErrorActive);
+    } else if (classes & CAN_ERR_CRTL) {
+        const uint8_t controller = frame.data[1];
+        if (controller & (CAN_ERR_CRTL_RX_PASSIVE | CAN_ERR_CRTL_TX_PASSIVE)) {
+            set_state(BusState::ErrorPassive);
+        } else if (controller & (CAN_ERR_CRTL_RX_WARNING | CAN_ERR_CRTL_TX_WARNING)) {
+            set_state(BusState::ErrorWarning);
+        } else if (controller & CAN_ERR_CRTL_ACTIVE) {
+            set_state(BusState::ErrorActive);
+        }
+    }
+    // Compteurs TEC/REC : signalés par CAN_ERR_CNT, ou avec l'état contrôleur sur les pilotes plus anciens
+    if (classes & (CAN_ERR_CNT | CAN_ERR_CRTL)) {
+        tx_error_counter_ = frame.data[6];
+        rx_error_counter_ = frame.data[7];
+    }
+}
+
+void BusStatistics::publish(std::chrono::steady_clock::time_point now) {
+    advance(now);
+
+    const double interval_s = std::chrono::duration<double>(now - interval_start_).count();
+    const double slot_s = std::chrono::duration<double>(SLOT_DURATION).count();
+
+    uint64_t window_bits = 0;
+    for (uint64_t bits : slot_bits_) {
+        window_bits += bits;
+    }
+    // Tranche en cours comprise : la pointe est une borne basse tant qu'elle n'est pas terminée
+    const uint64_t peak_bits = std::max(peak_slot_bits_, slot_bits_[current_slot_ % LOAD_SLOTS]);
+
+    BusStatsSnapshot snapshot;
+    snapshot.timestamp = now;
+    auto& values = snapshot.values;
+    // Fenêtre exacte : tranches complètes conservées plus la partie écoulée de la tranche en cours
+    const auto current_start = origin_ + SLOT_DURATION * current_slot_;
+    const double span_s = std::max(
+        static_cast<double>(std::min<uint64_t>(current_slot_, LOAD_SLOTS - 1)) * slot_s
+            + std::chrono::duration<double>(now - current_start).count(),
+        slot_s);
+    values[BUS_LOAD] = 100.0 * static_cast<double>(window_bits) / (static_cast<double>(bitrate_) * span_s);
+    values[BUS_LOAD_PEAK] = 100.0 * static_cast<double>(peak_bits) / (static_cast<double>(bitrate_) * slot_s);
+    values[BUS_FRAMES_PER_SECOND] = interval_s > 0.0 ? static_cast<double>(interval_frames_) / interval_s : 0.0;
+    values[BUS_ERROR_FRAMES] = static_cast<double>(interval_error_frames_);
+    for (size_t bit = 0; bit < interval_error_classes_.size(); ++bit) {
+        values[BUS_ERR_TX_TIMEOUT + bit] = static_cast<double>(interval_error_classes_[bit]);
+    }
+    values[BUS_STATE] = static_cast<double>(state_);
+    values[BUS_ERROR_PASSIVE_TRANSITIONS] = static_cast<double>(error_passive_transitions_);
+    values[BUS_OFF_TRANSITIONS] = static_cast<double>(bus_off_transitions_);
+    values[BUS_TX_ERROR_COUNTER] = tx_error_counter_;
+    values[BUS_RX_ERROR_COUNTER] = rx_error_counter_;
+    values[BUS_SOCKET_DROPS] = static_cast<double>(socket_drops_);
+    if (interval_s > 0.0) {
+        for (const auto& [can_id, frames] : interval_id_frames_) {
+            snapshot.id_rates.emplace(can_id, static_cast<double>(frames) / interval_s);
+        }
+    }
+
+    interval_start_ = now;
+    interval_frames_ = 0;
+    interval_error_frames_ = 0;
+    interval_error_classes_.fill(0);
+    interval_id_frames_.clear();
+    peak_slot_bits_ = 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    published_ = std::move(snapshot);
+    has_published_ = true;
+}
+
+bool BusStatistics::take_snapshot(BusStatsSnapshot& snapshot) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!has_published_) {
+        return false;
+    }
+    snapshot = published_;
+    return true;
+}
+
+void BusStatistics::to_messages(const BusStatsSnapshot& snapshot, const std::vector<uint32_t>& rate_ids,
+                                CanMessage& stats, CanMessage& rates) {
+    stats.can_id = BUS_STATS_CAN_ID;
+    stats.layout_id = 0;
+    stats.timestamp = snapshot.timestamp;
+    stats.signals.clear();
+    stats.signals.reserve(BUS_STATS_CHANNEL_COUNT);
+    for (size_t i = 0; i < BUS_STATS_CHANNEL_COUNT; ++i) {
+        stats.signals.emplace_back(BUS_STATS_CAN_ID, BUS_STATS_CHANNELS[i].name, snapshot.values[i],
+                                   BUS_STATS_CHANNELS[i].unit, snapshot.timestamp);
+    }
+
+    rates.can_id = BUS_RATES_CAN_ID;
+    rates.layout_id = 0;
+    rates.timestamp = snapshot.timestamp;
+    rates.signals.clear();
+    rates.signals.reserve(rate_ids.size() + 1);
+    double other = 0.0;
+    for (const auto& [can_id, rate] : snapshot.id_rates) {
+        if (!std::binary_search(rate_ids.begin(), rate_ids.end(), can_id)) {
+            other += rate;
+        }
+    }
+    for (uint32_t can_id : rate_ids) {
+        auto it = snapshot.id_rates.find(can_id);
+        rates.signals.emplace_back(BUS_RATES_CAN_ID, bus_rate_channel_name(can_id),
+                                   it != snapshot.id_rates.end() ? it->second : 0.0, "1/s", snapshot.timestamp);
+    }
+    rates.signals.emplace_back(BUS_RATES_CAN_ID, BUS_RATE_OTHER_CHANNEL, other, "1/s", snapshot.timestamp);
+}
+
+std::vector<uint32_t> bus_rate_ids(const dbcppp::INetwork& network) {
+    std::vector<uint32_t> ids;
+    for (const auto& message : network.Messages()) {
+        ids.push_back(static_cast<uint32_t>(message.Id()));
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+std::string bus_rate_channel_name(uint32_t can_id) {
+    std::ostringstream oss;
+    if (can_id & CAN_EFF_FLAG) {
+        oss << "fps_0x" << std::hex << std::uppercase << std::setw(8) << std::setfill('0') << (can_id & CAN_EFF_MASK);
+    } else {
+        oss << "fps_0x" << std::hex << std::uppercase << std::setw(3) << std::setfill('0') << (can_id & CAN_SFF_MASK);
+    }
+    return oss.str();
+}
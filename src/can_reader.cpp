@@ -6,9 +6,17 @@
 #include <linux/can/raw.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <cstring>
 #include <iostream>
 #include <chrono>
+#include "signal_handler.h"
+#include "bus_stats.h"
+
+static constexpr int READ_BATCH_FRAMES = 256;
+static constexpr int STOP_DRAIN_FRAMES = 16 * READ_BATCH_FRAMES;
 
 CanReader::CanReader(const std::string& interface) 
     : interface_name_(interface)
@@ -21,6 +29,7 @@ CanReader::~CanReader() {
 }
 
 bool CanReader::open_can_socket() {
+    std::lock_guard<std::mutex> lock(filter_mutex_);
     socket_fd_ = socket(PF_CAN, SOCK_RAW, CAN_RAW);
     if (socket_fd_ < 0) {
         std::cerr << "Error creating CAN socket: " << strerror(errno) << std::endl;
@@ -39,6 +48,24 @@ bool CanReader::open_can_socket() {
         return false;
     }
 
+    if (!apply_id_filter()) {
+        close(socket_fd_);
+        socket_fd_ = -1;
+        return false;
+    }
+
+    if (bus_stats_) {
+        // Trames d'erreur du contrôleur et compteur de trames perdues par le socket
+        const can_err_mask_t error_mask = CAN_ERR_MASK;
+        if (setsockopt(socket_fd_, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &error_mask, sizeof(error_mask)) < 0) {
+            std::cerr << "Warning: cannot enable CAN error frames: " << strerror(errno) << std::endl;
+        }
+        const int enable = 1;
+        if (setsockopt(socket_fd_, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) < 0) {
+            std::cerr << "Warning: cannot enable SO_RXQ_OVFL: " << strerror(errno) << std::endl;
+        }
+    }
+
     struct sockaddr_can addr;
     addr.can_family = AF_CAN;
     addr.can_ifindex = ifr.ifr_ifindex;
@@ -63,49 +90,221 @@ bool CanReader::open_can_socket() {
     return true;
 }
 
+bool CanReader::apply_id_filter() {
+    if (id_filter_.empty()) {
+        return true;
+    }
+
+    if (id_filter_.size() > CAN_RAW_FILTER_MAX) {
+        std::cerr << "Warning: " << id_filter_.size() << " selected CAN IDs exceed CAN_RAW_FILTER_MAX ("
+                  << CAN_RAW_FILTER_MAX << "), kernel filtering disabled" << std::endl;
+        return true;
+    }
+
+    std::vector<struct can_filter> filters;
+    filters.reserve(id_filter_.size());
+    for (uint32_t can_id : id_filter_) {
+        struct can_filter filter;
+        filter.can_id = can_id;
+        if (can_id & CAN_EFF_FLAG) {
+            filter.can_mask = CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_EFF_MASK;
+        } else {
+            filter.can_mask = CAN_EFF_FLAG | CAN_RTR_FLAG | CAN_SFF_MASK;
+        }
+        filters.push_back(filter);
+    }
+
+    if (setsockopt(socket_fd_, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(),
+                   static_cast<socklen_t>(filters.size() * sizeof(struct can_filter))) < 0) {
+        std::cerr << "Error setting CAN_RAW_FILTER: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::cout << "Kernel CAN filter installed for " << filters.size() << " IDs" << std::endl;
+    return true;
+}
+
+void CanReader::update_id_filter(std::vector<uint32_t> can_ids) {
+    // Socket fermé : le filtre sera installé à la prochaine ouverture
+    std::lock_guard<std::mutex> lock(filter_mutex_);
+    id_filter_ = std::move(can_ids);
+    if (socket_fd_ < 0) {
+        return;
+    }
+
+    if (id_filter_.empty() || id_filter_.size() > CAN_RAW_FILTER_MAX) {
+        // Retour au filtre par défaut du noyau : tous les IDs
+        struct can_filter accept_all;
+        accept_all.can_id = 0;
+        accept_all.can_mask = 0;
+        if (setsockopt(socket_fd_, SOL_CAN_RAW, CAN_RAW_FILTER, &accept_all, sizeof(accept_all)) < 0) {
+            std::cerr << "Error resetting CAN_RAW_FILTER: " << strerror(errno) << std::endl;
+        }
+    }
+    apply_id_filter();
+}
+
 void CanReader::close_can_socket() {
-    if (socket_fd_ >= 0) {
-        close(socket_fd_);
-        socket_fd_ = -1;
+    {
+        std::lock_guard<std::mutex> lock(filter_mutex_);
+        if (socket_fd_ >= 0) {
+            close(socket_fd_);
+            socket_fd_ = -1;
+        }
+    }
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+    if (stop_fd_ >= 0) {
+        close(stop_fd_);
+        stop_fd_ = -1;
+    }
+    if (timer_fd_ >= 0) {
+        close(timer_fd_);
+        timer_fd_ = -1;
     }
 }
 
+ssize_t CanReader::receive_frame(struct can_frame& frame) {
+    if (!bus_stats_) {
+        return read(socket_fd_, &frame, sizeof(struct can_frame));
+    }
+
+    struct iovec iov;
+    iov.iov_base = &frame;
+    iov.iov_len = sizeof(struct can_frame);
+    alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint32_t))];
+    struct msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    const ssize_t nbytes = recvmsg(socket_fd_, &message, 0);
+    if (nbytes > 0) {
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t drops = 0;
+                std::memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                bus_stats_->set_socket_drops(drops);
+            }
+        }
+    }
+    return nbytes;
+}
+
+void CanReader::handle_frame(const struct can_frame& frame) {
+    if (frame.can_id & CAN_ERR_FLAG) {
+        if (bus_stats_) {
+            bus_stats_->on_error_frame(frame, std::chrono::steady_clock::now());
+        }
+        return;
+    }
+
+    CanFrame can_frame(frame);
+    if (bus_stats_) {
+        bus_stats_->on_frame(frame, can_frame.timestamp);
+    }
+    if (queue_full_) {
+        if (queue_drops_.fetch_add(1) == 0) {
+            std::cerr << "⚠️  Raw frame queue full (" << max_queued_ << " frames), dropping CAN frames" << std::endl;
+        }
+        return;
+    }
+    output_queue_->push(std::move(can_frame));
+}
+
+void CanReader::publish_bus_statistics() {
+    uint64_t expirations = 0;
+    ssize_t rc = read(timer_fd_, &expirations, sizeof(expirations));
+    (void)rc;
+
+    const auto now = std::chrono::steady_clock::now();
+    bus_stats_->publish(now);
+
+    // Le décodeur écrit les statistiques à cette position du flux
+    CanFrame marker;
+    marker.can_id = BUS_STATS_FRAME_ID;
+    marker.can_dlc = 0;
+    std::memset(marker.data, 0, sizeof(marker.data));
+    marker.timestamp = now;
+    output_queue_->push(std::move(marker));
+}
+
 void CanReader::reader_loop() {
     struct can_frame frame;
-    fd_set read_fds;
-    struct timeval timeout;
+    struct epoll_event events[3];
     
+    apply_thread_tuning("can-reader", thread_tuning_);
     std::cout << "CAN Reader thread started" << std::endl;
 
-    while (running_.load()) {
-        FD_ZERO(&read_fds);
-        FD_SET(socket_fd_, &read_fds);
-        
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 100000; // 100ms timeout
+    // Aucune échéance : le thread dort jusqu'à une trame ou une demande d'arrêt
+    bool failed = false;
+    while (running_.load() && !failed) {
+        const int count = epoll_wait(epoll_fd_, events, 3, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "CAN epoll error: " << strerror(errno) << std::endl;
+            failed = true;
+            break;
+        }
 
-        int select_result = select(socket_fd_ + 1, &read_fds, nullptr, nullptr, &timeout);
-        
-        if (select_result > 0 && FD_ISSET(socket_fd_, &read_fds)) {
-            ssize_t nbytes = read(socket_fd_, &frame, sizeof(struct can_frame));
-            
-            if (nbytes == sizeof(struct can_frame)) {
-                CanFrame can_frame(frame);
-                output_queue_->push(std::move(can_frame));
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == timer_fd_) {
+                publish_bus_statistics();
+                continue;
+            }
+            if (events[i].data.fd != socket_fd_) {
+                continue;  // stop_fd_ : running_ est déjà à false
+            }
+
+            // Socket non bloquant : lecture par lots, epoll (niveau) rappelle s'il en reste.
+            // File bornée : un seul test de taille par lot (décodeur occupé à ouvrir un fichier)
+            queue_full_ = max_queued_ > 0 && output_queue_->size() >= max_queued_;
+            for (int batch = 0; batch < READ_BATCH_FRAMES; ++batch) {
+                ssize_t nbytes = receive_frame(frame);
                 
-                // Debug: Log occasionally
-                static int frame_count = 0;
-                if (++frame_count % 500 == 0) {
-                    std::cout << "Read " << frame_count << " CAN frames, last ID: 0x" 
-                              << std::hex << frame.can_id << std::dec << std::endl;
+                if (nbytes == sizeof(struct can_frame)) {
+                    handle_frame(frame);
+                    
+                    // Debug: Log occasionally
+                    static int frame_count = 0;
+                    if (++frame_count % 500 == 0) {
+                        std::cout << "Read " << frame_count << " CAN frames, last ID: 0x" 
+                                  << std::hex << frame.can_id << std::dec << std::endl;
+                    }
+                } else if (nbytes < 0 && errno == EINTR) {
+                    continue;
+                } else if (nbytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    break;
+                } else {
+                    std::cerr << "CAN read error: " << (nbytes < 0 ? strerror(errno) : "short frame") << std::endl;
+                    failed = true;
+                    break;
                 }
-            } else if (nbytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-                std::cerr << "CAN read error: " << strerror(errno) << std::endl;
-                break;
             }
-        } else if (select_result < 0 && errno != EINTR) {
-            std::cerr << "CAN select error: " << strerror(errno) << std::endl;
-            break;
+        }
+    }
+
+    if (failed) {
+        // Plus de lecture possible : arrêt ordonné de tout le collecteur
+        SignalHandler::request_shutdown();
+    } else {
+        // Trames déjà reçues par le noyau avant l'arrêt : elles passent encore
+        // dans le pipeline (borné, le bus continue d'émettre)
+        int drained = 0;
+        queue_full_ = max_queued_ > 0 && output_queue_->size() >= max_queued_;
+        while (drained < STOP_DRAIN_FRAMES
+               && receive_frame(frame) == sizeof(struct can_frame)) {
+            handle_frame(frame);
+            ++drained;
+        }
+        if (drained > 0) {
+            std::cout << "CAN Reader flushed " << drained << " frames from the socket buffer" << std::endl;
         }
     }
 
@@ -129,6 +328,41 @@ bool CanReader::start(std::shared_ptr<ThreadSafeQueue<CanFrame>> queue) {
         return false;
     }
 
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ < 0 || stop_fd_ < 0) {
+        std::cerr << "Error creating CAN reader event descriptors: " << strerror(errno) << std::endl;
+        close_can_socket();
+        return false;
+    }
+    if (bus_stats_) {
+        // Réveil à cadence fixe, y compris bus silencieux (le silence est une information)
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        struct itimerspec period;
+        std::memset(&period, 0, sizeof(period));
+        period.it_interval.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(BusStatistics::PUBLISH_INTERVAL).count();
+        period.it_value = period.it_interval;
+        if (timer_fd_ < 0 || timerfd_settime(timer_fd_, 0, &period, nullptr) < 0) {
+            std::cerr << "Error creating bus statistics timer: " << strerror(errno) << std::endl;
+            close_can_socket();
+            return false;
+        }
+    }
+    for (int fd : {socket_fd_, stop_fd_, timer_fd_}) {
+        if (fd < 0) {
+            continue;
+        }
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            std::cerr << "Error registering CAN reader descriptor: " << strerror(errno) << std::endl;
+            close_can_socket();
+            return false;
+        }
+    }
+
     running_.store(true);
     reader_thread_ = std::make_unique<std::thread>(&CanReader::reader_loop, this);
     
@@ -138,6 +372,11 @@ bool CanReader::start(std::shared_ptr<ThreadSafeQueue<CanFrame>> queue) {
 void CanReader::stop() {
     if (running_.load()) {
         running_.store(false);
+
+        // Réveille epoll_wait immédiatement
+        const uint64_t one = 1;
+        ssize_t rc = write(stop_fd_, &one, sizeof(one));
+        (void)rc;
         
         if (reader_thread_ && reader_thread_->joinable()) {
             reader_thread_->join();
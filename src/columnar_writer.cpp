@@ -0,0 +1,315 @@
+#include "columnar_writer.h"
+#include "retention_manager.h"
+#include "signal_handler.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <filesystem>
+#include <cstring>
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <unistd.h>
+
+ColumnarWriter::ColumnarWriter(const std::string& output_dir)
+    : output_directory_(output_dir) {
+    std::filesystem::create_directories(output_directory_);
+}
+
+ColumnarWriter::~ColumnarWriter() {
+    stop();
+}
+
+std::string ColumnarWriter::generate_filename() const {
+    auto now = std::chrono::system_clock::now();
+    auto time_t = std::chrono::system_clock::to_time_t(now);
+    auto tm = *std::localtime(&time_t);
+
+    std::ostringstream oss;
+    oss << file_prefix_ << std::put_time(&tm, "%Y%m%d_%H%M%S");
+    const std::string stem = oss.str();
+
+    auto path = std::filesystem::path(output_directory_) / (stem + columnar::FILE_EXTENSION);
+    for (int index = 1; std::filesystem::exists(path); ++index) {
+        path = std::filesystem::path(output_directory_) / (stem + "_" + std::to_string(index) + columnar::FILE_EXTENSION);
+    }
+    return path.string();
+}
+
+bool ColumnarWriter::start() {
+    if (fd_ >= 0) {
+        std::cerr << "Columnar writer already started" << std::endl;
+        return false;
+    }
+    return create_new_file();
+}
+
+void ColumnarWriter::stop() {
+    close_current_file();
+}
+
+bool ColumnarWriter::write_all(const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    size_t written = 0;
+    while (written < size) {
+        const ssize_t count = write(fd_, bytes + written, size - written);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            std::cerr << "Columnar write error on " << current_file_path_ << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        written += static_cast<size_t>(count);
+    }
+    file_offset_ += size;
+    storage_.notify_written(size);
+    return true;
+}
+
+bool ColumnarWriter::create_new_file() {
+    close_current_file();
+    // Demande d'une rotation MF4 antérieure au nouveau fichier
+    rotation_requested_.store(false);
+
+    current_file_path_ = generate_filename();
+    fd_ = open(current_file_path_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Cannot create columnar file " << current_file_path_ << ": " << strerror(errno) << std::endl;
+        if (retention_) {
+            retention_->request_check();
+        }
+        return false;
+    }
+
+    const auto system_now = std::chrono::system_clock::now();
+    const auto steady_now = std::chrono::steady_clock::now();
+    const int64_t system_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(system_now.time_since_epoch()).count();
+    epoch_offset_ns_ = system_ns
+        - std::chrono::duration_cast<std::chrono::nanoseconds>(steady_now.time_since_epoch()).count();
+
+    ColumnarFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, columnar::FILE_MAGIC, sizeof(header.magic));
+    header.version = columnar::FORMAT_VERSION;
+    header.header_size = sizeof(header);
+    header.created_ns = system_ns;
+
+    file_offset_ = 0;
+    buffered_bytes_ = 0;
+    storage_.open(current_file_path_, storage_policy_.rotation_bytes + PREALLOCATION_SLACK, storage_policy_);
+    if (!write_all(&header, sizeof(header))) {
+        close_current_file();
+        return false;
+    }
+    if (retention_) {
+        retention_->notify_file_opened(current_file_path_);
+    }
+
+    std::cout << "Created new columnar file: " << current_file_path_ << std::endl;
+    return true;
+}
+
+void ColumnarWriter::close_current_file() {
+    if (fd_ < 0) {
+        return;
+    }
+
+    const bool finalized = flush_chunk() && write_footer();
+    close(fd_);
+    fd_ = -1;
+    storage_.close();
+
+    if (retention_) {
+        retention_->notify_file_closed(current_file_path_);
+    }
+    std::cout << "Closed columnar file: " << current_file_path_ << " (size: " << file_offset_ << " bytes, "
+              << file_columns_.size() << " signals" << (finalized ? "" : ", NOT finalized") << ")" << std::endl;
+
+    for (uint32_t index : file_columns_) {
+        Column& column = columns_[index];
+        column.in_file = false;
+        column.timestamps.clear();
+        column.values.clear();
+        column.segments.clear();
+        column.sample_count = 0;
+    }
+    file_columns_.clear();
+    buffered_bytes_ = 0;
+}
+
+bool ColumnarWriter::flush_chunk() {
+    if (buffered_bytes_ == 0) {
+        return true;
+    }
+
+    std::vector<ColumnarChunkColumn> descriptors;
+    uint64_t payload_bytes = 0;
+    for (uint32_t index : file_columns_) {
+        const Column& column = columns_[index];
+        if (column.timestamps.empty()) {
+            continue;
+        }
+        ColumnarChunkColumn descriptor;
+        std::memset(&descriptor, 0, sizeof(descriptor));
+        descriptor.column = column.column;
+        descriptor.count = column.timestamps.size();
+        descriptors.push_back(descriptor);
+        payload_bytes += sizeof(descriptor) + descriptor.count * (sizeof(int64_t) + sizeof(double));
+    }
+
+    ColumnarChunkHeader header;
+    std::memcpy(header.magic, columnar::CHUNK_MAGIC, sizeof(header.magic));
+    header.column_count = static_cast<uint32_t>(descriptors.size());
+    header.payload_bytes = payload_bytes;
+    if (!write_all(&header, sizeof(header))
+        || !write_all(descriptors.data(), descriptors.size() * sizeof(ColumnarChunkColumn))) {
+        return false;
+    }
+
+    for (uint32_t index : file_columns_) {
+        Column& column = columns_[index];
+        if (column.timestamps.empty()) {
+            continue;
+        }
+        ColumnarSegmentEntry segment;
+        segment.count = column.timestamps.size();
+        segment.first_ns = column.timestamps.front();
+        segment.last_ns = column.timestamps.back();
+        segment.timestamps_offset = file_offset_;
+        if (!write_all(column.timestamps.data(), column.timestamps.size() * sizeof(int64_t))) {
+            return false;
+        }
+        segment.values_offset = file_offset_;
+        if (!write_all(column.values.data(), column.values.size() * sizeof(double))) {
+            return false;
+        }
+        column.segments.push_back(segment);
+        column.sample_count += segment.count;
+        column.timestamps.clear();
+        column.values.clear();
+    }
+
+    buffered_bytes_ = 0;
+    return true;
+}
+
+bool ColumnarWriter::write_footer() {
+    const uint64_t footer_offset = file_offset_;
+
+    ColumnarFooterHeader footer;
+    std::memset(&footer, 0, sizeof(footer));
+    std::memcpy(footer.magic, columnar::FOOTER_MAGIC, sizeof(footer.magic));
+    footer.column_count = static_cast<uint32_t>(file_columns_.size());
+
+    std::vector<ColumnarColumnEntry> entries;
+    entries.reserve(file_columns_.size());
+    for (uint32_t index : file_columns_) {
+        const Column& column = columns_[index];
+        ColumnarColumnEntry entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.can_id = column.can_id;
+        entry.first_segment = static_cast<uint32_t>(footer.segment_count);
+        entry.segment_count = static_cast<uint32_t>(column.segments.size());
+        entry.sample_count = column.sample_count;
+        std::strncpy(entry.name, column.name.c_str(), columnar::NAME_SIZE - 1);
+        std::strncpy(entry.unit, column.unit.c_str(), columnar::UNIT_SIZE - 1);
+        entries.push_back(entry);
+        footer.segment_count += column.segments.size();
+    }
+
+    if (!write_all(&footer, sizeof(footer)) || !write_all(entries.data(), entries.size() * sizeof(ColumnarColumnEntry))) {
+        return false;
+    }
+    // Segments regroupés par colonne, dans l'ordre des entrées
+    for (uint32_t index : file_columns_) {
+        const auto& segments = columns_[index].segments;
+        if (!write_all(segments.data(), segments.size() * sizeof(ColumnarSegmentEntry))) {
+            return false;
+        }
+    }
+
+    ColumnarTrailer trailer;
+    std::memset(&trailer, 0, sizeof(trailer));
+    trailer.footer_offset = footer_offset;
+    trailer.footer_size = file_offset_ - footer_offset;
+    std::memcpy(trailer.magic, columnar::TRAILER_MAGIC, sizeof(trailer.magic));
+    if (!write_all(&trailer, sizeof(trailer))) {
+        return false;
+    }
+
+    // L'en-tête ne pointe sur l'index qu'une fois celui-ci complet
+    if (pwrite(fd_, &footer_offset, sizeof(footer_offset), offsetof(ColumnarFileHeader, footer_offset))
+        != static_cast<ssize_t>(sizeof(footer_offset))) {
+        std::cerr << "Cannot finalize columnar header of " << current_file_path_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ColumnarWriter::dbc_changed(const std::shared_ptr<const dbcppp::INetwork>& network) {
+    (void)network;
+    if (fd_ < 0) {
+        return;
+    }
+    std::cout << "DBC reloaded, rotating columnar file" << std::endl;
+    if (!create_new_file()) {
+        std::cerr << "Columnar output lost, stopping" << std::endl;
+        SignalHandler::request_shutdown();
+    }
+}
+
+void ColumnarWriter::write_can_message(const CanMessage& message) {
+    if (fd_ < 0) {
+        return;
+    }
+
+    const size_t file_bytes = file_offset_ + buffered_bytes_;
+    const bool requested = rotation_requested_.exchange(false);
+    const bool full = follow_rotation_ ? file_bytes >= storage_policy_.rotation_bytes + PREALLOCATION_SLACK
+                                       : file_bytes >= storage_policy_.rotation_bytes;
+    if (requested || full) {
+        if (requested) {
+            std::cout << "MF4 file rotated, rotating columnar file" << std::endl;
+        } else {
+            std::cout << "Columnar file reached max size, rotating..." << std::endl;
+        }
+        if (!create_new_file()) {
+            std::cerr << "Failed to rotate columnar file. Message dropped." << std::endl;
+            SignalHandler::request_shutdown();
+            return;
+        }
+    }
+
+    const int64_t timestamp_ns = epoch_offset_ns_
+        + std::chrono::duration_cast<std::chrono::nanoseconds>(message.timestamp.time_since_epoch()).count();
+    for (const auto& signal : message.signals) {
+        const uint32_t index = signal.signal_index;
+        if (index == UINT32_MAX) {
+            continue;
+        }
+        if (index >= columns_.size()) {
+            columns_.resize(index + 1);
+        }
+        Column& column = columns_[index];
+        if (!column.in_file) {
+            column.in_file = true;
+            column.column = static_cast<uint32_t>(file_columns_.size());
+            column.name = signal.signal_name;
+            column.unit = signal.unit;
+            column.can_id = message.can_id;
+            file_columns_.push_back(index);
+        }
+        column.timestamps.push_back(timestamp_ns);
+        column.values.push_back(signal.value);
+        buffered_bytes_ += sizeof(int64_t) + sizeof(double);
+    }
+
+    if (buffered_bytes_ >= CHUNK_BYTES && !flush_chunk()) {
+        // Fichier inutilisable (partition pleine, erreur flash) : on repart sur un nouveau
+        if (!create_new_file()) {
+            std::cerr << "Columnar output lost, stopping" << std::endl;
+            SignalHandler::request_shutdown();
+        }
+    }
+}
@@ -0,0 +1,150 @@
+#include "cycle_monitor.h"
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+#include <dbcppp/Network.h>
+
+const CycleChannel CYCLE_CHANNELS[CYCLE_CHANNELS_PER_MESSAGE] = {
+    {"period", "ms", "Mean interval between frames"},
+    {"jitter", "ms", "Standard deviation of the interval between frames"},
+    {"max_gap", "ms", "Longest interval without frame, current silence included"},
+    {"timeouts", "", "Times the message went missing since the start"},
+};
+
+double dbc_cycle_time_ms(const dbcppp::INetwork& network, const dbcppp::IMessage& message) {
+    auto to_double = [](const dbcppp::IAttribute& attribute) -> double {
+        const auto& value = attribute.Value();
+        if (const auto* int_value = std::get_if<int64_t>(&value)) {
+            return static_cast<double>(*int_value);
+        }
+        if (const auto* double_value = std::get_if<double>(&value)) {
+            return *double_value;
+        }
+        return 0.0;
+    };
+
+    for (const auto& attribute : message.AttributeValues()) {
+        if (attribute.Name() == "GenMsgCycleTime") {
+            return to_double(attribute);
+        }
+    }
+    for (const auto& attribute : network.AttributeDefaults()) {
+        if (attribute.Name() == "GenMsgCycleTime") {
+            return to_double(attribute);
+        }
+    }
+    return 0.0;
+}
+
+namespace {
+
+std::string format_ms(double ms) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(ms < 10.0 ? 1 : 0) << ms << " ms";
+    return oss.str();
+}
+
+std::string message_label(const CycleEntry& entry) {
+    std::ostringstream oss;
+    oss << entry.name << " (0x" << std::hex << std::uppercase
+        << (entry.can_id & ((entry.can_id & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK)) << ")";
+    return oss.str();
+}
+
+}  // namespace
+
+CycleMonitor::CycleMonitor(double timeout_cycles)
+    : timeout_cycles_(timeout_cycles > 1.0 ? timeout_cycles : 1.0) {
+}
+
+void CycleMonitor::configure(const std::vector<CycleEntry>& entries, std::chrono::steady_clock::time_point now) {
+    std::unordered_map<uint32_t, size_t> previous;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        previous.emplace(entries_[i].can_id, i);
+    }
+
+    std::vector<State> states(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto it = previous.find(entries[i].can_id);
+        if (it != previous.end() && entries_[it->second].cycle_ms == entries[i].cycle_ms) {
+            states[i] = states_[it->second];
+            continue;
+        }
+        // Jamais reçu : manquant s'il ne se montre pas dans les K premiers cycles
+        states[i].last = now;
+        states[i].timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::duration<double, std::milli>(entries[i].cycle_ms * timeout_cycles_));
+    }
+    entries_ = entries;
+    states_ = std::move(states);
+
+    if (next_publish_ == std::chrono::steady_clock::time_point()) {
+        next_check_ = now + CHECK_INTERVAL;
+        next_publish_ = now + PUBLISH_INTERVAL;
+    }
+}
+
+bool CycleMonitor::poll(std::chrono::steady_clock::time_point now, std::vector<StreamEvent>& events, CanMessage& stats) {
+    if (now >= next_check_) {
+        next_check_ = now + CHECK_INTERVAL;
+        const size_t first_event = events.size();
+        for (size_t i = 0; i < states_.size(); ++i) {
+            State& state = states_[i];
+            const CycleEntry& entry = entries_[i];
+            if (state.recovered) {
+                state.recovered = false;
+                const double gap_ms = std::chrono::duration<double, std::milli>(state.recovered_gap).count();
+                events.push_back({"Recovered " + entry.name,
+                                  message_label(entry) + " received again after " + format_ms(gap_ms)
+                                      + " (cycle " + format_ms(entry.cycle_ms) + ")",
+                                  state.recovered_at});
+            }
+            if (!state.missing && now - state.last > state.timeout) {
+                state.missing = true;
+                ++state.timeouts;
+                ++total_timeouts_;
+                events.push_back({"Missing " + entry.name,
+                                  message_label(entry) + (state.seen ? " not received for " : " never received in ")
+                                      + format_ms(entry.cycle_ms * timeout_cycles_) + " (cycle "
+                                      + format_ms(entry.cycle_ms) + ")",
+                                  state.last + state.timeout});
+            }
+        }
+        std::sort(events.begin() + static_cast<std::ptrdiff_t>(first_event), events.end(),
+                  [](const StreamEvent& a, const StreamEvent& b) { return a.timestamp < b.timestamp; });
+    }
+
+    if (now < next_publish_ || entries_.empty()) {
+        return false;
+    }
+    next_publish_ = now + PUBLISH_INTERVAL;
+
+    stats.can_id = CYCLE_STATS_CAN_ID;
+    stats.layout_id = 0;
+    stats.timestamp = now;
+    stats.signals.clear();
+    stats.signals.reserve(entries_.size() * CYCLE_CHANNELS_PER_MESSAGE);
+    for (size_t i = 0; i < states_.size(); ++i) {
+        State& state = states_[i];
+        const double count = static_cast<double>(state.count);
+        const double mean_ms = state.count > 0 ? state.sum_ms / count : 0.0;
+        const double variance = state.count > 0 ? state.sum_sq_ms / count - mean_ms * mean_ms : 0.0;
+        const double silence_ms = std::chrono::duration<double, std::milli>(now - state.last).count();
+        const double values[CYCLE_CHANNELS_PER_MESSAGE] = {
+            mean_ms,
+            std::sqrt(std::max(variance, 0.0)),
+            std::max(state.max_ms, silence_ms),
+            static_cast<double>(state.timeouts),
+        };
+        for (size_t c = 0; c < CYCLE_CHANNELS_PER_MESSAGE; ++c) {
+            stats.signals.emplace_back(CYCLE_STATS_CAN_ID, cycle_channel_name(entries_[i].name, CYCLE_CHANNELS[c]),
+                                       values[c], CYCLE_CHANNELS[c].unit, now);
+        }
+        state.count = 0;
+        state.sum_ms = 0.0;
+        state.sum_sq_ms = 0.0;
+        state.max_ms = 0.0;
+    }
+    return true;
+}
@@ -2,8 +2,20 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <deque>
+#include <algorithm>
+#include <unordered_set>
+#include <filesystem>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #include <dbcppp/Network.h>
-#include "mf4_writer.h"
+#include "output_sink.h"
+#include "stream_server.h"
+#include "bus_stats.h"
 
 DbcDecoder::DbcDecoder(const std::string& dbc_file) 
     : dbc_file_path_(dbc_file)
@@ -14,149 +26,1161 @@ DbcDecoder::~DbcDecoder() {
     stop();
 }
 
-bool DbcDecoder::load_dbc_file() {
+DbcDecoder::CompiledDbc::~CompiledDbc() {
+    // Le nom du segment appartient déjà à la table du DBC suivant : pas d'unlink
+    // (sauf pour une table jamais activée, rechargement remplacé)
+    if (signal_table) {
+        signal_table->retire();
+    }
+}
+
+std::shared_ptr<DbcDecoder::CompiledDbc> DbcDecoder::load_dbc_file() {
     try {
         std::ifstream idbc(dbc_file_path_);
         if (!idbc.is_open()) {
             std::cerr << "Error: Cannot open DBC file: " << dbc_file_path_ << std::endl;
-            return false;
+            return nullptr;
         }
 
-        network_ = dbcppp::INetwork::LoadDBCFromIs(idbc);
-        if (!network_) {
+        std::shared_ptr<const dbcppp::INetwork> network = dbcppp::INetwork::LoadDBCFromIs(idbc);
+        if (!network) {
             std::cerr << "Error: Failed to load DBC file: " << dbc_file_path_ << std::endl;
-            return false;
+            return nullptr;
+        }
+
+        auto dbc = std::make_shared<CompiledDbc>();
+        dbc->network = network;
+        if (bus_stats_) {
+            dbc->rate_ids = bus_rate_ids(*network);
+        }
+        for (const auto& expression : trigger_settings_.expressions) {
+            std::string error;
+            if (!dbc->triggers.add_expression(expression, error)) {
+                std::cerr << "Invalid trigger '" << expression << "': " << error << std::endl;
+                return nullptr;
+            }
+        }
+
+        if (selection_) {
+            selection_->report_unmatched(*network);
+        }
+
+        // Build message lookup map, with the multiplexer decision tree of each message
+        size_t multiplexed_count = 0;
+        size_t skipped_count = 0;
+        size_t batch_signals = 0;
+        size_t batch_vector_signals = 0;
+        // Blocs seulement sur le décodeur mono-thread, hors enregistrement sur événement
+        const bool batch_pipeline = batch_frames_ > 0 && worker_count_ <= 1 && trigger_settings_.expressions.empty();
+        for (const auto& msg : network->Messages()) {
+            const uint32_t can_id = static_cast<uint32_t>(msg.Id());
+            if (selection_ && !selection_->select_message(can_id, msg.Name())) {
+                ++skipped_count;
+                continue;
+            }
+
+            CompiledMessage compiled;
+            compiled.message = &msg;
+            compiled.mux.build(msg);
+            if (selection_) {
+                compiled.mux.retain_signals([&](const dbcppp::ISignal& signal) {
+                    return selection_->select_signal(can_id, msg.Name(), signal.Name());
+                });
+                if (!compiled.mux.has_signals()) {
+                    ++skipped_count;
+                    continue;
+                }
+            }
+            if (compiled.mux.is_multiplexed()) {
+                ++multiplexed_count;
+            }
+            const double cycle_ms = compiled.mux.has_signals() ? dbc_cycle_time_ms(*network, msg) : 0.0;
+            if (cycle_timeout_cycles_ > 0.0 && cycle_ms > 0.0) {
+                compiled.cycle_slot = static_cast<uint32_t>(dbc->cycle_entries.size());
+                dbc->cycle_entries.push_back({can_id, msg.Name(), cycle_ms});
+            }
+            // Un index par signal du message, commun à tous les layouts qui le contiennent
+            std::unordered_map<const dbcppp::ISignal*, uint32_t> indexes;
+            for (const auto& layout : compiled.mux.layouts()) {
+                compiled.signal_indexes.emplace_back();
+                for (const auto* signal : layout.signals) {
+                    auto inserted = indexes.emplace(signal, static_cast<uint32_t>(dbc->signal_entries.size()));
+                    if (inserted.second) {
+                        dbc->signal_entries.push_back({msg.Name() + "." + signal->Name(), signal->Unit(), can_id});
+                    }
+                    compiled.signal_indexes.back().push_back(inserted.first->second);
+                }
+            }
+            compiled.transport = is_transport_message(msg, transport_protocol_);
+            if (batch_frames_ > 0 && !compiled.transport && !compiled.mux.is_multiplexed()
+                && compiled.mux.layouts().size() == 1) {
+                auto plan = std::make_unique<BatchDecodePlan>();
+                if (plan->build(compiled.mux.layouts().front(), compiled.signal_indexes.front())) {
+                    // La moyenne par blocs de la décimation reste trame par trame
+                    auto rule = decimation_rules_.find(can_id);
+                    const bool averaged = rule != decimation_rules_.end() && rule->second.mode == DecimationMode::BlockAverage;
+                    if (batch_pipeline && !averaged && cycle_ms > 0.0 && cycle_ms <= BATCH_MAX_CYCLE_MS) {
+                        compiled.batch_slot = dbc->batch_slots++;
+                        batch_signals += plan->signals().size();
+                        batch_vector_signals += plan->vector_signals();
+                    }
+                    dbc->batch_max_signals = std::max(dbc->batch_max_signals, plan->signals().size());
+                    compiled.batch = std::move(plan);
+                }
+            }
+            if (!dbc->triggers.empty()) {
+                std::unordered_set<std::string> names;
+                for (const auto& layout : compiled.mux.layouts()) {
+                    for (const auto* signal : layout.signals) {
+                        if (names.insert(signal->Name()).second) {
+                            dbc->triggers.bind_signal(can_id, msg.Name(), signal->Name());
+                        }
+                    }
+                }
+            }
+            dbc->message_map.emplace(can_id, std::move(compiled));
         }
 
-        // Build message lookup map
-        message_map_.clear();
-        for (const auto& msg : network_->Messages()) {
-            message_map_[msg.Id()] = &msg;
+        if (dbc->message_map.empty()) {
+            std::cerr << "Error: DBC file " << dbc_file_path_ << " has no selected message" << std::endl;
+            return nullptr;
+        }
+        for (const auto& entry : dbc->message_map) {
+            if (!entry.second.transport) {
+                continue;
+            }
+            const uint32_t key = transport_key(entry.first, transport_protocol_);
+            if (!dbc->transport_map.emplace(key, &entry.second).second) {
+                std::cerr << "Warning: " << transport_protocol_name(transport_protocol_) << " message "
+                          << entry.second.message->Name() << " has the same PGN as "
+                          << dbc->transport_map[key]->message->Name() << ", ignored" << std::endl;
+            }
+        }
+        if (!dbc->triggers.empty()) {
+            const auto unbound = dbc->triggers.unbound_signals();
+            if (!unbound.empty()) {
+                std::cerr << "Trigger signal not found in DBC (or excluded by the profile): " << unbound.front() << std::endl;
+                return nullptr;
+            }
         }
 
         std::cout << "DBC file loaded successfully: " << dbc_file_path_ 
-                  << " (" << message_map_.size() << " messages)" << std::endl;
-        return true;
+                  << " (" << dbc->message_map.size() << " messages, "
+                  << multiplexed_count << " multiplexed";
+        if (selection_) {
+            std::cout << ", " << skipped_count << " excluded by selection profile";
+        }
+        std::cout << ")" << std::endl;
+        if (cycle_timeout_cycles_ > 0.0) {
+            std::cout << "Cycle time monitoring: " << dbc->cycle_entries.size() << " messages with GenMsgCycleTime, missing after "
+                      << cycle_timeout_cycles_ << " cycles" << std::endl;
+        }
+        if (transport_protocol_ != TransportProtocol::None) {
+            std::cout << transport_protocol_name(transport_protocol_) << " transport: " << dbc->transport_map.size()
+                      << " messages longer than 8 bytes reassembled by the kernel" << std::endl;
+        }
+        if (batch_pipeline) {
+            std::cout << "Batch decode: " << dbc->batch_slots << " messages with GenMsgCycleTime <= "
+                      << BATCH_MAX_CYCLE_MS << " ms, blocks of " << batch_frames_ << " frames, "
+                      << batch_vector_signals << "/" << batch_signals << " signals on "
+                      << BatchDecodePlan::kernel_isa() << " kernels" << std::endl;
+        }
+
+        if (!shared_table_name_.empty()) {
+            dbc->signal_table = std::make_unique<SignalTablePublisher>();
+            if (!dbc->signal_table->create(shared_table_name_, dbc->signal_entries)) {
+                return nullptr;
+            }
+            for (auto& entry : dbc->message_map) {
+                entry.second.signal_table = dbc->signal_table.get();
+            }
+        }
+        return dbc;
     } catch (const std::exception& e) {
         std::cerr << "Exception loading DBC file: " << e.what() << std::endl;
-        return false;
+        return nullptr;
     }
 }
 
-void DbcDecoder::decode_frame(const CanFrame& frame) {
-    auto it = message_map_.find(frame.can_id);
-    if (it == message_map_.end()) {
-        // Unknown CAN ID, skip 
+std::vector<uint32_t> DbcDecoder::can_ids_of(const CompiledDbc& dbc) {
+    std::vector<uint32_t> ids;
+    ids.reserve(dbc.message_map.size());
+    for (const auto& entry : dbc.message_map) {
+        if (!entry.second.transport) {
+            ids.push_back(entry.first);
+        }
+    }
+    return ids;
+}
+
+std::vector<TransportFlow> DbcDecoder::transport_flows() const {
+    std::vector<TransportFlow> flows;
+    for (const auto& [key, compiled] : dbc_->transport_map) {
+        flows.push_back({key, static_cast<uint32_t>(compiled->message->Id()),
+                         static_cast<size_t>(compiled->message->MessageSize()), compiled->message->Name()});
+    }
+    return flows;
+}
+
+void DbcDecoder::request_reload() {
+    if (reload_event_fd_ < 0) {
         return;
     }
+    const uint64_t one = 1;
+    ssize_t rc = write(reload_event_fd_, &one, sizeof(one));
+    (void)rc;
+}
 
-    const dbcppp::IMessage* message = it->second;
-    
-    if (!writer_) {
+void DbcDecoder::reload_loop() {
+    apply_background_priority("dbc-reload");
+
+    // Le répertoire est surveillé : les éditeurs et les déploiements remplacent le fichier par renommage
+    const std::filesystem::path dbc_path(dbc_file_path_);
+    const std::string dbc_name = dbc_path.filename().string();
+    int inotify_fd = -1;
+    if (watch_dbc_) {
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        const std::string directory = dbc_path.has_parent_path() ? dbc_path.parent_path().string() : ".";
+        if (inotify_fd < 0 || inotify_add_watch(inotify_fd, directory.c_str(),
+                                                IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+            std::cerr << "Cannot watch " << directory << " for DBC changes: " << strerror(errno) << std::endl;
+            if (inotify_fd >= 0) {
+                close(inotify_fd);
+                inotify_fd = -1;
+            }
+        }
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = reload_event_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = inotify_fd;   // ignoré par poll() si négatif
+    fds[1].events = POLLIN;
+    bool file_changed = false;
+
+    while (!reload_stop_.load()) {
+        // Une modification n'est prise en compte qu'après un moment sans écriture
+        const int rc = poll(fds, 2, file_changed ? RELOAD_SETTLE_MS : -1);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "DBC reload thread: poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (rc == 0) {
+            file_changed = false;
+            reload_dbc("DBC file changed");
+            continue;
+        }
+        if (fds[0].revents & POLLIN) {
+            uint64_t value = 0;
+            ssize_t count = read(reload_event_fd_, &value, sizeof(value));
+            (void)count;
+            if (reload_stop_.load()) {
+                break;
+            }
+            file_changed = false;
+            reload_dbc("reload requested");
+        }
+        if (inotify_fd >= 0 && (fds[1].revents & POLLIN)) {
+            alignas(struct inotify_event) char buffer[4096];
+            ssize_t count;
+            while ((count = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+                for (char* cursor = buffer; cursor < buffer + count;) {
+                    const auto* event = reinterpret_cast<const struct inotify_event*>(cursor);
+                    if (event->len > 0 && dbc_name == event->name) {
+                        file_changed = true;
+                    }
+                    cursor += sizeof(struct inotify_event) + event->len;
+                }
+            }
+        }
+    }
+
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+    }
+}
+
+void DbcDecoder::reload_dbc(const char* reason) {
+    std::cout << "🔄 Reloading DBC file " << dbc_file_path_ << " (" << reason << ")" << std::endl;
+    const auto started = std::chrono::steady_clock::now();
+    auto dbc = load_dbc_file();
+    if (!dbc) {
+        std::cerr << "DBC reload failed, keeping the current DBC" << std::endl;
         return;
     }
+    dbc->generation = ++generation_;
+
+    // Publication : le thread décodeur le prend à la trame suivante. Un DBC
+    // publié mais pas encore pris est simplement remplacé.
+    std::atomic_store(&pending_dbc_, dbc);
+    reload_pending_.store(true, std::memory_order_release);
+    std::cout << "DBC generation " << dbc->generation << " ready in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - started).count()
+              << " ms, switching at the next frame" << std::endl;
+}
+
+void DbcDecoder::switch_outputs(const CompiledDbc& dbc) {
+    // Dans l'ordre du flux : les messages suivants portent les nouveaux index et layouts
+    if (stream_) {
+        stream_->update_catalog(dbc.signal_entries);
+    }
+    output_->dbc_changed(dbc.network);
+    std::cout << "🔄 Outputs switched to DBC generation " << dbc.generation << std::endl;
+}
+
+void DbcDecoder::apply_pending_dbc() {
+    reload_pending_.store(false, std::memory_order_relaxed);
+    std::shared_ptr<CompiledDbc> next = std::atomic_exchange(&pending_dbc_, std::shared_ptr<CompiledDbc>());
+    if (!next) {
+        return;
+    }
+    // Les blocs en attente référencent les messages de l'ancien DBC
+    flush_batches();
+
+    if (!triggers_.empty()) {
+        // Les expressions repartent sans historique : le front suivant déclenche
+        triggers_ = std::move(next->triggers);
+    }
+    main_context_.decimation.set_rules(decimation_rules_);
+    if (cycle_monitor_) {
+        cycle_monitor_->configure(next->cycle_entries, std::chrono::steady_clock::now());
+    }
+    if (can_ids_listener_) {
+        can_ids_listener_(can_ids_of(*next));
+    }
+
+    std::shared_ptr<const CompiledDbc> retired = std::move(dbc_);
+    dbc_ = std::move(next);
+    if (dbc_->signal_table) {
+        // Échange réussi : la nouvelle table prend le nom lu par les lecteurs
+        dbc_->signal_table->activate();
+    }
+    reset_batches(*dbc_);
+    if (workers_.empty()) {
+        switch_outputs(*dbc_);
+        return;  // retired libéré ici : aucune trame en vol
+    }
 
+    // Période de grâce : les trames déjà routées référencent encore retired.
+    // Le marqueur prend le numéro de séquence suivant ; la fusion le traite
+    // après la dernière d'entre elles.
+    DecodeResult marker;
+    marker.seq = next_seq_++;
+    marker.ready = true;
+    marker.reload = dbc_;
+    marker.retired = std::move(retired);
+    results_.push(std::move(marker));
+}
+
+size_t DbcDecoder::worker_index(uint32_t can_id, size_t worker_count) {
+    // Hachage multiplicatif : un CAN ID est toujours traité par le même worker
+    const uint32_t hash = can_id * 2654435761u;
+    return (hash >> 16) % worker_count;
+}
+
+const DbcDecoder::CompiledMessage* DbcDecoder::accept_frame(const CanFrame& frame) {
+    auto it = dbc_->message_map.find(frame.can_id);
+    if (it == dbc_->message_map.end()) {
+        // Unknown CAN ID, skip 
+        return nullptr;
+    }
+    if (it->second.transport) {
+        // Fragment d'un message de transport : décodé une fois réassemblé
+        return nullptr;
+    }
+
+    // Temps de cycle mesuré sur toutes les trames reçues, décimées ou non
+    if (it->second.cycle_slot != CycleMonitor::NO_SLOT && cycle_monitor_) {
+        cycle_monitor_->on_frame(it->second.cycle_slot, frame.timestamp);
+    }
+
+    // Decimation par intervalle / une trame sur N : avant tout décodage
+    if (!decimation_.accept(frame)) {
+        return nullptr;
+    }
+
+    return &it->second;
+}
+
+bool DbcDecoder::decode_frame(const CanFrame& frame, const CompiledMessage& compiled,
+                              DecodeContext& context, CanMessage& decoded_message) {
     try {
-        CanMessage decoded_message;
         decoded_message.can_id = frame.can_id;
         decoded_message.timestamp = frame.timestamp;
+        decoded_message.signals.clear();
+
+        // Seuls les signaux du groupe de multiplexage actif sont décodés
+        const MuxLayout& layout = compiled.mux.resolve(frame.data);
+        decoded_message.layout_id = layout.id;
+        decoded_message.signals.reserve(layout.signals.size());
 
         // Debug: Check for timestamp issues at decode time
-        static auto first_frame_time = std::chrono::steady_clock::time_point{};
-        static bool first_frame_logged = false;
-        
-        if (!first_frame_logged) {
-            first_frame_time = frame.timestamp;
-            first_frame_logged = true;
+        if (!context.first_frame_logged) {
+            context.first_frame_time = frame.timestamp;
+            context.first_frame_logged = true;
             std::cout << "🔍 First CAN frame decoded at decoder level" << std::endl;
         }
         
-        auto time_since_first = frame.timestamp - first_frame_time;
+        auto time_since_first = frame.timestamp - context.first_frame_time;
         auto time_since_first_ms = std::chrono::duration_cast<std::chrono::milliseconds>(time_since_first).count();
         
-        for (const auto& signal : message->Signals()) {
-            double raw_value = signal.RawToPhys(signal.Decode(frame.data));
+        if (layout.signals.empty()) {
+            return false;
+        }
+
+        const std::vector<uint32_t>& indexes = compiled.signal_indexes[layout.id];
+        SignalTablePublisher* const signal_table = context.publish ? compiled.signal_table : nullptr;
+        for (size_t i = 0; i < layout.signals.size(); ++i) {
+            const auto* signal = layout.signals[i];
+            double raw_value = signal->RawToPhys(signal->Decode(frame.data));
 
             // Debug: Log suspicious decoded values
             if (std::abs(raw_value) > 1e12 || std::isnan(raw_value) || std::isinf(raw_value)) {
-                std::cerr << "⚠️  SUSPICIOUS DECODED VALUE from DBC: " << signal.Name() 
+                std::cerr << "⚠️  SUSPICIOUS DECODED VALUE from DBC: " << signal->Name() 
                           << " = " << raw_value << " (CAN ID 0x" << std::hex << frame.can_id << std::dec 
                           << ", time since first: " << time_since_first_ms << "ms)" << std::endl;
             }
 
             decoded_message.signals.emplace_back(
                 frame.can_id,
-                signal.Name(),
+                signal->Name(),
                 raw_value,
-                signal.Unit(),
+                signal->Unit(),
                 frame.timestamp
             );
+            decoded_message.signals.back().signal_index = indexes[i];
+            if (signal_table) {
+                signal_table->publish(indexes[i], raw_value, frame.timestamp);
+            }
         }
 
-        writer_->write_can_message(decoded_message);
+        return context.decimation.accumulate(frame.can_id, layout.id, decoded_message.signals);
     } catch (const std::exception& e) {
         std::cerr << "Error decoding CAN frame ID 0x" << std::hex << frame.can_id 
                   << ": " << e.what() << std::dec << std::endl;
+        return false;
+    }
+}
+
+void DbcDecoder::open_event(const CanFrame& frame, const std::string& expression) {
+    ++event_count_;
+    std::cout << "🎯 Trigger fired: " << expression << " (event #" << event_count_ << ")" << std::endl;
+
+    if (!output_->start()) {
+        std::cerr << "Cannot open MF4 file for event #" << event_count_ << ", event dropped" << std::endl;
+        return;
+    }
+    event_active_ = true;
+    event_end_ = frame.timestamp + trigger_settings_.post_trigger;
+
+    const auto since = frame.timestamp - trigger_settings_.pre_trigger;
+    if (pre_trigger_ring_.full() && pre_trigger_ring_.oldest().timestamp > since && !ring_short_logged_) {
+        const auto covered = std::chrono::duration_cast<std::chrono::milliseconds>(
+            frame.timestamp - pre_trigger_ring_.oldest().timestamp).count();
+        std::cerr << "⚠️  Pre-trigger buffer only covers " << covered << " ms at the current bus load"
+                  << " (increase --trigger-buffer)" << std::endl;
+        ring_short_logged_ = true;
+    }
+
+    // Fenêtre pré-déclenchement, trame déclenchante comprise, décodée avec un état de décimation neuf
+    DecodeContext replay;
+    replay.decimation.set_rules(decimation_rules_);
+    replay.first_frame_logged = true;
+    replay.publish = false;  // la table garde les valeurs les plus récentes
+    size_t replayed = 0;
+    pre_trigger_ring_.for_each_since(since, [&](const CanFrame& buffered) {
+        auto it = dbc_->message_map.find(buffered.can_id);
+        CanMessage decoded_message;
+        if (it != dbc_->message_map.end() && decode_frame(buffered, it->second, replay, decoded_message)) {
+            output_->write_can_message(decoded_message);
+            ++replayed;
+        }
+    });
+    std::cout << "   " << replayed << " pre-trigger messages written" << std::endl;
+}
+
+void DbcDecoder::close_event() {
+    if (!event_active_) {
+        return;
+    }
+    event_active_ = false;
+    output_->stop();
+    std::cout << "🎯 Event #" << event_count_ << " recorded" << std::endl;
+}
+
+void DbcDecoder::emit(const CanMessage& message) {
+    output_->write_can_message(message);
+    if (stream_) {
+        stream_->publish(message);
     }
 }
 
+void DbcDecoder::emit_generated(CanMessage& message) {
+    if (!triggers_.empty()) {
+        // Enregistrement sur événement : seulement pendant une fenêtre
+        if (event_active_) {
+            output_->write_can_message(message);
+        }
+        return;
+    }
+    if (workers_.empty()) {
+        emit(message);
+        return;
+    }
+    // Derrière les trames déjà routées, comme le marqueur de rechargement
+    DecodeResult result;
+    result.seq = next_seq_++;
+    result.ready = true;
+    result.has_message = true;
+    result.message = std::move(message);
+    results_.push(std::move(result));
+}
+
+void DbcDecoder::emit_event(StreamEvent& event) {
+    if (!triggers_.empty()) {
+        if (event_active_) {
+            output_->write_event(event);
+        }
+        return;
+    }
+    if (workers_.empty()) {
+        output_->write_event(event);
+        return;
+    }
+    DecodeResult result;
+    result.seq = next_seq_++;
+    result.ready = true;
+    result.has_event = true;
+    result.event = std::move(event);
+    results_.push(std::move(result));
+}
+
+void DbcDecoder::emit_bus_statistics() {
+    BusStatsSnapshot snapshot;
+    if (!bus_stats_ || !bus_stats_->take_snapshot(snapshot)) {
+        return;
+    }
+    CanMessage stats;
+    CanMessage rates;
+    BusStatistics::to_messages(snapshot, dbc_->rate_ids, stats, rates);
+    emit_generated(stats);
+    emit_generated(rates);
+}
+
+void DbcDecoder::poll_cycle_monitor(std::chrono::steady_clock::time_point now) {
+    cycle_events_.clear();
+    const bool publish = cycle_monitor_->poll(now, cycle_events_, cycle_stats_);
+    for (auto& event : cycle_events_) {
+        std::cout << (event.name.compare(0, 7, "Missing") == 0 ? "⚠️  " : "✅ ") << event.description << std::endl;
+        emit_event(event);
+    }
+    if (publish) {
+        emit_generated(cycle_stats_);
+    }
+}
+
+void DbcDecoder::reset_batches(const CompiledDbc& dbc) {
+    batch_blocks_.assign(dbc.batch_slots, PendingBlock());
+    batch_pending_.clear();
+    batch_queued_frames_.store(0, std::memory_order_relaxed);
+    batch_flush_at_ = std::chrono::steady_clock::time_point::max();
+    batch_values_.assign(dbc.batch_max_signals * BATCH_MAX_FRAMES, 0.0);
+}
+
+void DbcDecoder::queue_batch_frame(const CanFrame& frame, const CompiledMessage& compiled) {
+    PendingBlock& pending = batch_blocks_[compiled.batch_slot];
+    if (!pending.queued) {
+        pending.queued = true;
+        pending.compiled = &compiled;
+        if (batch_pending_.empty()) {
+            batch_flush_at_ = frame.timestamp + BATCH_MAX_DELAY;
+        }
+        batch_pending_.push_back(compiled.batch_slot);
+    }
+    std::memcpy(&pending.words[pending.count], frame.data, sizeof(uint64_t));
+    pending.timestamps[pending.count] = frame.timestamp;
+    batch_queued_frames_.fetch_add(1, std::memory_order_relaxed);
+    if (++pending.count == batch_frames_) {
+        emit_block(pending);
+    }
+}
+
+void DbcDecoder::decode_block(const CompiledMessage& compiled, const uint64_t* words,
+                              const std::chrono::steady_clock::time_point* timestamps, size_t count, MessageBlock& block) {
+    compiled.batch->decode(words, count, batch_values_.data());
+    block.can_id = static_cast<uint32_t>(compiled.message->Id());
+    block.layout_id = compiled.mux.layouts().front().id;
+    block.frame_count = count;
+    block.stride = BATCH_MAX_FRAMES;
+    block.signals = &compiled.batch->signals();
+    block.timestamps = timestamps;
+    block.values = batch_values_.data();
+}
+
+void DbcDecoder::emit_block(PendingBlock& pending) {
+    MessageBlock block;
+    decode_block(*pending.compiled, pending.words, pending.timestamps, pending.count, block);
+    batch_queued_frames_.fetch_sub(pending.count, std::memory_order_relaxed);
+    pending.count = 0;
+
+    if (!main_context_.first_frame_logged) {
+        main_context_.first_frame_time = block.timestamps[0];
+        main_context_.first_frame_logged = true;
+        std::cout << "🔍 First CAN frame decoded at decoder level" << std::endl;
+    }
+
+    // Table partagée : dernière valeur du bloc
+    SignalTablePublisher* const signal_table = pending.compiled->signal_table;
+    const size_t last = block.frame_count - 1;
+    for (size_t s = 0; s < block.signals->size(); ++s) {
+        const BlockSignal& signal = (*block.signals)[s];
+        const double* column = block.column(s);
+        for (size_t i = 0; i < block.frame_count; ++i) {
+            if (!(std::abs(column[i]) <= 1e12)) {
+                std::cerr << "⚠️  SUSPICIOUS DECODED VALUE from DBC: " << signal.name
+                          << " = " << column[i] << " (CAN ID 0x" << std::hex << block.can_id << std::dec
+                          << ", block decode)" << std::endl;
+                break;
+            }
+        }
+        if (signal_table) {
+            signal_table->publish(signal.signal_index, column[last], block.timestamps[last]);
+        }
+    }
+
+    output_->write_message_block(block);
+    if (stream_) {
+        CanMessage message;
+        for (size_t i = 0; i < block.frame_count; ++i) {
+            block.to_message(i, message);
+            stream_->publish(message);
+        }
+    }
+}
+
+void DbcDecoder::flush_batches() {
+    for (uint32_t slot : batch_pending_) {
+        PendingBlock& pending = batch_blocks_[slot];
+        if (pending.count > 0) {
+            emit_block(pending);
+        }
+        pending.queued = false;
+    }
+    batch_pending_.clear();
+    batch_flush_at_ = std::chrono::steady_clock::time_point::max();
+}
+
+uint64_t DbcDecoder::drop_batches() {
+    uint64_t dropped = 0;
+    for (uint32_t slot : batch_pending_) {
+        PendingBlock& pending = batch_blocks_[slot];
+        dropped += pending.count;
+        pending.count = 0;
+        pending.queued = false;
+    }
+    batch_pending_.clear();
+    batch_queued_frames_.store(0, std::memory_order_relaxed);
+    batch_flush_at_ = std::chrono::steady_clock::time_point::max();
+    return dropped;
+}
+
+namespace {
+
+// Dernier octet lu par un signal : une charge de transport plus courte que
+// le message du DBC (longueur variable en J1939) ne porte pas les suivants
+uint64_t signal_last_byte(const dbcppp::ISignal& signal) {
+    const uint64_t start = signal.StartBit();
+    const uint64_t size = signal.BitSize();
+    if (signal.ByteOrder() == dbcppp::ISignal::EByteOrder::LittleEndian) {
+        return (start + size - 1) / 8;
+    }
+    // Motorola : du bit de départ (poids fort) vers le bas de l'octet, puis octets suivants
+    const uint64_t first_byte_bits = start % 8 + 1;
+    return start / 8 + (size > first_byte_bits ? (size - first_byte_bits + 7) / 8 : 0);
+}
+
+}  // namespace
+
+bool DbcDecoder::decode_transport(const TransportPayload& payload, const CompiledMessage& compiled,
+                                  CanMessage& decoded_message) {
+    try {
+        const uint32_t can_id = static_cast<uint32_t>(compiled.message->Id());
+        decoded_message.can_id = can_id;
+        decoded_message.timestamp = payload.timestamp;
+        decoded_message.signals.clear();
+
+        // payload.data est complété par des zéros au-delà de la taille du message du DBC
+        const MuxLayout& layout = compiled.mux.resolve(payload.data.data());
+        decoded_message.layout_id = layout.id;
+        decoded_message.signals.reserve(layout.signals.size() + TRANSPORT_CHANNEL_COUNT);
+
+        const std::vector<uint32_t>& indexes = compiled.signal_indexes[layout.id];
+        for (size_t i = 0; i < layout.signals.size(); ++i) {
+            const auto* signal = layout.signals[i];
+            if (signal_last_byte(*signal) >= payload.length) {
+                continue;
+            }
+            const double value = signal->RawToPhys(signal->Decode(payload.data.data()));
+            decoded_message.signals.emplace_back(can_id, signal->Name(), value, signal->Unit(), payload.timestamp);
+            decoded_message.signals.back().signal_index = indexes[i];
+            if (compiled.signal_table) {
+                compiled.signal_table->publish(indexes[i], value, payload.timestamp);
+            }
+        }
+
+        // Émetteur de la charge, hors catalogue des signaux
+        const double values[TRANSPORT_CHANNEL_COUNT] = {
+            static_cast<double>(payload.length),
+            static_cast<double>(payload.source_address),
+            static_cast<double>(payload.destination_address),
+        };
+        for (size_t c = 0; c < transport_channel_count(transport_protocol_); ++c) {
+            decoded_message.signals.emplace_back(can_id, TRANSPORT_CHANNELS[c].name, values[c],
+                                                 TRANSPORT_CHANNELS[c].unit, payload.timestamp);
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error decoding " << transport_protocol_name(transport_protocol_) << " payload 0x"
+                  << std::hex << payload.key << ": " << e.what() << std::dec << std::endl;
+        return false;
+    }
+}
+
+void DbcDecoder::process_transport_frame(const CanFrame& marker) {
+    uint64_t sequence = 0;
+    std::memcpy(&sequence, marker.data, sizeof(sequence));
+    if (!transport_inbox_ || !transport_inbox_->take(sequence, transport_payload_)) {
+        return;
+    }
+    auto it = dbc_->transport_map.find(transport_payload_.key);
+    if (it == dbc_->transport_map.end()) {
+        return;
+    }
+    const CompiledMessage& compiled = *it->second;
+    if (compiled.cycle_slot != CycleMonitor::NO_SLOT && cycle_monitor_) {
+        cycle_monitor_->on_frame(compiled.cycle_slot, transport_payload_.timestamp);
+    }
+
+    // Débit faible : décodé sur ce thread, écrit à sa place derrière les trames déjà routées
+    CanMessage decoded_message;
+    if (decode_transport(transport_payload_, compiled, decoded_message)) {
+        emit_generated(decoded_message);
+    }
+}
+
+void DbcDecoder::process_triggered_frame(const CanFrame& frame, const CompiledMessage& compiled) {
+    if (event_active_ && frame.timestamp > event_end_) {
+        close_event();
+    }
+    pre_trigger_ring_.push(frame);
+
+    // Hors fenêtre, seuls les messages portant un signal de déclenchement sont décodés
+    const bool watched = triggers_.watches(frame.can_id);
+    if (!event_active_ && !watched) {
+        return;
+    }
+
+    CanMessage decoded_message;
+    if (!decode_frame(frame, compiled, main_context_, decoded_message)) {
+        return;
+    }
+    if (event_active_) {
+        output_->write_can_message(decoded_message);
+    }
+    if (stream_) {
+        stream_->publish(decoded_message);
+    }
+
+    const std::string* fired = watched ? triggers_.update(decoded_message) : nullptr;
+    if (!fired) {
+        return;
+    }
+    if (event_active_) {
+        event_end_ = frame.timestamp + trigger_settings_.post_trigger;
+        std::cout << "🎯 Trigger fired again: " << *fired << " (event #" << event_count_ << " extended)" << std::endl;
+    } else {
+        open_event(frame, *fired);
+    }
+}
+
+void DbcDecoder::process_frame(const CanFrame& frame) {
+    // Point d'échange du DBC rechargé, entre deux trames
+    if (reload_pending_.load(std::memory_order_acquire)) {
+        apply_pending_dbc();
+    }
+
+    if (cycle_monitor_ && frame.timestamp >= cycle_monitor_->next_poll()) {
+        poll_cycle_monitor(frame.timestamp);
+    }
+    if (frame.timestamp >= batch_flush_at_) {
+        flush_batches();
+    }
+
+    if (frame.can_id == BUS_STATS_FRAME_ID) {
+        emit_bus_statistics();
+        return;
+    }
+    if (frame.can_id == TRANSPORT_FRAME_ID) {
+        process_transport_frame(frame);
+        return;
+    }
+
+    const CompiledMessage* compiled = accept_frame(frame);
+    if (!compiled) {
+        return;
+    }
+
+    if (!triggers_.empty()) {
+        process_triggered_frame(frame, *compiled);
+        return;
+    }
+
+    if (workers_.empty()) {
+        if (compiled->batch_slot != NO_BATCH_SLOT) {
+            queue_batch_frame(frame, *compiled);
+            return;
+        }
+        CanMessage decoded_message;
+        if (decode_frame(frame, *compiled, main_context_, decoded_message)) {
+            emit(decoded_message);
+        }
+        return;
+    }
+
+    SequencedFrame item;
+    item.seq = next_seq_++;
+    item.compiled = compiled;
+    item.frame = frame;
+    workers_[worker_index(frame.can_id, workers_.size())]->queue.push(std::move(item));
+}
+
 void DbcDecoder::decoder_loop() {
+    apply_thread_tuning(workers_.empty() ? "dbc-decoder" : "dbc-router", decoder_tuning_);
     std::cout << "DBC Decoder thread started" << std::endl;
     
+    // Attente sans échéance ; stop() ferme la file, qui est vidée avant la sortie
     CanFrame frame;
-    while (running_.load()) {
-        if (input_queue_->wait_and_pop(frame, std::chrono::milliseconds(100))) {
-            decode_frame(frame);
+    auto handle = [&]() {
+        if (past_drain_deadline()) {
+            drain_lost_ += 1 + input_queue_->clear();
+        } else {
+            process_frame(frame);
+        }
+    };
+
+    while (true) {
+        // Échéances à tenir même si le bus se tait : fin de la fenêtre
+        // post-déclenchement, contrôle des temps de cycle, blocs en attente
+        auto wakeup = cycle_monitor_ ? cycle_monitor_->next_poll() : std::chrono::steady_clock::time_point::max();
+        wakeup = std::min(wakeup, batch_flush_at_);
+        if (event_active_) {
+            wakeup = std::min(wakeup, event_end_);
+        }
+        if (wakeup == std::chrono::steady_clock::time_point::max()) {
+            if (!input_queue_->wait_and_pop(frame)) {
+                break;
+            }
+            handle();
+            continue;
         }
-    }
 
-    // Process remaining frames in queue before stopping
-    while (input_queue_->pop(frame)) {
-        decode_frame(frame);
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            wakeup - std::chrono::steady_clock::now()) + std::chrono::milliseconds(1);
+        if (input_queue_->wait_and_pop(frame, std::max(remaining, std::chrono::milliseconds(1)))) {
+            handle();
+            continue;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (event_active_ && now > event_end_) {
+            close_event();
+        } else if (input_queue_->is_closed()) {
+            break;
+        }
+        if (cycle_monitor_ && now >= cycle_monitor_->next_poll()) {
+            poll_cycle_monitor(now);
+        }
+        if (now >= batch_flush_at_) {
+            flush_batches();
+        }
+    }
+    if (past_drain_deadline()) {
+        // Blocs incomplets : plus le temps de les décoder
+        drain_lost_ += drop_batches();
+    } else {
+        flush_batches();
     }
 
     std::cout << "DBC Decoder thread stopped" << std::endl;
 }
 
+void DbcDecoder::worker_loop(DecodeWorker* worker) {
+    apply_thread_tuning("dbc-worker-" + std::to_string(worker->index), decoder_tuning_);
+    SequencedFrame item;
+
+    auto handle = [&]() {
+        DecodeResult result;
+        result.seq = item.seq;
+        result.ready = true;
+        result.has_message = decode_frame(item.frame, *item.compiled, worker->context, result.message);
+        results_.push(std::move(result));
+    };
+
+    while (worker->queue.wait_and_pop(item)) {
+        if (past_drain_deadline()) {
+            drain_lost_ += 1 + worker->queue.clear();
+            continue;
+        }
+        handle();
+    }
+}
+
+void DbcDecoder::merger_loop() {
+    apply_thread_tuning("mf4-writer", writer_tuning_);
+    std::cout << "DBC Decoder merger thread started (" << workers_.size() << " workers)" << std::endl;
+
+    // Fenêtre de réordonnancement indexée par numéro de séquence
+    std::deque<DecodeResult> window;
+    uint64_t next_seq = 0;
+
+    auto insert = [&](DecodeResult&& result) {
+        const size_t index = static_cast<size_t>(result.seq - next_seq);
+        if (index >= window.size()) {
+            window.resize(index + 1);
+        }
+        window[index] = std::move(result);
+        merger_ready_.fetch_add(1, std::memory_order_relaxed);
+
+        while (!window.empty() && window.front().ready) {
+            if (window.front().has_message) {
+                emit(window.front().message);
+            } else if (window.front().has_event) {
+                output_->write_event(window.front().event);
+            } else if (window.front().reload) {
+                // Plus aucune trame de l'ancien DBC en vol : il est libéré avec le marqueur
+                switch_outputs(*window.front().reload);
+            }
+            window.pop_front();
+            ++next_seq;
+            merger_ready_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    };
+
+    DecodeResult result;
+    while (results_.wait_and_pop(result)) {
+        if (past_drain_deadline()) {
+            // Résultats décodés mais plus le temps de les écrire
+            const auto ready = std::count_if(window.begin(), window.end(),
+                                             [](const DecodeResult& pending) { return pending.ready; });
+            drain_lost_ += 1 + static_cast<uint64_t>(ready) + results_.clear();
+            window.clear();
+            merger_ready_.store(0, std::memory_order_relaxed);
+            continue;
+        }
+        insert(std::move(result));
+    }
+
+    if (!window.empty()) {
+        std::cerr << "DBC Decoder merger stopped with " << window.size()
+                  << " out-of-order results pending" << std::endl;
+    }
+
+    std::cout << "DBC Decoder merger thread stopped" << std::endl;
+}
+
 bool DbcDecoder::start(std::shared_ptr<ThreadSafeQueue<CanFrame>> input_queue,
-                       Mf4Writer* writer) {
+                       OutputSink* output) {
     if (running_.load()) {
         std::cerr << "DBC Decoder already running" << std::endl;
         return false;
     }
 
-    if (!input_queue || !writer) {
+    if (!input_queue || !output) {
         std::cerr << "Invalid resources provided to DBC Decoder" << std::endl;
         return false;
     }
 
-    if (!load_dbc_file()) {
+    auto dbc = load_dbc_file();
+    if (!dbc) {
         return false;
     }
+    triggers_ = std::move(dbc->triggers);
+    dbc_ = std::move(dbc);
+    if (dbc_->signal_table && !dbc_->signal_table->activate()) {
+        return false;
+    }
+    generation_ = 0;
+    cycle_monitor_.reset();
+    if (cycle_timeout_cycles_ > 0.0) {
+        cycle_monitor_ = std::make_unique<CycleMonitor>(cycle_timeout_cycles_);
+        cycle_monitor_->configure(dbc_->cycle_entries, std::chrono::steady_clock::now());
+    }
+    reset_batches(*dbc_);
+    if (batch_frames_ > 0 && dbc_->batch_slots == 0 && (worker_count_ > 1 || !triggers_.empty())) {
+        std::cout << "Batch decode: needs a single decode thread and no trigger, decoding frame by frame" << std::endl;
+    }
+
+    if (!triggers_.empty()) {
+        // L'état des déclencheurs est global : un seul thread de décodage
+        if (worker_count_ > 1) {
+            std::cout << "Trigger mode: decoding on a single thread" << std::endl;
+            worker_count_ = 1;
+        }
+        pre_trigger_ring_.reset(trigger_settings_.buffer_frames);
+        event_active_ = false;
+        ring_short_logged_ = false;
+        std::cout << "Trigger mode: " << trigger_settings_.expressions.size() << " trigger(s), "
+                  << trigger_settings_.pre_trigger.count() << " ms before / "
+                  << trigger_settings_.post_trigger.count() << " ms after, buffer of "
+                  << trigger_settings_.buffer_frames << " frames" << std::endl;
+    }
 
     input_queue_ = input_queue;
-    writer_ = writer;
+    output_ = output;
+    decimation_.set_rules(decimation_rules_);
+    main_context_.decimation.set_rules(decimation_rules_);
+    next_seq_ = 0;
+    draining_.store(false);
+    drain_lost_.store(0);
+    merger_ready_.store(0);
+
+    input_queue_->reopen();
+    results_.reopen();
+    if (worker_count_ > 1) {
+        for (size_t i = 0; i < worker_count_; ++i) {
+            auto worker = std::make_unique<DecodeWorker>();
+            worker->index = i;
+            worker->context.decimation.set_rules(decimation_rules_);
+            worker->thread = std::make_unique<std::thread>(&DbcDecoder::worker_loop, this, worker.get());
+            workers_.push_back(std::move(worker));
+        }
+        merger_thread_ = std::make_unique<std::thread>(&DbcDecoder::merger_loop, this);
+    }
 
     running_.store(true);
     decoder_thread_ = std::make_unique<std::thread>(&DbcDecoder::decoder_loop, this);
+
+    reload_stop_.store(false);
+    reload_event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (reload_event_fd_ >= 0) {
+        reload_thread_ = std::make_unique<std::thread>(&DbcDecoder::reload_loop, this);
+    } else {
+        std::cerr << "DBC reload unavailable: eventfd failed: " << strerror(errno) << std::endl;
+    }
     
     return true;
 }
 
-void DbcDecoder::stop() {
+bool DbcDecoder::load_offline() {
+    if (running_.load()) {
+        std::cerr << "DBC Decoder already running" << std::endl;
+        return false;
+    }
+    auto dbc = load_dbc_file();
+    if (!dbc) {
+        return false;
+    }
+    dbc_ = std::move(dbc);
+    reset_batches(*dbc_);
+    decimation_.set_rules(decimation_rules_);
+    main_context_.decimation.set_rules(decimation_rules_);
+    return true;
+}
+
+bool DbcDecoder::decode_offline(const CanFrame& frame, CanMessage& decoded_message) {
+    const CompiledMessage* compiled = dbc_ ? accept_frame(frame) : nullptr;
+    return compiled && decode_frame(frame, *compiled, main_context_, decoded_message);
+}
+
+bool DbcDecoder::decode_block_offline(const CanFrame* frames, size_t count, MessageBlock& block) {
+    if (!dbc_ || count == 0 || count > BATCH_MAX_FRAMES) {
+        return false;
+    }
+    auto it = dbc_->message_map.find(frames[0].can_id);
+    if (it == dbc_->message_map.end() || !it->second.batch) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        std::memcpy(&offline_block_.words[i], frames[i].data, sizeof(uint64_t));
+        offline_block_.timestamps[i] = frames[i].timestamp;
+    }
+    decode_block(it->second, offline_block_.words, offline_block_.timestamps, count, block);
+    return true;
+}
+
+DrainStats DbcDecoder::drain_and_stop(std::chrono::steady_clock::time_point deadline) {
+    DrainStats stats;
     if (running_.load()) {
         running_.store(false);
-        
+
+        // Plus de rechargement pendant l'arrêt ; un DBC publié mais pas encore pris est abandonné
+        if (reload_thread_) {
+            reload_stop_.store(true);
+            request_reload();
+            if (reload_thread_->joinable()) {
+                reload_thread_->join();
+            }
+            reload_thread_.reset();
+        }
+        if (reload_event_fd_ >= 0) {
+            close(reload_event_fd_);
+            reload_event_fd_ = -1;
+        }
+        reload_pending_.store(false);
+        std::atomic_store(&pending_dbc_, std::shared_ptr<CompiledDbc>());
+
+        stats.pending = input_queue_->size() + results_.size() + batch_queued_frames_.load() + merger_ready_.load();
+        for (const auto& worker : workers_) {
+            stats.pending += worker->queue.size();
+        }
+        drain_deadline_ = deadline;
+        draining_.store(true, std::memory_order_release);
+
+        // Réveille le décodeur, qui traite les trames restantes puis sort
+        input_queue_->close();
         if (decoder_thread_ && decoder_thread_->joinable()) {
             decoder_thread_->join();
         }
+
+        // Fenêtre en cours : le fichier d'événement est finalisé tel quel
+        close_event();
+
+        // Les workers vident leur file, puis le merger écrit les derniers résultats
+        for (auto& worker : workers_) {
+            worker->queue.close();
+        }
+        for (auto& worker : workers_) {
+            if (worker->thread && worker->thread->joinable()) {
+                worker->thread->join();
+            }
+        }
+        results_.close();
+        if (merger_thread_ && merger_thread_->joinable()) {
+            merger_thread_->join();
+        }
         
         input_queue_.reset();
         decoder_thread_.reset();
-        network_.reset();
-        message_map_.clear();
-        writer_ = nullptr;
+        workers_.clear();
+        merger_thread_.reset();
+        if (dbc_ && dbc_->signal_table) {
+            dbc_->signal_table->close();
+        }
+        dbc_.reset();
+        output_ = nullptr;
+        if (cycle_monitor_ && cycle_monitor_->total_timeouts() > 0) {
+            std::cout << "Cycle time monitoring: " << cycle_monitor_->total_timeouts() << " missing message events" << std::endl;
+        }
+        cycle_monitor_.reset();
+
+        draining_.store(false);
+        stats.lost = drain_lost_.load();
+        stats.deadline_reached = stats.lost > 0;
         
         std::cout << "DBC Decoder stopped" << std::endl;
     }
+    return stats;
 }
@@ -0,0 +1,202 @@
+#include "decimation.h"
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+std::string DecimationRule::describe(double cycle_time_ms) const {
+    std::ostringstream oss;
+    double effective_hz = 0.0;
+
+    switch (mode) {
+        case DecimationMode::EveryNth:
+            oss << "1 frame out of " << factor;
+            if (cycle_time_ms > 0.0) {
+                effective_hz = 1000.0 / (cycle_time_ms * factor);
+            }
+            break;
+        case DecimationMode::MinInterval: {
+            const double interval_ms = min_interval.count() / 1000.0;
+            oss << "min interval " << interval_ms << " ms";
+            if (cycle_time_ms > 0.0) {
+                // Une trame est gardée sur le premier cycle qui dépasse l'intervalle
+                const double cycles = std::max(1.0, std::ceil(interval_ms / cycle_time_ms));
+                effective_hz = 1000.0 / (cycles * cycle_time_ms);
+            } else if (interval_ms > 0.0) {
+                oss << " (<= " << std::fixed << std::setprecision(2) << 1000.0 / interval_ms << " Hz)";
+            }
+            break;
+        }
+        case DecimationMode::BlockAverage:
+            oss << "block average of " << factor << " frames";
+            if (cycle_time_ms > 0.0) {
+                effective_hz = 1000.0 / (cycle_time_ms * factor);
+            }
+            break;
+        case DecimationMode::None:
+            oss << "none";
+            break;
+    }
+
+    if (effective_hz > 0.0) {
+        oss << " (~" << std::fixed << std::setprecision(2) << effective_hz
+            << " Hz effective, source cycle " << std::setprecision(1) << cycle_time_ms << " ms)";
+    }
+    return oss.str();
+}
+
+static bool parse_interval(const std::string& text, std::chrono::microseconds& out) {
+    size_t pos = 0;
+    double value = 0.0;
+    try {
+        value = std::stod(text, &pos);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    const std::string suffix = text.substr(pos);
+    double us = 0.0;
+    if (suffix.empty() || suffix == "ms") {
+        us = value * 1000.0;
+    } else if (suffix == "us") {
+        us = value;
+    } else if (suffix == "s") {
+        us = value * 1000000.0;
+    } else {
+        return false;
+    }
+
+    if (us <= 0.0) {
+        return false;
+    }
+    out = std::chrono::microseconds(static_cast<int64_t>(us));
+    return true;
+}
+
+bool parse_decimation_spec(const std::string& spec, uint32_t& can_id,
+                           DecimationRule& rule, std::string& error) {
+    const auto first = spec.find(':');
+    const auto second = (first == std::string::npos) ? std::string::npos : spec.find(':', first + 1);
+    if (second == std::string::npos) {
+        error = "expected ID:MODE:VALUE";
+        return false;
+    }
+
+    const std::string id_text = spec.substr(0, first);
+    const std::string mode_text = spec.substr(first + 1, second - first - 1);
+    const std::string value_text = spec.substr(second + 1);
+
+    try {
+        size_t pos = 0;
+        const unsigned long id = std::stoul(id_text, &pos, 0);
+        if (pos != id_text.size()) {
+            throw std::invalid_argument(id_text);
+        }
+        can_id = static_cast<uint32_t>(id);
+    } catch (const std::exception&) {
+        error = "invalid CAN ID '" + id_text + "'";
+        return false;
+    }
+
+    rule = DecimationRule{};
+    if (mode_text == "nth" || mode_text == "avg") {
+        unsigned long factor = 0;
+        try {
+            size_t pos = 0;
+            factor = std::stoul(value_text, &pos);
+            // Chaîne entière consommée ("12abc" refusé), pas de négatif ramené modulo
+            if (pos != value_text.size() || value_text.front() == '-' || factor > UINT32_MAX) {
+                factor = 0;
+            }
+        } catch (const std::exception&) {
+            factor = 0;
+        }
+        if (factor < 1) {
+            error = "invalid factor '" + value_text + "'";
+            return false;
+        }
+        rule.mode = (mode_text == "nth") ? DecimationMode::EveryNth : DecimationMode::BlockAverage;
+        rule.factor = static_cast<uint32_t>(factor);
+    } else if (mode_text == "interval") {
+        if (!parse_interval(value_text, rule.min_interval)) {
+            error = "invalid interval '" + value_text + "'";
+            return false;
+        }
+        rule.mode = DecimationMode::MinInterval;
+    } else {
+        error = "unknown mode '" + mode_text + "' (expected nth, interval or avg)";
+        return false;
+    }
+
+    return true;
+}
+
+void DecimationFilter::set_rules(const DecimationRules& rules) {
+    states_.clear();
+    for (const auto& [can_id, rule] : rules) {
+        if (rule.mode == DecimationMode::None) {
+            continue;
+        }
+        State state;
+        state.rule = rule;
+        states_.emplace(can_id, std::move(state));
+    }
+}
+
+bool DecimationFilter::accept(const CanFrame& frame) {
+    auto it = states_.find(frame.can_id);
+    if (it == states_.end()) {
+        return true;
+    }
+
+    State& state = it->second;
+    switch (state.rule.mode) {
+        case DecimationMode::EveryNth: {
+            const bool keep = (state.counter == 0);
+            if (++state.counter >= state.rule.factor) {
+                state.counter = 0;
+            }
+            return keep;
+        }
+        case DecimationMode::MinInterval:
+            if (state.has_last && frame.timestamp - state.last_kept < state.rule.min_interval) {
+                return false;
+            }
+            state.last_kept = frame.timestamp;
+            state.has_last = true;
+            return true;
+        default:
+            return true;
+    }
+}
+
+bool DecimationFilter::accumulate(uint32_t can_id, uint32_t layout_id, std::vector<DecodedSignal>& signals) {
+    auto it = states_.find(can_id);
+    if (it == states_.end() || it->second.rule.mode != DecimationMode::BlockAverage) {
+        return true;
+    }
+
+    const uint32_t factor = it->second.rule.factor;
+    Block& block = it->second.blocks[layout_id];
+    if (block.counter == 0 || block.sums.size() != signals.size()) {
+        block.sums.assign(signals.size(), 0.0);
+        block.counter = 0;
+    }
+
+    for (size_t i = 0; i < signals.size(); ++i) {
+        block.sums[i] += signals[i].value;
+    }
+
+    if (++block.counter < factor) {
+        return false;
+    }
+
+    // Bloc complet : la moyenne est horodatée avec la dernière trame du bloc
+    const double divisor = static_cast<double>(block.counter);
+    for (size_t i = 0; i < signals.size(); ++i) {
+        signals[i].value = block.sums[i] / divisor;
+    }
+    block.counter = 0;
+    return true;
+}
@@ -0,0 +1,319 @@
+#include "json_value.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdint>
+
+class JsonParser {
+private:
+    const std::string& text_;
+    size_t pos_ = 0;
+    std::string error_;
+
+    static constexpr int MAX_DEPTH = 64;
+
+    void skip_whitespace() {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) {
+            ++pos_;
+        }
+    }
+
+    bool fail(const std::string& message) {
+        if (error_.empty()) {
+            // Position en ligne/colonne pour des messages lisibles
+            size_t line = 1;
+            size_t column = 1;
+            for (size_t i = 0; i < pos_ && i < text_.size(); ++i) {
+                if (text_[i] == '\n') {
+                    ++line;
+                    column = 1;
+                } else {
+                    ++column;
+                }
+            }
+            std::ostringstream oss;
+            oss << message << " at line " << line << ", column " << column;
+            error_ = oss.str();
+        }
+        return false;
+    }
+
+    bool consume_literal(const char* literal) {
+        size_t i = 0;
+        while (literal[i] != '\0') {
+            if (pos_ + i >= text_.size() || text_[pos_ + i] != literal[i]) {
+                return fail(std::string("invalid literal, expected '") + literal + "'");
+            }
+            ++i;
+        }
+        pos_ += i;
+        return true;
+    }
+
+    static void append_utf8(std::string& out, uint32_t codepoint) {
+        if (codepoint < 0x80) {
+            out += static_cast<char>(codepoint);
+        } else if (codepoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codepoint >> 6));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else if (codepoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codepoint >> 12));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (codepoint >> 18));
+            out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    bool parse_hex4(uint32_t& value) {
+        if (pos_ + 4 > text_.size()) {
+            return fail("truncated unicode escape");
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = text_[pos_++];
+            value <<= 4;
+            if (c >= '0' && c <= '9') {
+                value |= static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                value |= static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                value |= static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                return fail("invalid unicode escape");
+            }
+        }
+        return true;
+    }
+
+    bool parse_string(std::string& out) {
+        ++pos_;  // guillemet ouvrant
+        out.clear();
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_++];
+            if (c == '"') {
+                return true;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return fail("control character in string");
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos_ >= text_.size()) {
+                break;
+            }
+            const char escape = text_[pos_++];
+            switch (escape) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t codepoint = 0;
+                    if (!parse_hex4(codepoint)) {
+                        return false;
+                    }
+                    if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                        uint32_t low = 0;
+                        if (pos_ + 2 > text_.size() || text_[pos_] != '\\' || text_[pos_ + 1] != 'u') {
+                            return fail("unpaired surrogate");
+                        }
+                        pos_ += 2;
+                        if (!parse_hex4(low) || low < 0xDC00 || low > 0xDFFF) {
+                            return fail("invalid surrogate pair");
+                        }
+                        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, codepoint);
+                    break;
+                }
+                default:
+                    return fail("invalid escape sequence");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parse_number(JsonValue& out) {
+        const size_t start = pos_;
+        if (text_[pos_] == '-') {
+            ++pos_;
+        }
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_];
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                ++pos_;
+            } else {
+                break;
+            }
+        }
+        const std::string token = text_.substr(start, pos_ - start);
+        char* end = nullptr;
+        const double value = std::strtod(token.c_str(), &end);
+        if (token.empty() || end != token.c_str() + token.size()) {
+            pos_ = start;
+            return fail("invalid number");
+        }
+        out.type_ = JsonValue::Type::Number;
+        out.number_ = value;
+        return true;
+    }
+
+    bool parse_value(JsonValue& out, int depth) {
+        if (depth > MAX_DEPTH) {
+            return fail("nesting too deep");
+        }
+        skip_whitespace();
+        if (pos_ >= text_.size()) {
+            return fail("unexpected end of input");
+        }
+
+        const char c = text_[pos_];
+        if (c == '{') {
+            ++pos_;
+            out.type_ = JsonValue::Type::Object;
+            skip_whitespace();
+            if (pos_ < text_.size() && text_[pos_] == '}') {
+                ++pos_;
+                return true;
+            }
+            while (true) {
+                skip_whitespace();
+                if (pos_ >= text_.size() || text_[pos_] != '"') {
+                    return fail("expected object key");
+                }
+                std::string key;
+                if (!parse_string(key)) {
+                    return false;
+                }
+                skip_whitespace();
+                if (pos_ >= text_.size() || text_[pos_] != ':') {
+                    return fail("expected ':'");
+                }
+                ++pos_;
+                JsonValue member;
+                if (!parse_value(member, depth + 1)) {
+                    return false;
+                }
+                out.object_.emplace_back(std::move(key), std::move(member));
+                skip_whitespace();
+                if (pos_ < text_.size() && text_[pos_] == ',') {
+                    ++pos_;
+                    continue;
+                }
+                if (pos_ < text_.size() && text_[pos_] == '}') {
+                    ++pos_;
+                    return true;
+                }
+                return fail("expected ',' or '}'");
+            }
+        }
+        if (c == '[') {
+            ++pos_;
+            out.type_ = JsonValue::Type::Array;
+            skip_whitespace();
+            if (pos_ < text_.size() && text_[pos_] == ']') {
+                ++pos_;
+                return true;
+            }
+            while (true) {
+                JsonValue element;
+                if (!parse_value(element, depth + 1)) {
+                    return false;
+                }
+                out.array_.emplace_back(std::move(element));
+                skip_whitespace();
+                if (pos_ < text_.size() && text_[pos_] == ',') {
+                    ++pos_;
+                    continue;
+                }
+                if (pos_ < text_.size() && text_[pos_] == ']') {
+                    ++pos_;
+                    return true;
+                }
+                return fail("expected ',' or ']'");
+            }
+        }
+        if (c == '"') {
+            out.type_ = JsonValue::Type::String;
+            return parse_string(out.string_);
+        }
+        if (c == 't') {
+            out.type_ = JsonValue::Type::Bool;
+            out.bool_ = true;
+            return consume_literal("true");
+        }
+        if (c == 'f') {
+            out.type_ = JsonValue::Type::Bool;
+            out.bool_ = false;
+            return consume_literal("false");
+        }
+        if (c == 'n') {
+            out.type_ = JsonValue::Type::Null;
+            return consume_literal("null");
+        }
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            return parse_number(out);
+        }
+        return fail("unexpected character");
+    }
+
+public:
+    explicit JsonParser(const std::string& text) : text_(text) {}
+
+    bool parse(JsonValue& out) {
+        if (!parse_value(out, 0)) {
+            return false;
+        }
+        skip_whitespace();
+        if (pos_ != text_.size()) {
+            return fail("trailing characters");
+        }
+        return true;
+    }
+
+    const std::string& error() const { return error_; }
+};
+
+bool JsonValue::parse(const std::string& text, JsonValue& out, std::string& error) {
+    JsonParser parser(text);
+    out = JsonValue{};
+    if (!parser.parse(out)) {
+        error = parser.error();
+        return false;
+    }
+    return true;
+}
+
+bool JsonValue::parse_file(const std::string& path, JsonValue& out, std::string& error) {
+    std::ifstream stream(path);
+    if (!stream.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::ostringstream content;
+    content << stream.rdbuf();
+    return parse(content.str(), out, error);
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    if (type_ != Type::Object) {
+        return nullptr;
+    }
+    for (const auto& [name, value] : object_) {
+        if (name == key) {
+            return &value;
+        }
+    }
+    return nullptr;
+}
@@ -5,13 +5,25 @@
 #include <chrono>
 #include <getopt.h>
 #include <filesystem>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cerrno>
 
 #include "thread_safe_queue.h"
 #include "can_frame.h"
 #include "can_reader.h"
 #include "dbc_decoder.h"
 #include "mf4_writer.h"
+#include "sharded_mf4_writer.h"
+#include "columnar_writer.h"
+#include "retention_manager.h"
+#include "stream_server.h"
 #include "signal_handler.h"
+#include "selection_profile.h"
+#include "thread_tuning.h"
+#include "bus_stats.h"
+#include "transport_reader.h"
 
 void print_usage(const char* program_name) {
     std::cout << "Usage: " << program_name << " [OPTIONS]\n"
@@ -19,16 +31,121 @@ void print_usage(const char* program_name) {
               << "  --dbc PATH          Path to DBC file (required)\n"
               << "  --output-dir PATH   Output directory for MF4 files (required)\n"
               << "  --interface NAME    CAN interface name (default: can1)\n"
+              << "  --profile PATH      JSON selection profile: record only the listed messages/signals\n"
+              << "  --decode-workers N  Decoder threads, frames sharded by CAN ID (default: CPU count)\n"
+              << "  --decimate SPEC     Per-ID decimation, repeatable. SPEC is ID:nth:N (keep 1 frame\n"
+              << "                      out of N), ID:interval:T (min interval, e.g. 20ms) or\n"
+              << "                      ID:avg:N (block average of N frames)\n"
+              << "  --sched STAGE:POLICY:PRIO  Scheduling for a stage (reader, decoder, writer),\n"
+              << "                      POLICY is other, fifo or rr (e.g. reader:fifo:80)\n"
+              << "  --affinity STAGE:CPUS CPU affinity for a stage (e.g. reader:0 or decoder:1-3)\n"
+              << "                      The writer stage needs --decode-workers >= 2 or --mf4-shards\n"
+              << "  --mlock             Lock process memory (mlockall) and prefault stacks/heap\n"
+              << "  --prefault-mb N     Heap prefaulted with --mlock (default: 16)\n"
+              << "  --sync-interval SEC fdatasync the MF4 file at least every SEC seconds (default: 5, 0=off)\n"
+              << "  --sync-mb N         fdatasync the MF4 file every N MB written (default: 1, 0=off)\n"
+              << "  --no-prealloc       Do not preallocate MF4 files to the rotation size\n"
+              << "  --checkpoint-interval SEC  Make the MF4 file readable up to the last SEC seconds (default: 10, 0=off)\n"
+              << "  --trigger EXPR      Event recording: only write the window around EXPR, repeatable\n"
+              << "                      (e.g. \"ABS_Active == 1 && VehicleSpeed > 80\" or \"DTC_Count > 0\")\n"
+              << "  --pre-trigger SEC   Seconds kept before a trigger (default: 30)\n"
+              << "  --post-trigger SEC  Seconds recorded after a trigger (default: 10)\n"
+              << "  --trigger-buffer N  Raw frames kept for the pre-trigger window (default: 262144)\n"
+              << "  --max-disk-mb N     Keep finished MF4 files under N MB in total (default: unlimited)\n"
+              << "  --max-files N       Keep at most N finished MF4 files (default: unlimited)\n"
+              << "  --min-free-mb N     Remove oldest files to keep N MB free on the partition (default: off)\n"
+              << "  --archive-dir PATH  Move files out of the budget to PATH instead of deleting them\n"
+              << "  --columnar          Also write a columnar .cck file next to each MF4 file\n"
+              << "                      (format described in include/columnar_format.h)\n"
+              << "  --shm-name NAME     Publish latest signal values in POSIX shared memory NAME\n"
+              << "                      (e.g. /can_signals, read with include/shm_signal_table.h)\n"
+              << "  --stream-socket PATH  Stream decoded samples to local clients on a Unix socket\n"
+              << "                      (binary protocol described in include/stream_server.h)\n"
+              << "  --stream-buffer-kb N  Buffer per stream subscriber before dropping (default: 1024)\n"
+              << "  --watch-dbc         Reload the DBC when the file changes (SIGHUP always reloads)\n"
+              << "  --cycle-timeout K   Monitor messages with a GenMsgCycleTime: interval statistics\n"
+              << "                      every second, missing after K cycles without frame (MF4 event)\n"
+              << "  --batch-decode N    Decode messages with a GenMsgCycleTime <= 10 ms in blocks of\n"
+              << "                      up to N frames (2-64, single decode thread; frames wait <= 50 ms)\n"
+              << "  --transport PROTO   Receive DBC messages longer than 8 bytes through the kernel\n"
+              << "                      transport: j1939 (BAM/RTS-CTS, by PGN) or isotp (listen mode)\n"
+              << "  --mf4-shards N      Write MF4 files from N threads, CAN IDs split between them\n"
+              << "                      (one file per shard, common time base and rotations)\n"
+              << "  --bus-stats BITRATE Record bus load, error frames and frame rates per CAN ID\n"
+              << "                      (bitrate of the interface in bit/s; disables the kernel ID filter)\n"
+              << "  --shutdown-deadline-ms N  Time allowed to flush queued frames and finalize the MF4\n"
+              << "                      file on SIGTERM/SIGINT (default: 3000): 3/4 bound the drain,\n"
+              << "                      finalization gets the rest but cannot be cut short\n"
               << "  --help              Show this help message\n"
               << "\nExample:\n"
               << "  " << program_name << " --dbc my_can.dbc --output-dir /tmp/mf4_data\n"
+              << "  " << program_name << " --dbc my_can.dbc --output-dir /tmp/mf4_data --decimate 0x1A0:interval:20ms\n"
               << std::endl;
 }
 
+// Arguments numériques : la chaîne entière doit être lue et la valeur dans
+// [min_value, max_value], sinon erreur et usage ("5G" ou "1O" ne valent pas 0)
+uint64_t parse_unsigned_option(const char* program_name, const char* option, const char* text,
+                               uint64_t min_value, uint64_t max_value) {
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long long value = std::strtoull(text, &end, 10);
+    if (text[0] < '0' || text[0] > '9' || *end != '\0' || errno == ERANGE
+        || value < min_value || value > max_value) {
+        std::cerr << "Error: --" << option << " expects an integer between " << min_value << " and "
+                  << max_value << ", got '" << text << "'" << std::endl;
+        print_usage(program_name);
+        exit(1);
+    }
+    return value;
+}
+
+double parse_double_option(const char* program_name, const char* option, const char* text,
+                           double min_value, double max_value) {
+    char* end = nullptr;
+    errno = 0;
+    const double value = std::strtod(text, &end);
+    if (end == text || *end != '\0' || errno == ERANGE || !(value >= min_value && value <= max_value)) {
+        std::cerr << "Error: --" << option << " expects a number between " << min_value << " and "
+                  << max_value << ", got '" << text << "'" << std::endl;
+        print_usage(program_name);
+        exit(1);
+    }
+    return value;
+}
+
 struct Config {
     std::string dbc_file;
     std::string output_dir;
     std::string can_interface = "can1";
+    std::string profile_file;
+    size_t decode_workers = std::max(1u, std::thread::hardware_concurrency());
+    ThreadTuning reader_tuning;
+    ThreadTuning decoder_tuning;
+    ThreadTuning writer_tuning;
+    bool lock_memory = false;
+    StoragePolicy storage_policy;
+    RetentionPolicy retention_policy;
+    TriggerSettings trigger_settings;
+    size_t prefault_mb = 16;
+    std::chrono::milliseconds shutdown_deadline{3000};
+    bool columnar_output = false;
+    std::string shm_name;
+    StreamSettings stream_settings;
+    bool watch_dbc = false;
+    uint32_t bus_bitrate = 0;   // 0 : statistiques du bus désactivées
+    double cycle_timeout_cycles = 0.0;   // 0 : pas de surveillance des temps de cycle
+    size_t batch_frames = 0;   // 0 : décodage trame par trame
+    TransportProtocol transport_protocol = TransportProtocol::None;
+    size_t mf4_shards = 1;   // 1 : un seul writer MF4
+
+    ThreadTuning* stage_tuning(const std::string& stage) {
+        if (stage == "reader") return &reader_tuning;
+        if (stage == "decoder") return &decoder_tuning;
+        if (stage == "writer") return &writer_tuning;
+        return nullptr;
+    }
+    DecimationRules decimation_rules;
     
     bool is_valid() const {
         return !dbc_file.empty() && !output_dir.empty();
@@ -42,6 +159,36 @@ Config parse_arguments(int argc, char* argv[]) {
         {"dbc",        required_argument, 0, 'd'},
         {"output-dir", required_argument, 0, 'o'},
         {"interface",  required_argument, 0, 'i'},
+        {"decimate",   required_argument, 0, 'D'},
+        {"profile",    required_argument, 0, 'p'},
+        {"decode-workers", required_argument, 0, 'w'},
+        {"sched",      required_argument, 0, 's'},
+        {"affinity",   required_argument, 0, 'a'},
+        {"mlock",      no_argument,       0, 'm'},
+        {"prefault-mb", required_argument, 0, 'P'},
+        {"sync-interval", required_argument, 0, 'S'},
+        {"sync-mb",    required_argument, 0, 'M'},
+        {"no-prealloc", no_argument,      0, 'N'},
+        {"checkpoint-interval", required_argument, 0, 'C'},
+        {"trigger",    required_argument, 0, 't'},
+        {"pre-trigger", required_argument, 0, 'e'},
+        {"post-trigger", required_argument, 0, 'E'},
+        {"trigger-buffer", required_argument, 0, 'R'},
+        {"max-disk-mb", required_argument, 0, 'b'},
+        {"max-files",  required_argument, 0, 'f'},
+        {"min-free-mb", required_argument, 0, 'F'},
+        {"archive-dir", required_argument, 0, 'A'},
+        {"shutdown-deadline-ms", required_argument, 0, 'T'},
+        {"columnar",   no_argument,       0, 'c'},
+        {"shm-name",   required_argument, 0, 'x'},
+        {"stream-socket", required_argument, 0, 'u'},
+        {"stream-buffer-kb", required_argument, 0, 'U'},
+        {"watch-dbc",  no_argument,       0, 'W'},
+        {"bus-stats",  required_argument, 0, 'B'},
+        {"cycle-timeout", required_argument, 0, 'k'},
+        {"batch-decode", required_argument, 0, 'J'},
+        {"transport",  required_argument, 0, 'j'},
+        {"mf4-shards", required_argument, 0, 'H'},
         {"help",       no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
@@ -49,7 +196,7 @@ Config parse_arguments(int argc, char* argv[]) {
     int option_index = 0;
     int c;
     
-    while ((c = getopt_long(argc, argv, "d:o:i:h", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "d:o:i:D:p:w:s:a:mP:S:M:NC:t:e:E:R:b:f:F:A:T:cx:u:U:WB:k:J:j:H:h", long_options, &option_index)) != -1) {
         switch (c) {
             case 'd':
                 config.dbc_file = optarg;
@@ -60,6 +207,129 @@ Config parse_arguments(int argc, char* argv[]) {
             case 'i':
                 config.can_interface = optarg;
                 break;
+            case 'w':
+                config.decode_workers = static_cast<size_t>(parse_unsigned_option(argv[0], "decode-workers", optarg, 1, 256));
+                break;
+            case 's':
+            case 'a': {
+                std::string stage;
+                std::string error;
+                ThreadTuning parsed;
+                const bool ok = (c == 's') ? parse_sched_spec(optarg, stage, parsed, error)
+                                           : parse_affinity_spec(optarg, stage, parsed, error);
+                ThreadTuning* tuning = config.stage_tuning(stage);
+                if (!ok || !tuning) {
+                    std::cerr << "Error: invalid " << (c == 's' ? "--sched" : "--affinity") << " '" << optarg
+                              << "': " << (ok ? "unknown stage '" + stage + "'" : error) << std::endl;
+                    exit(1);
+                }
+                if (c == 's') {
+                    tuning->policy = parsed.policy;
+                    tuning->priority = parsed.priority;
+                } else {
+                    tuning->cpus = parsed.cpus;
+                }
+                break;
+            }
+            case 'm':
+                config.lock_memory = true;
+                break;
+            case 'P':
+                config.prefault_mb = static_cast<size_t>(parse_unsigned_option(argv[0], "prefault-mb", optarg, 0, 1024));
+                break;
+            case 'S':
+                config.storage_policy.sync_interval = std::chrono::seconds(parse_unsigned_option(argv[0], "sync-interval", optarg, 0, 86400));
+                break;
+            case 'M':
+                config.storage_policy.sync_bytes = static_cast<size_t>(parse_unsigned_option(argv[0], "sync-mb", optarg, 0, 1024)) * 1024 * 1024;
+                break;
+            case 'N':
+                config.storage_policy.preallocate = false;
+                break;
+            case 'C':
+                config.storage_policy.checkpoint_interval = std::chrono::seconds(parse_unsigned_option(argv[0], "checkpoint-interval", optarg, 0, 86400));
+                break;
+            case 't':
+                config.trigger_settings.expressions.push_back(optarg);
+                break;
+            case 'e':
+                config.trigger_settings.pre_trigger = std::chrono::milliseconds(
+                    static_cast<int64_t>(parse_double_option(argv[0], "pre-trigger", optarg, 0.0, 3600.0) * 1000.0));
+                break;
+            case 'E':
+                config.trigger_settings.post_trigger = std::chrono::milliseconds(
+                    static_cast<int64_t>(parse_double_option(argv[0], "post-trigger", optarg, 0.0, 3600.0) * 1000.0));
+                break;
+            case 'R':
+                config.trigger_settings.buffer_frames = static_cast<size_t>(parse_unsigned_option(argv[0], "trigger-buffer", optarg, 1, 16 * 1024 * 1024));
+                break;
+            case 'b':
+                config.retention_policy.max_bytes = parse_unsigned_option(argv[0], "max-disk-mb", optarg, 0, 1ull << 30) * 1024 * 1024;
+                break;
+            case 'f':
+                config.retention_policy.max_files = static_cast<size_t>(parse_unsigned_option(argv[0], "max-files", optarg, 0, 10000000));
+                break;
+            case 'F':
+                config.retention_policy.min_free_bytes = parse_unsigned_option(argv[0], "min-free-mb", optarg, 0, 1ull << 30) * 1024 * 1024;
+                break;
+            case 'A':
+                config.retention_policy.archive_dir = optarg;
+                break;
+            case 'T':
+                config.shutdown_deadline = std::chrono::milliseconds(
+                    parse_unsigned_option(argv[0], "shutdown-deadline-ms", optarg, 1, 600000));
+                break;
+            case 'c':
+                config.columnar_output = true;
+                break;
+            case 'W':
+                config.watch_dbc = true;
+                break;
+            case 'B':
+                // Débit de l'interface en bit/s (CAN FD compris)
+                config.bus_bitrate = static_cast<uint32_t>(parse_unsigned_option(argv[0], "bus-stats", optarg, 1, 20000000));
+                break;
+            case 'k':
+                config.cycle_timeout_cycles = parse_double_option(argv[0], "cycle-timeout", optarg, 1.0, 1000.0);
+                break;
+            case 'J':
+                config.batch_frames = static_cast<size_t>(parse_unsigned_option(argv[0], "batch-decode", optarg, 2, BATCH_MAX_FRAMES));
+                break;
+            case 'j':
+                if (!parse_transport_protocol(optarg, config.transport_protocol)) {
+                    std::cerr << "Error: --transport must be j1939 or isotp" << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'H':
+                config.mf4_shards = static_cast<size_t>(parse_unsigned_option(argv[0], "mf4-shards", optarg, 1, 16));
+                break;
+            case 'x':
+                config.shm_name = optarg;
+                if (config.shm_name.empty() || config.shm_name[0] != '/') {
+                    config.shm_name.insert(0, "/");
+                }
+                break;
+            case 'u':
+                config.stream_settings.socket_path = optarg;
+                break;
+            case 'U':
+                config.stream_settings.buffer_bytes = static_cast<size_t>(parse_unsigned_option(argv[0], "stream-buffer-kb", optarg, 1, 1024 * 1024)) * 1024;
+                break;
+            case 'p':
+                config.profile_file = optarg;
+                break;
+            case 'D': {
+                uint32_t can_id = 0;
+                DecimationRule rule;
+                std::string error;
+                if (!parse_decimation_spec(optarg, can_id, rule, error)) {
+                    std::cerr << "Error: invalid --decimate '" << optarg << "': " << error << std::endl;
+                    exit(1);
+                }
+                config.decimation_rules[can_id] = rule;
+                break;
+            }
             case 'h':
                 print_usage(argv[0]);
                 exit(0);
@@ -86,6 +356,18 @@ bool validate_config(const Config& config) {
         return false;
     }
     
+    if (!config.profile_file.empty() && !std::filesystem::exists(config.profile_file)) {
+        std::cerr << "Error: Selection profile does not exist: " << config.profile_file << std::endl;
+        return false;
+    }
+
+    // La base de temps d'une fenêtre est fixée à l'ouverture des fichiers, avant
+    // les trames de pré-déclenchement qui sont plus anciennes
+    if (config.mf4_shards > 1 && config.trigger_settings.enabled()) {
+        std::cerr << "Error: --mf4-shards cannot be combined with --trigger" << std::endl;
+        return false;
+    }
+    
     // Create output directory if it doesn't exist
     try {
         std::filesystem::create_directories(config.output_dir);
@@ -112,77 +394,321 @@ int main(int argc, char* argv[]) {
               << "  DBC file: " << config.dbc_file << "\n"
               << "  Output directory: " << config.output_dir << "\n"
               << "  CAN interface: " << config.can_interface << "\n"
-              << std::endl;
+              << "  Decode workers: " << config.decode_workers << "\n"
+              << "  Reader thread: " << config.reader_tuning.describe() << "\n"
+              << "  Decoder threads: " << config.decoder_tuning.describe() << "\n"
+              << "  Writer thread: " << config.writer_tuning.describe() << "\n"
+              << "  Storage: preallocate=" << (config.storage_policy.preallocate ? "yes" : "no")
+              << " sync every " << config.storage_policy.sync_interval.count() << " s / "
+              << config.storage_policy.sync_bytes / (1024 * 1024) << " MB, checkpoint every "
+              << config.storage_policy.checkpoint_interval.count() << " s\n"
+              << "  Disk budget: " << config.retention_policy.describe() << "\n"
+              << "  Shutdown deadline: " << config.shutdown_deadline.count() << " ms\n";
+    if (!config.profile_file.empty()) {
+        std::cout << "  Selection profile: " << config.profile_file << "\n";
+    }
+    for (const auto& [can_id, rule] : config.decimation_rules) {
+        std::cout << "  Decimation 0x" << std::hex << can_id << std::dec
+                  << ": " << rule.describe(0.0) << "\n";
+    }
+    for (const auto& expression : config.trigger_settings.expressions) {
+        std::cout << "  Trigger: " << expression << "\n";
+    }
+    if (config.watch_dbc) {
+        std::cout << "  DBC reload: on file change and SIGHUP\n";
+    }
+    if (config.cycle_timeout_cycles > 0.0) {
+        std::cout << "  Cycle time monitoring: missing after " << config.cycle_timeout_cycles << " cycles\n";
+    }
+    // Les blocs n'existent que sur le décodeur mono-thread, hors déclenchement
+    const bool batch_active = config.decode_workers <= 1 && !config.trigger_settings.enabled();
+    if (config.batch_frames > 0) {
+        std::cout << "  Batch decode: " << (batch_active ? "blocks of " + std::to_string(config.batch_frames) + " frames"
+                                                         : std::string("inactive, decoding frame by frame")) << "\n";
+    }
+    if (config.transport_protocol != TransportProtocol::None) {
+        std::cout << "  Transport: " << transport_protocol_name(config.transport_protocol)
+                  << " (messages longer than 8 bytes)\n";
+    }
+    if (config.mf4_shards > 1) {
+        std::cout << "  MF4 shards: " << config.mf4_shards << " writer threads\n";
+    }
+    if (config.bus_bitrate > 0) {
+        std::cout << "  Bus statistics: " << config.bus_bitrate << " bit/s\n";
+    }
+    if (config.columnar_output) {
+        std::cout << "  Columnar output: enabled (.cck)\n";
+    }
+    if (!config.shm_name.empty()) {
+        std::cout << "  Shared signal table: " << config.shm_name << "\n";
+    }
+    if (config.stream_settings.enabled()) {
+        std::cout << "  Stream socket: " << config.stream_settings.socket_path << "\n";
+    }
+    std::cout << std::endl;
+
+    if (config.batch_frames > 0 && !batch_active) {
+        std::cerr << "⚠️  --batch-decode ignored: blocks need --decode-workers 1 (default is one worker per core) "
+                  << "and no --trigger" << std::endl;
+    }
+
+    // Avec un seul thread de décodage (un worker, ou mode déclenchement) et
+    // sans shards, le MF4 est écrit par le thread du décodeur : pas de thread
+    // writer à régler, seuls les réglages "decoder" s'appliquent
+    const bool single_decode_thread = config.decode_workers <= 1 || config.trigger_settings.enabled();
+    if (!config.writer_tuning.is_default() && single_decode_thread && config.mf4_shards <= 1) {
+        std::cerr << "⚠️  Writer thread tuning ignored: MF4 is written by the single decoder thread "
+                  << "(use --sched/--affinity decoder, or --decode-workers >= 2 / --mf4-shards)" << std::endl;
+    }
+    
+    if (config.lock_memory) {
+        lock_process_memory(config.prefault_mb * 1024 * 1024);
+        config.reader_tuning.prefault_stack = true;
+        config.decoder_tuning.prefault_stack = true;
+        config.writer_tuning.prefault_stack = true;
+    }
+    
+    std::shared_ptr<SelectionProfile> selection;
+    if (!config.profile_file.empty()) {
+        selection = std::make_shared<SelectionProfile>();
+        if (!selection->load(config.profile_file)) {
+            return 1;
+        }
+    }
     
     // Create thread-safe queues
     auto raw_frames_queue = std::make_shared<ThreadSafeQueue<CanFrame>>();
     
     // Create components
+    auto retention = std::make_unique<RetentionManager>(config.output_dir, config.retention_policy);
+    // Détruit après le décodeur, qui publie dedans
+    std::unique_ptr<StreamServer> stream_server;
+    if (config.stream_settings.enabled()) {
+        stream_server = std::make_unique<StreamServer>(config.stream_settings);
+    }
+    // Partagé par le reader (écriture), le décodeur et le writer : détruit après eux
+    std::unique_ptr<BusStatistics> bus_stats;
+    if (config.bus_bitrate > 0) {
+        bus_stats = std::make_unique<BusStatistics>(config.can_interface, config.bus_bitrate);
+    }
+    // Charges lues par le décodeur : détruit après lui
+    std::unique_ptr<TransportInbox> transport_inbox;
+    std::unique_ptr<TransportReader> transport_reader;
+    if (config.transport_protocol != TransportProtocol::None) {
+        transport_inbox = std::make_unique<TransportInbox>();
+        transport_reader = std::make_unique<TransportReader>(config.can_interface, config.transport_protocol,
+                                                             transport_inbox.get());
+    }
     auto can_reader = std::make_unique<CanReader>(config.can_interface);
     auto dbc_decoder = std::make_unique<DbcDecoder>(config.dbc_file);
     auto mf4_writer = std::make_unique<Mf4Writer>(config.output_dir, config.dbc_file);
+    std::unique_ptr<ColumnarWriter> columnar_writer;
+    if (config.columnar_output) {
+        columnar_writer = std::make_unique<ColumnarWriter>(config.output_dir);
+        columnar_writer->set_storage_policy(config.storage_policy);
+        columnar_writer->set_retention_manager(retention.get());
+    }
+    if (stream_server) {
+        dbc_decoder->set_stream_server(stream_server.get());
+    }
+    dbc_decoder->set_decimation_rules(config.decimation_rules);
+    mf4_writer->set_decimation_rules(config.decimation_rules);
+    dbc_decoder->set_selection_profile(selection);
+    dbc_decoder->set_worker_count(config.decode_workers);
+    dbc_decoder->set_thread_tuning(config.decoder_tuning, config.writer_tuning);
+    dbc_decoder->set_shared_table_name(config.shm_name);
+    dbc_decoder->set_watch_dbc(config.watch_dbc);
+    if (bus_stats) {
+        can_reader->set_bus_statistics(bus_stats.get());
+        dbc_decoder->set_bus_statistics(bus_stats.get());
+        mf4_writer->set_bus_statistics(bus_stats.get());
+    }
+    if (transport_reader) {
+        dbc_decoder->set_transport(config.transport_protocol, transport_inbox.get());
+        mf4_writer->set_transport_protocol(config.transport_protocol);
+        transport_reader->set_thread_tuning(config.reader_tuning);
+    }
+    dbc_decoder->set_cycle_monitoring(config.cycle_timeout_cycles);
+    mf4_writer->set_cycle_monitoring(config.cycle_timeout_cycles);
+    if (config.batch_frames > 0) {
+        dbc_decoder->set_batch_decode(config.batch_frames);
+        // Marge au-delà de l'attente maximale d'un bloc (réveil du décodeur)
+        mf4_writer->set_anchor_margin(2 * DbcDecoder::BATCH_MAX_DELAY);
+    }
+    if (selection && !bus_stats) {
+        // Filtre noyau mis à jour après un rechargement (thread du décodeur)
+        CanReader* reader = can_reader.get();
+        dbc_decoder->set_can_ids_listener([reader](const std::vector<uint32_t>& can_ids) {
+            reader->update_id_filter(can_ids);
+        });
+    }
+    can_reader->set_thread_tuning(config.reader_tuning);
+    mf4_writer->set_selection_profile(selection);
+    mf4_writer->set_storage_policy(config.storage_policy);
+    mf4_writer->set_retention_manager(retention.get());
+    const bool trigger_mode = config.trigger_settings.enabled();
+    if (trigger_mode) {
+        // Un fichier par événement, ouvert par le décodeur
+        dbc_decoder->set_trigger_settings(config.trigger_settings);
+        // Ouverture du fichier et relecture du pré-déclenchement bloquent le
+        // décodeur : la file brute est bornée à la taille de l'anneau
+        can_reader->set_max_queued(config.trigger_settings.buffer_frames);
+        mf4_writer->set_file_prefix("event_");
+        if (columnar_writer) {
+            columnar_writer->set_file_prefix("event_");
+        }
+    }
+
+    // Shards : writers configurés comme mf4_writer, qui ne sert plus que de modèle
+    std::unique_ptr<ShardedMf4Writer> sharded_writer;
+    OutputSink* mf4_output = mf4_writer.get();
+    if (config.mf4_shards > 1) {
+        sharded_writer = std::make_unique<ShardedMf4Writer>(*mf4_writer, config.mf4_shards);
+        sharded_writer->set_thread_tuning(config.writer_tuning);
+        mf4_output = sharded_writer.get();
+    }
+
+    // Le décodeur écrit dans une seule sortie : le MF4, ou la diffusion vers
+    // le MF4 et le fichier colonnes
+    SinkFanout output_fanout;
+    OutputSink* output = mf4_output;
+    if (columnar_writer) {
+        output_fanout.add_sink(mf4_output);
+        output_fanout.add_sink(columnar_writer.get());
+        output = &output_fanout;
+        // Le .cck tourne avec le MF4 (placé avant lui dans la diffusion) : les
+        // deux fichiers d'une fenêtre couvrent les mêmes messages
+        ColumnarWriter* columnar = columnar_writer.get();
+        columnar->follow_rotation(true);
+        auto rotate_columnar = [columnar]() { columnar->request_rotation(); };
+        if (sharded_writer) {
+            sharded_writer->set_rotation_listener(rotate_columnar);
+        } else {
+            mf4_writer->set_rotation_listener(rotate_columnar);
+        }
+    }
     
-    // Setup cleanup callback for graceful shutdown
-    SignalHandler::set_cleanup_callback([&]() {
-        std::cout << "Initiating component shutdown..." << std::endl;
-        
-        // Stop components in reverse order
-        if (mf4_writer) mf4_writer->stop();
-        if (dbc_decoder) dbc_decoder->stop();
-        if (can_reader) can_reader->stop();
-    });
-    
-    // Install signal handlers
+    // Install signal handlers (components are stopped below, in pipeline order)
     SignalHandler::install_handlers();
     
     // Start components
     std::cout << "Starting components..." << std::endl;
 
-    if (!mf4_writer->start()) {
-        std::cerr << "Failed to start MF4 writer" << std::endl;
+    // Libère de la place avant d'ouvrir le premier fichier
+    if (!retention->start()) {
+        std::cerr << "Failed to start retention manager" << std::endl;
+        return 1;
+    }
+
+    if (!(trigger_mode ? mf4_writer->prepare() : output->start())) {
+        std::cerr << "Failed to start output writers" << std::endl;
         return 1;
     }
     
-    if (!dbc_decoder->start(raw_frames_queue, mf4_writer.get())) {
+    if (!dbc_decoder->start(raw_frames_queue, output)) {
         std::cerr << "Failed to start DBC decoder" << std::endl;
-        mf4_writer->stop();
+        output->stop();
+        return 1;
+    }
+    
+    // Le catalogue des signaux n'est connu qu'une fois le DBC chargé
+    if (stream_server && !stream_server->start(dbc_decoder->signal_catalog())) {
+        std::cerr << "Failed to start stream server" << std::endl;
+        dbc_decoder->stop();
+        output->stop();
         return 1;
     }
     
+    // Le filtre noyau ne laisse passer que les messages sélectionnés ; les
+    // statistiques du bus ont besoin de toutes les trames, le décodeur filtre alors seul
+    if (selection && !bus_stats) {
+        can_reader->set_id_filter(dbc_decoder->selected_can_ids());
+    }
+    
     if (!can_reader->start(raw_frames_queue)) {
         std::cerr << "Failed to start CAN reader" << std::endl;
         can_reader->stop();
         dbc_decoder->stop();
-        mf4_writer->stop();
+        output->stop();
         return 1;
     }
+
+    // Messages de transport du DBC chargé : filtre PGN J1939 ou sockets ISO-TP
+    if (transport_reader) {
+        transport_reader->set_flows(dbc_decoder->transport_flows());
+        if (!transport_reader->start(raw_frames_queue)) {
+            std::cerr << "Failed to start " << transport_protocol_name(config.transport_protocol)
+                      << " transport reader" << std::endl;
+            can_reader->stop();
+            dbc_decoder->stop();
+            output->stop();
+            return 1;
+        }
+    }
     
     std::cout << "All components started successfully!" << std::endl;
     std::cout << "CAN Socket Collector is running. Press Ctrl+C to stop." << std::endl;
     
-    // Main loop - wait for shutdown signal
-    while (!SignalHandler::shutdown_requested()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        
-        // Check if any component has stopped unexpectedly
-        if (!can_reader->is_running() || !dbc_decoder->is_running() || !mf4_writer->is_running()) {
-            std::cerr << "One or more components stopped unexpectedly" << std::endl;
-            SignalHandler::request_shutdown();
-            break;
+    // Main loop - sleeps until a signal arrives or a component requests shutdown
+    // (CAN read error, MF4 rotation failure), no periodic wakeup. SIGHUP only
+    // wakes it to hand the DBC reload to the decoder.
+    while (!SignalHandler::wait_for_shutdown()) {
+        if (SignalHandler::take_reload_request()) {
+            dbc_decoder->request_reload();
         }
     }
+
+    const bool writer_ok = trigger_mode || output->is_running();
+    if (!can_reader->is_running() || !dbc_decoder->is_running() || !writer_ok) {
+        std::cerr << "One or more components stopped unexpectedly" << std::endl;
+    }
     
     std::cout << "Stopping components..." << std::endl;
     
-    // Stop components in reverse order
-    mf4_writer->stop();
-    dbc_decoder->stop();
+    // Arrêt dans l'ordre du pipeline : plus de nouvelles trames, le décodeur
+    // vide ses files dans un writer encore ouvert, puis le fichier est finalisé.
+    // Les trois quarts du délai servent au vidage, le reste à la finalisation.
+    const auto shutdown_start = std::chrono::steady_clock::now();
     can_reader->stop();
+    if (transport_reader) {
+        transport_reader->stop();
+    }
+    const auto drain_deadline = shutdown_start + config.shutdown_deadline * 3 / 4;
+    if (sharded_writer) {
+        // Les files des shards se vident pendant celui du décodeur, même échéance
+        sharded_writer->set_stop_deadline(drain_deadline);
+    }
+    const DrainStats drain = dbc_decoder->drain_and_stop(drain_deadline);
+    // Plus rien à publier ni à supprimer : le dernier quart du délai reste à
+    // la finalisation des fichiers. Elle ne peut pas être interrompue (en-têtes
+    // MF4 réécrits par mdflib) : un dépassement est seulement signalé. Le
+    // dernier fichier fermé est pris en compte par la rétention au démarrage suivant.
+    if (stream_server) {
+        stream_server->stop();
+    }
+    retention->stop();
+    const auto finalize_start = std::chrono::steady_clock::now();
+    output->stop();
+    const auto finalize_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - finalize_start).count();
+    const auto shutdown_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - shutdown_start).count();
     
-    // Print final statistics
-    std::cout << "Final queue sizes:\n"
-              << "  Raw frames: " << raw_frames_queue->size() << "\n"
+    const uint64_t writer_dropped = sharded_writer ? sharded_writer->dropped_messages() : mf4_writer->dropped_messages();
+    const RotationStats rotations = sharded_writer ? sharded_writer->rotation_stats() : mf4_writer->rotation_stats();
+    std::cout << "Shutdown drain:\n"
+              << "  Frames flushed: " << drain.flushed() << "\n"
+              << "  Frames lost: " << drain.lost << (drain.deadline_reached ? " (drain deadline reached)" : "") << "\n"
+              << "  Frames dropped by reader (queue full): " << can_reader->queue_drops() << "\n"
+              << "  Messages dropped by writer: " << writer_dropped << "\n"
+              << "  MF4 rotations: " << rotations.count << (sharded_writer ? " over all shards" : "") << " (mean "
+              << rotations.mean_ms() << " ms, max " << rotations.max_ms << " ms)\n"
+              << "  Finalization: " << finalize_ms << " ms\n"
+              << "  Duration: " << shutdown_ms << " ms (deadline " << config.shutdown_deadline.count() << " ms)\n"
               << std::endl;
+    if (shutdown_ms > config.shutdown_deadline.count()) {
+        std::cerr << "⚠️  Shutdown exceeded its deadline, MF4 finalization took longer than expected" << std::endl;
+    }
     
     std::cout << "CAN Socket Collector stopped gracefully." << std::endl;
     
@@ -0,0 +1,521 @@
+#include "mf4_repair.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace {
+
+constexpr size_t ID_BLOCK_SIZE = 64;
+constexpr size_t BLOCK_HEADER_SIZE = 24;
+constexpr size_t SCAN_CHUNK_SIZE = 64 * 1024;
+constexpr size_t MAX_CHAIN_LENGTH = 65536;   // garde-fou contre les chaînes corrompues
+constexpr uint16_t CG_FLAG_VLSD = 0x0001;
+constexpr uint8_t CN_TYPE_MASTER = 2;
+constexpr uint8_t CN_DATA_TYPE_FLOAT_LE = 4;
+
+const char FINALIZED_ID[] = "MDF     ";
+const char UNFINALIZED_ID[] = "UnFinMF ";
+
+uint64_t load_le(const uint8_t* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+void store_le(uint8_t* data, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+bool read_exact(int fd, uint64_t offset, void* buffer, size_t size) {
+    auto* out = static_cast<uint8_t*>(buffer);
+    while (size > 0) {
+        const ssize_t rc = pread(fd, out, size, static_cast<off_t>(offset));
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            return false;
+        }
+        out += rc;
+        offset += static_cast<uint64_t>(rc);
+        size -= static_cast<size_t>(rc);
+    }
+    return true;
+}
+
+bool write_exact(int fd, uint64_t offset, const void* buffer, size_t size) {
+    const auto* in = static_cast<const uint8_t*>(buffer);
+    while (size > 0) {
+        const ssize_t rc = pwrite(fd, in, size, static_cast<off_t>(offset));
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            return false;
+        }
+        in += rc;
+        offset += static_cast<uint64_t>(rc);
+        size -= static_cast<size_t>(rc);
+    }
+    return true;
+}
+
+bool write_u64(int fd, uint64_t offset, uint64_t value) {
+    uint8_t bytes[8];
+    store_le(bytes, value, sizeof(bytes));
+    return write_exact(fd, offset, bytes, sizeof(bytes));
+}
+
+// En-tête, liens et début de la section données d'un bloc
+struct Block {
+    char id[4] = {};
+    uint64_t length = 0;
+    std::vector<uint64_t> links;
+    std::vector<uint8_t> data;
+    uint64_t data_offset = 0;   // position de la section données dans le fichier
+
+    bool is(const char* expected) const { return std::memcmp(id, expected, 4) == 0; }
+};
+
+bool read_block(int fd, uint64_t offset, size_t max_data, Block& block) {
+    uint8_t header[BLOCK_HEADER_SIZE];
+    if (offset == 0 || !read_exact(fd, offset, header, sizeof(header))) {
+        return false;
+    }
+    if (header[0] != '#' || header[1] != '#') {
+        return false;
+    }
+    std::memcpy(block.id, header, 4);
+    block.length = load_le(header + 8, 8);
+    const uint64_t link_count = load_le(header + 16, 8);
+    if (block.length < BLOCK_HEADER_SIZE + link_count * 8) {
+        return false;
+    }
+
+    block.links.assign(link_count, 0);
+    if (link_count > 0) {
+        std::vector<uint8_t> raw(link_count * 8);
+        if (!read_exact(fd, offset + BLOCK_HEADER_SIZE, raw.data(), raw.size())) {
+            return false;
+        }
+        for (size_t i = 0; i < link_count; ++i) {
+            block.links[i] = load_le(raw.data() + i * 8, 8);
+        }
+    }
+
+    block.data_offset = offset + BLOCK_HEADER_SIZE + link_count * 8;
+    const uint64_t data_size = block.length - BLOCK_HEADER_SIZE - link_count * 8;
+    block.data.assign(static_cast<size_t>(std::min<uint64_t>(data_size, max_data)), 0);
+    return block.data.empty() || read_exact(fd, block.data_offset, block.data.data(), block.data.size());
+}
+
+// Un bloc valide commence (après bourrage jusqu'à l'alignement 8) par "##XX" suivi de 4 octets nuls
+bool looks_like_block(int fd, uint64_t offset, uint64_t file_size) {
+    if (offset >= file_size) {
+        return offset == file_size;
+    }
+    const uint64_t aligned = (offset + 7) & ~uint64_t(7);
+    const uint64_t padding_end = std::min(aligned, file_size);
+    if (padding_end > offset) {
+        uint8_t padding[8] = {};
+        if (!read_exact(fd, offset, padding, static_cast<size_t>(padding_end - offset))) {
+            return false;
+        }
+        for (uint64_t i = 0; i < padding_end - offset; ++i) {
+            if (padding[i] != 0) {
+                return false;
+            }
+        }
+    }
+    if (aligned >= file_size) {
+        return true;
+    }
+    uint8_t header[BLOCK_HEADER_SIZE];
+    if (aligned + sizeof(header) > file_size || !read_exact(fd, aligned, header, sizeof(header))) {
+        return false;
+    }
+    return header[0] == '#' && header[1] == '#' && load_le(header + 4, 4) == 0
+        && load_le(header + 8, 8) >= BLOCK_HEADER_SIZE;
+}
+
+// Canal maître flottant 64 bits du groupe (celui que crée Mf4Writer)
+void read_master_channel(int fd, uint64_t cn_offset, Mf4GroupLayout& group) {
+    for (size_t guard = 0; cn_offset != 0 && guard < MAX_CHAIN_LENGTH; ++guard) {
+        Block cn;
+        if (!read_block(fd, cn_offset, 12, cn) || !cn.is("##CN") || cn.data.size() < 12) {
+            return;
+        }
+        if (cn.data[0] == CN_TYPE_MASTER) {
+            if (cn.data[2] == CN_DATA_TYPE_FLOAT_LE && cn.data[3] == 0 && load_le(cn.data.data() + 8, 4) == 64) {
+                group.has_master = true;
+                group.master_byte_offset = static_cast<uint32_t>(load_le(cn.data.data() + 4, 4));
+            }
+            return;
+        }
+        cn_offset = cn.links.empty() ? 0 : cn.links[0];
+    }
+}
+
+bool read_groups(int fd, uint64_t cg_offset, Mf4DataLayout& layout, std::string& error) {
+    layout.groups.clear();
+    for (size_t guard = 0; cg_offset != 0; ++guard) {
+        Block cg;
+        if (guard >= MAX_CHAIN_LENGTH || !read_block(fd, cg_offset, 32, cg) || !cg.is("##CG") || cg.data.size() < 32) {
+            error = "invalid CG block at offset " + std::to_string(cg_offset);
+            return false;
+        }
+        Mf4GroupLayout group;
+        group.block_offset = cg_offset;
+        group.record_id = load_le(cg.data.data(), 8);
+        group.cycle_count = load_le(cg.data.data() + 8, 8);
+        group.cycle_count_offset = cg.data_offset + 8;
+        group.vlsd = (load_le(cg.data.data() + 16, 2) & CG_FLAG_VLSD) != 0;
+        group.record_bytes = static_cast<uint32_t>(load_le(cg.data.data() + 24, 4) + load_le(cg.data.data() + 28, 4));
+        if (!group.vlsd && cg.links.size() > 1) {
+            read_master_channel(fd, cg.links[1], group);
+        }
+        layout.groups.push_back(group);
+        cg_offset = cg.links.empty() ? 0 : cg.links[0];
+    }
+    if (layout.groups.empty()) {
+        error = "data group without channel group";
+        return false;
+    }
+    return true;
+}
+
+// Lit un enregistrement à la fois depuis un tampon glissant
+class RecordReader {
+private:
+    int fd_;
+    uint64_t limit_;
+    std::vector<uint8_t> buffer_;
+    uint64_t buffer_offset_ = 0;
+    size_t buffer_size_ = 0;
+
+public:
+    RecordReader(int fd, uint64_t limit) : fd_(fd), limit_(limit), buffer_(SCAN_CHUNK_SIZE) {}
+
+    // Pointer to `size` bytes at `offset`, nullptr if they are beyond the limit
+    const uint8_t* fetch(uint64_t offset, size_t size) {
+        if (offset + size > limit_) {
+            return nullptr;
+        }
+        if (offset < buffer_offset_ || offset + size > buffer_offset_ + buffer_size_) {
+            if (size > buffer_.size()) {
+                buffer_.resize(size);
+            }
+            buffer_size_ = static_cast<size_t>(std::min<uint64_t>(buffer_.size(), limit_ - offset));
+            buffer_offset_ = offset;
+            if (!read_exact(fd_, offset, buffer_.data(), buffer_size_)) {
+                buffer_size_ = 0;
+                return nullptr;
+            }
+        }
+        return buffer_.data() + (offset - buffer_offset_);
+    }
+};
+
+}  // namespace
+
+bool read_mf4_layout(int fd, Mf4DataLayout& layout, std::string& error) {
+    layout = Mf4DataLayout{};
+
+    uint8_t id[ID_BLOCK_SIZE];
+    if (!read_exact(fd, 0, id, sizeof(id))) {
+        error = "file too short";
+        return false;
+    }
+    if (std::memcmp(id, FINALIZED_ID, 8) == 0) {
+        layout.finalized_id = true;
+    } else if (std::memcmp(id, UNFINALIZED_ID, 8) != 0) {
+        error = "not an MDF file";
+        return false;
+    }
+    if (load_le(id + 28, 2) < 400) {
+        error = "MDF version older than 4.0 is not supported";
+        return false;
+    }
+
+    Block hd;
+    if (!read_block(fd, ID_BLOCK_SIZE, 0, hd) || !hd.is("##HD") || hd.links.empty()) {
+        error = "invalid HD block";
+        return false;
+    }
+
+    // Le data group ouvert est celui dont le bloc DT est le plus loin dans le fichier
+    uint64_t dg_offset = hd.links[0];
+    for (size_t guard = 0; dg_offset != 0; ++guard) {
+        Block dg;
+        if (guard >= MAX_CHAIN_LENGTH || !read_block(fd, dg_offset, 1, dg) || !dg.is("##DG")
+            || dg.links.size() < 3 || dg.data.empty()) {
+            error = "invalid DG block at offset " + std::to_string(dg_offset);
+            return false;
+        }
+
+        const uint64_t data_link = dg.links[2];
+        if (data_link != 0 && data_link > layout.dt_offset) {
+            Block data;
+            if (!read_block(fd, data_link, 0, data)) {
+                error = "invalid data block at offset " + std::to_string(data_link);
+                return false;
+            }
+            if (!data.is("##DT")) {
+                error = std::string("unsupported data block ") + std::string(data.id, 4) + " (only plain DT is handled)";
+                return false;
+            }
+            layout.dt_offset = data_link;
+            layout.dt_length = data.length;
+            layout.record_id_size = dg.data[0];
+            if (!read_groups(fd, dg.links[1], layout, error)) {
+                return false;
+            }
+        }
+        dg_offset = dg.links[0];
+    }
+
+    if (layout.dt_offset == 0) {
+        error = "no data block yet";
+        return false;
+    }
+    if (layout.record_id_size != 0 && layout.record_id_size != 1 && layout.record_id_size != 2
+        && layout.record_id_size != 4 && layout.record_id_size != 8) {
+        error = "invalid record ID size";
+        return false;
+    }
+    return true;
+}
+
+uint64_t scan_mf4_records(int fd, const Mf4DataLayout& layout, uint64_t from, uint64_t limit,
+                          std::vector<uint64_t>& counts, Mf4TimeIndex* index) {
+    counts.resize(layout.groups.size(), 0);
+    RecordReader reader(fd, limit);
+
+    std::unordered_map<uint64_t, size_t> group_by_id;
+    for (size_t i = 0; i < layout.groups.size(); ++i) {
+        group_by_id.emplace(layout.groups[i].record_id, i);
+    }
+
+    const size_t id_size = layout.record_id_size;
+    uint64_t offset = from;
+    while (offset < limit) {
+        uint64_t record_id = 0;
+        if (id_size > 0) {
+            const uint8_t* raw_id = reader.fetch(offset, id_size);
+            if (!raw_id) {
+                break;
+            }
+            record_id = load_le(raw_id, id_size);
+        }
+
+        // Identifiant inconnu : zéros de préallocation ou écriture interrompue
+        size_t group_index = 0;
+        if (id_size > 0) {
+            const auto it = group_by_id.find(record_id);
+            if (it == group_by_id.end()) {
+                break;
+            }
+            group_index = it->second;
+        } else if (layout.groups.size() != 1) {
+            break;
+        }
+        const Mf4GroupLayout& group = layout.groups[group_index];
+
+        uint64_t payload = group.record_bytes;
+        if (group.vlsd) {
+            const uint8_t* raw_length = reader.fetch(offset + id_size, 4);
+            if (!raw_length) {
+                break;
+            }
+            payload = 4 + load_le(raw_length, 4);
+        }
+        const uint64_t record_end = offset + id_size + payload;
+        if (record_end > limit || record_end == offset) {
+            break;
+        }
+
+        if (index && group.has_master && group.master_byte_offset + sizeof(double) <= payload) {
+            const uint8_t* raw_time = reader.fetch(offset + id_size + group.master_byte_offset, sizeof(double));
+            if (raw_time) {
+                double time_s = 0.0;
+                std::memcpy(&time_s, raw_time, sizeof(time_s));
+                index->observe(time_s, offset);
+            }
+        }
+
+        ++counts[group_index];
+        offset = record_end;
+    }
+    return offset;
+}
+
+void Mf4Checkpointer::reset() {
+    layout_ = Mf4DataLayout{};
+    layout_loaded_ = false;
+    disabled_ = false;
+    scan_offset_ = 0;
+    counts_.clear();
+    checkpoints_ = 0;
+    time_index_ = Mf4TimeIndex{};
+}
+
+bool Mf4Checkpointer::checkpoint(int fd) {
+    if (disabled_) {
+        return false;
+    }
+
+    if (!layout_loaded_) {
+        std::string error;
+        if (!read_mf4_layout(fd, layout_, error)) {
+            // mdflib n'a pas encore écrit le bloc DT : on réessaiera au prochain checkpoint
+            if (error == "no data block yet") {
+                return true;
+            }
+            std::cerr << "⚠️  MF4 checkpoint disabled: " << error << std::endl;
+            disabled_ = true;
+            return false;
+        }
+        layout_loaded_ = true;
+        scan_offset_ = layout_.data_start();
+        counts_.assign(layout_.groups.size(), 0);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+
+    const uint64_t end = scan_mf4_records(fd, layout_, scan_offset_, static_cast<uint64_t>(st.st_size), counts_,
+                                          &time_index_);
+    if (end == scan_offset_) {
+        return true;
+    }
+    scan_offset_ = end;
+
+    bool ok = write_u64(fd, layout_.dt_offset + 8, scan_offset_ - layout_.dt_offset);
+    for (size_t i = 0; i < layout_.groups.size(); ++i) {
+        ok = write_u64(fd, layout_.groups[i].cycle_count_offset, counts_[i]) && ok;
+    }
+    if (!ok) {
+        std::cerr << "⚠️  MF4 checkpoint write failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    ++checkpoints_;
+    return true;
+}
+
+bool Mf4Checkpointer::finish(int fd) {
+    Mf4DataLayout layout;
+    std::string error;
+    if (!read_mf4_layout(fd, layout, error)) {
+        return false;
+    }
+    // Bloc DT déplacé (ou jamais vu) : on reprend depuis le début des données
+    if (!layout_loaded_ || layout.dt_offset != layout_.dt_offset) {
+        scan_offset_ = layout.data_start();
+        counts_.assign(layout.groups.size(), 0);
+        time_index_ = Mf4TimeIndex{};
+    }
+    layout_ = layout;
+    layout_loaded_ = true;
+    disabled_ = true;   // plus de checkpoint sur un fichier finalisé
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    const uint64_t limit = std::min<uint64_t>(layout_.dt_offset + layout_.dt_length, static_cast<uint64_t>(st.st_size));
+    if (limit > scan_offset_) {
+        scan_offset_ = scan_mf4_records(fd, layout_, scan_offset_, limit, counts_, &time_index_);
+    }
+    return true;
+}
+
+Mf4RepairResult repair_mf4_file(const std::string& path, bool dry_run) {
+    Mf4RepairResult result;
+
+    const int fd = ::open(path.c_str(), (dry_run ? O_RDONLY : O_RDWR) | O_CLOEXEC);
+    if (fd < 0) {
+        result.message = std::string("cannot open: ") + strerror(errno);
+        return result;
+    }
+
+    Mf4DataLayout layout;
+    std::string error;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !read_mf4_layout(fd, layout, error)) {
+        result.message = error.empty() ? std::string("cannot stat: ") + strerror(errno) : error;
+        ::close(fd);
+        return result;
+    }
+    const uint64_t file_size = static_cast<uint64_t>(st.st_size);
+
+    // DT cohérent : sa longueur a été écrite (finalisation ou checkpoint) et rien
+    // d'autre qu'un bloc ou la fin du fichier ne la suit
+    const uint64_t dt_end = layout.dt_offset + layout.dt_length;
+    const bool dt_consistent = layout.dt_length > BLOCK_HEADER_SIZE && dt_end <= file_size
+        && looks_like_block(fd, dt_end, file_size);
+
+    if (layout.finalized_id && dt_consistent) {
+        result.message = "already finalized";
+        ::close(fd);
+        return result;
+    }
+    result.needed = true;
+
+    std::vector<uint64_t> counts;
+    const uint64_t limit = dt_consistent ? dt_end : file_size;
+    const uint64_t end = scan_mf4_records(fd, layout, layout.data_start(), limit, counts);
+    for (uint64_t count : counts) {
+        result.records += count;
+    }
+    if (!dt_consistent) {
+        result.truncated_bytes = file_size - end;
+    }
+
+    std::ostringstream oss;
+    oss << result.records << " records recovered";
+    if (result.truncated_bytes > 0) {
+        oss << ", " << result.truncated_bytes << " trailing bytes dropped";
+    }
+
+    if (dry_run) {
+        result.message = oss.str() + " (dry run)";
+        ::close(fd);
+        return result;
+    }
+
+    bool ok = true;
+    if (!dt_consistent) {
+        ok = write_u64(fd, layout.dt_offset + 8, end - layout.dt_offset) && ok;
+    }
+    for (size_t i = 0; i < layout.groups.size(); ++i) {
+        ok = write_u64(fd, layout.groups[i].cycle_count_offset, counts[i]) && ok;
+    }
+
+    // ID finalisé, drapeaux id_unfin_flags et id_custom_unfin_flags remis à zéro
+    uint8_t id_tail[4] = {};
+    ok = write_exact(fd, 0, FINALIZED_ID, 8) && write_exact(fd, 60, id_tail, sizeof(id_tail)) && ok;
+
+    if (ok && result.truncated_bytes > 0 && ftruncate(fd, static_cast<off_t>(end)) != 0) {
+        ok = false;
+    }
+    if (ok && fdatasync(fd) != 0) {
+        ok = false;
+    }
+
+    result.repaired = ok;
+    result.message = ok ? oss.str() : std::string("write failed: ") + strerror(errno);
+    ::close(fd);
+    return result;
+}
@@ -7,6 +7,16 @@
 #include <fstream>
 #include <cmath>
 #include <atomic>
+#include <variant>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <map>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <mdf/mdfwriter.h>
 #include <mdf/mdffactory.h>
 #include <mdf/idatagroup.h>
@@ -14,7 +24,15 @@
 #include <mdf/ichannel.h>
 #include <mdf/cgcomment.h>
 #include <mdf/samplerecord.h>
+#include <mdf/iheader.h>
+#include <mdf/ievent.h>
 #include <dbcppp/Network.h>
+#include "mux_layout.h"
+#include "mf4_repair.h"
+#include "retention_manager.h"
+#include "bus_stats.h"
+#include "cycle_monitor.h"
+#include "signal_handler.h"
 
 Mf4Writer::Mf4Writer(const std::string& output_dir, const std::string& dbc_file) 
     : output_directory_(output_dir)
@@ -25,23 +43,92 @@ Mf4Writer::Mf4Writer(const std::string& output_dir, const std::string& dbc_file)
     
     // Create output directory if it doesn't exist
     std::filesystem::create_directories(output_directory_);
+
+    // Identifiant de session : heure de démarrage et 32 bits aléatoires
+    const auto start_time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    const auto start_tm = *std::localtime(&start_time);
+    std::ostringstream session;
+    session << std::put_time(&start_tm, "%Y%m%dT%H%M%S") << "-" << std::hex << std::setw(8)
+            << std::setfill('0') << std::random_device{}();
+    session_id_ = session.str();
+
+    // Le checkpointer n'est utilisé que depuis le thread de synchronisation du fichier courant
+    storage_.set_checkpoint_hook([this](int fd) { checkpointer_.checkpoint(fd); });
 }
 
 Mf4Writer::~Mf4Writer() {
     stop();
 }
 
+std::unique_ptr<Mf4Writer> Mf4Writer::clone_configuration() const {
+    auto writer = std::make_unique<Mf4Writer>(output_directory_, dbc_file_path_);
+    writer->file_prefix_ = file_prefix_;
+    writer->storage_policy_ = storage_policy_;
+    writer->anchor_margin_ = anchor_margin_;
+    writer->decimation_rules_ = decimation_rules_;
+    writer->selection_ = selection_;
+    writer->retention_ = retention_;
+    writer->bus_stats_ = bus_stats_;
+    writer->cycle_timeout_cycles_ = cycle_timeout_cycles_;
+    writer->transport_protocol_ = transport_protocol_;
+    // Les lignes du manifeste de tous les shards portent la même session
+    writer->session_id_ = session_id_;
+    return writer;
+}
+
+void Mf4Writer::set_shard(size_t index, size_t count) {
+    shard_index_ = index;
+    shard_count_ = std::max<size_t>(count, 1);
+    // Layout déjà chargé (prepare()) : reconstruit avec le filtre du shard
+    dbc_loaded_ = false;
+    layout_template_ready_ = false;
+}
+
+void Mf4Writer::set_time_base(const MeasurementTimeBase& base, uint64_t window) {
+    shared_time_base_ = true;
+    time_base_ = base;
+    window_ = window;
+}
+
 std::string Mf4Writer::generate_filename() {
-    auto now = std::chrono::system_clock::now();
+    // Shards d'une même fenêtre : même heure dans le nom, celle de la base de temps
+    auto now = shared_time_base_ ? time_base_.system : std::chrono::system_clock::now();
     auto time_t = std::chrono::system_clock::to_time_t(now);
     auto tm = *std::localtime(&time_t);
     
     std::ostringstream oss;
-    oss << "can_data_" 
-        << std::put_time(&tm, "%Y%m%d_%H%M%S") 
-        << ".mf4";
-    
-    return (std::filesystem::path(output_directory_) / oss.str()).string();
+    oss << file_prefix_
+        << std::put_time(&tm, "%Y%m%d_%H%M%S");
+    if (shard_count_ > 1) {
+        oss << "_s" << shard_index_;
+    }
+    const std::string stem = oss.str();
+
+    // Deux fichiers dans la même seconde (événements rapprochés) : suffixe _N
+    auto path = std::filesystem::path(output_directory_) / (stem + ".mf4");
+    for (int index = 1; std::filesystem::exists(path); ++index) {
+        path = std::filesystem::path(output_directory_) / (stem + "_" + std::to_string(index) + ".mf4");
+    }
+    return path.string();
+}
+
+// Chaîne JSON entre guillemets (noms DBC : ASCII en pratique)
+static std::string json_string(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+    return out;
 }
 
 bool Mf4Writer::load_dbc_definitions() {
@@ -72,31 +159,88 @@ bool Mf4Writer::load_dbc_definitions() {
         return false;
     }
 
-    message_definitions_.clear();
+    if (!build_message_definitions()) {
+        return false;
+    }
 
-    for (const auto& message : dbc_network_->Messages()) {
-        MessageDefinition definition;
-        definition.can_id = message.Id();
-        definition.name = message.Name();
+    dbc_loaded_ = true;
+    std::cout << "MF4 writer loaded " << message_definitions_.size()
+              << " CAN message definitions from DBC." << std::endl;
+    return true;
+}
 
-        for (const auto& signal : message.Signals()) {
-            SignalDefinition sig_def;
-            sig_def.name = signal.Name();
-            sig_def.unit = signal.Unit();
-            definition.signals.emplace_back(std::move(sig_def));
-        }
+bool Mf4Writer::build_message_definitions() {
+    message_definitions_.clear();
+    std::vector<std::pair<std::string, double>> cycle_messages;
 
-        if (definition.signals.empty()) {
+    for (const auto& message : dbc_network_->Messages()) {
+        const uint32_t can_id = static_cast<uint32_t>(message.Id());
+        if (selection_ && !selection_->select_message(can_id, message.Name())) {
             continue;
         }
 
-        if (definition.name.empty()) {
+        std::string message_name = message.Name();
+        if (message_name.empty()) {
             std::ostringstream generated;
-            generated << "CAN_Message_0x" << std::hex << std::uppercase << definition.can_id;
-            definition.name = generated.str();
+            generated << "CAN_Message_0x" << std::hex << std::uppercase << message.Id();
+            message_name = generated.str();
+        }
+        const double cycle_time_ms = dbc_cycle_time_ms(*dbc_network_, message);
+        const size_t definitions_before = message_definitions_.size();
+
+        // Un channel group par groupe de multiplexage : les signaux inactifs ne produisent pas d'échantillons
+        MuxLayoutTable mux;
+        mux.build(message);
+        if (selection_) {
+            mux.retain_signals([&](const dbcppp::ISignal& signal) {
+                return selection_->select_signal(can_id, message.Name(), signal.Name());
+            });
         }
 
-        message_definitions_.emplace_back(std::move(definition));
+        const bool transport = is_transport_message(message, transport_protocol_);
+        for (const auto& layout : mux.layouts()) {
+            MessageDefinition definition;
+            definition.can_id = can_id;
+            definition.layout_id = layout.id;
+            definition.mux_label = layout.label;
+            definition.name = layout.label.empty() ? message_name : message_name + "_" + layout.label;
+            definition.cycle_time_ms = cycle_time_ms;
+
+            for (const auto* signal : layout.signals) {
+                SignalDefinition sig_def;
+                sig_def.name = signal->Name();
+                sig_def.unit = signal->Unit();
+                definition.signals.emplace_back(std::move(sig_def));
+            }
+
+            if (definition.signals.empty()) {
+                continue;
+            }
+
+            if (transport) {
+                // Charges réassemblées par le noyau (transport_reader.h), avec leur émetteur
+                std::ostringstream comment;
+                comment << transport_protocol_name(transport_protocol_) << " message " << definition.name;
+                if (transport_protocol_ == TransportProtocol::J1939) {
+                    comment << " (PGN 0x" << std::hex << std::uppercase << j1939_pgn(can_id) << std::dec
+                            << ", any source address)";
+                } else {
+                    comment << " (ID 0x" << std::hex << std::uppercase << (can_id & CAN_EFF_MASK) << std::dec << ")";
+                }
+                comment << ", " << message.MessageSize() << " bytes reassembled by the kernel";
+                definition.comment = comment.str();
+                for (size_t c = 0; c < transport_channel_count(transport_protocol_); ++c) {
+                    definition.signals.push_back({TRANSPORT_CHANNELS[c].name, TRANSPORT_CHANNELS[c].unit,
+                                                  TRANSPORT_CHANNELS[c].description});
+                }
+            }
+
+            message_definitions_.emplace_back(std::move(definition));
+        }
+        // Mêmes messages que ceux surveillés par le décodeur : cycliques et décodés
+        if (cycle_timeout_cycles_ > 0.0 && cycle_time_ms > 0.0 && message_definitions_.size() > definitions_before) {
+            cycle_messages.push_back({message_name, cycle_time_ms});
+        }
     }
 
     if (message_definitions_.empty()) {
@@ -104,10 +248,166 @@ bool Mf4Writer::load_dbc_definitions() {
         return false;
     }
 
+    if (bus_stats_) {
+        // Groupes hors DBC, écrits à cadence fixe par le décodeur (bus_stats.h)
+        std::ostringstream rate;
+        rate << std::chrono::duration_cast<std::chrono::milliseconds>(BusStatistics::PUBLISH_INTERVAL).count() << " ms";
+
+        MessageDefinition stats;
+        stats.can_id = BUS_STATS_CAN_ID;
+        stats.name = bus_stats_->stats_group_name();
+        stats.comment = "Bus statistics of " + bus_stats_->interface_name() + " every " + rate.str()
+                        + " (bitrate " + std::to_string(bus_stats_->bitrate()) + " bit/s): load over a 1 s sliding window"
+                        " with stuff bits, error frames by class, controller state (0 active, 1 warning,"
+                        " 2 passive, 3 bus-off), kernel socket drops";
+        for (const auto& channel : BUS_STATS_CHANNELS) {
+            stats.signals.push_back({channel.name, channel.unit, {}});
+        }
+        message_definitions_.push_back(std::move(stats));
+
+        MessageDefinition rates;
+        rates.can_id = BUS_RATES_CAN_ID;
+        rates.name = bus_stats_->rates_group_name();
+        rates.comment = "Frames per second of each DBC CAN ID on " + bus_stats_->interface_name() + " every " + rate.str();
+        for (uint32_t can_id : bus_rate_ids(*dbc_network_)) {
+            rates.signals.push_back({bus_rate_channel_name(can_id), "1/s", {}});
+        }
+        rates.signals.push_back({BUS_RATE_OTHER_CHANNEL, "1/s", {}});
+        message_definitions_.push_back(std::move(rates));
+    }
+
+    if (!cycle_messages.empty()) {
+        // Groupe hors DBC écrit par le décodeur (cycle_monitor.h)
+        std::ostringstream comment;
+        comment << "Cycle time monitoring every "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(CycleMonitor::PUBLISH_INTERVAL).count()
+                << " ms: interval between frames of each message with a GenMsgCycleTime, before decimation."
+                << " A message is missing after " << cycle_timeout_cycles_ << " cycles without frame (MF4 event)";
+        MessageDefinition cycles;
+        cycles.can_id = CYCLE_STATS_CAN_ID;
+        cycles.name = CYCLE_STATS_GROUP_NAME;
+        cycles.comment = comment.str();
+        for (const auto& [message_name, cycle_ms] : cycle_messages) {
+            for (const auto& channel : CYCLE_CHANNELS) {
+                std::ostringstream description;
+                description << channel.description << " of " << message_name << " (GenMsgCycleTime " << cycle_ms << " ms)";
+                cycles.signals.push_back({cycle_channel_name(message_name, channel), channel.unit, description.str()});
+            }
+        }
+        message_definitions_.push_back(std::move(cycles));
+    }
+
+    if (shard_count_ > 1) {
+        // Les autres CAN IDs (et groupes hors DBC) sont écrits par les autres shards
+        message_definitions_.erase(std::remove_if(message_definitions_.begin(), message_definitions_.end(),
+                                                  [this](const MessageDefinition& definition) {
+                                                      return mf4_shard_index(definition.can_id, shard_count_) != shard_index_;
+                                                  }),
+                                   message_definitions_.end());
+        if (message_definitions_.empty()) {
+            std::cerr << "MF4 shard " << shard_index_ << " has no channel group: the DBC has too few CAN IDs for "
+                      << shard_count_ << " shards" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void Mf4Writer::dbc_changed(const std::shared_ptr<const dbcppp::INetwork>& network) {
+    auto previous_network = dbc_network_;
+    auto previous_definitions = message_definitions_;
+    dbc_network_ = network;
+    if (!build_message_definitions()) {
+        std::cerr << "MF4 writer keeps the previous channel layout" << std::endl;
+        dbc_network_ = std::move(previous_network);
+        message_definitions_ = std::move(previous_definitions);
+        return;
+    }
     dbc_loaded_ = true;
-    std::cout << "MF4 writer loaded " << message_definitions_.size()
+    // Le fichier courant garde l'ancien layout jusqu'à sa fermeture
+    layout_template_ready_ = false;
+    std::cout << "MF4 writer reloaded " << message_definitions_.size()
               << " CAN message definitions from DBC." << std::endl;
-    return true;
+
+    // Un fichier MF4 n'a qu'un layout : le fichier courant est finalisé à l'échange
+    if (!mdf_writer_) {
+        return;
+    }
+    if (!create_new_file()) {
+        std::cerr << "Failed to rotate MF4 file after DBC reload" << std::endl;
+        if (!is_running()) {
+            SignalHandler::request_shutdown();
+        }
+    }
+}
+
+void Mf4Writer::build_layout_template() {
+    channel_groups_.clear();
+    layout_template_.clear();
+    layout_template_.reserve(message_definitions_.size());
+    size_t channel_count = 0;
+
+    for (const auto& definition : message_definitions_) {
+        const uint64_t key = channel_group_key(definition.can_id, definition.layout_id);
+        auto inserted = channel_groups_.emplace(key, ChannelGroupInfo());
+        if (!inserted.second) {
+            continue;
+        }
+        ChannelGroupInfo& cg_info = inserted.first->second;
+        cg_info.message_name = definition.name;
+        cg_info.mux_label = definition.mux_label;
+        cg_info.can_id = definition.can_id;
+
+        GroupTemplate group;
+        group.info = &cg_info;
+        group.name = definition.name;
+
+        std::ostringstream comment_stream;
+        if (!definition.comment.empty()) {
+            comment_stream << definition.comment;
+        } else {
+            comment_stream << "CAN message " << definition.name << " (ID 0x"
+                           << std::hex << std::uppercase << definition.can_id << std::dec << ")";
+        }
+        if (!definition.mux_label.empty()) {
+            comment_stream << " - multiplexed group " << definition.mux_label;
+        }
+        auto decimation_it = decimation_rules_.find(definition.can_id);
+        if (decimation_it != decimation_rules_.end()) {
+            comment_stream << " - decimated: " << decimation_it->second.describe(definition.cycle_time_ms);
+        }
+        group.comment = comment_stream.str();
+
+        for (const auto& signal_def : definition.signals) {
+            std::ostringstream channel_comment;
+            if (!signal_def.description.empty()) {
+                channel_comment << signal_def.description;
+            } else if (definition.comment.empty()) {
+                channel_comment << "Signal " << signal_def.name << " from CAN ID 0x"
+                                << std::hex << definition.can_id << std::dec;
+            } else {
+                channel_comment << "Statistic " << signal_def.name << " of " << definition.name;
+            }
+            if (!signal_def.unit.empty()) {
+                channel_comment << " [" << signal_def.unit << "]";
+            }
+
+            ChannelInfo channel_info;
+            channel_info.name = signal_def.name;
+            channel_info.unit = signal_def.unit;
+            auto channel_it = cg_info.channels.emplace(signal_def.name, std::move(channel_info));
+            if (!channel_it.second) {
+                continue;
+            }
+            group.channels.push_back({&channel_it.first->second, signal_def.name, signal_def.unit, channel_comment.str()});
+        }
+        channel_count += group.channels.size();
+        layout_template_.push_back(std::move(group));
+    }
+
+    layout_template_ready_ = true;
+    std::cout << "MF4 layout template: " << layout_template_.size() << " channel groups, "
+              << channel_count << " channels" << std::endl;
 }
 
 bool Mf4Writer::initialize_channel_groups() {
@@ -116,30 +416,44 @@ bool Mf4Writer::initialize_channel_groups() {
         return false;
     }
 
-    channel_groups_.clear();
+    // Seuls les blocs mdflib sont créés ici : textes précalculés, entrées de
+    // channel_groups_ rattachées au nouveau fichier et remises à zéro
+    uint64_t record_id = 0;
+    size_t configured = 0;
+    for (auto& group : layout_template_) {
+        ChannelGroupInfo& cg_info = *group.info;
+        cg_info.channel_group = nullptr;
+        cg_info.master_channel = nullptr;
+        cg_info.sample_count = 0;
+        cg_info.layout_resolved = false;
+        cg_info.direct_record = false;
+        cg_info.master_offset = 0;
+        cg_info.resolved_channels.clear();
+        cg_info.resolved_indexes.clear();
+        for (auto& channel : group.channels) {
+            channel.info->channel = nullptr;
+            channel.info->byte_offset = 0;
+            channel.info->stats = SignalStats();
+        }
 
-    for (const auto& definition : message_definitions_) {
         auto* channel_group = data_group_->CreateChannelGroup();
         if (!channel_group) {
             std::cerr << "Failed to create channel group for CAN ID 0x"
-                      << std::hex << definition.can_id << std::dec << std::endl;
+                      << std::hex << cg_info.can_id << std::dec << std::endl;
             continue;
         }
 
-        channel_group->Name(definition.name);
-        channel_group->RecordId(definition.can_id);
-
-        std::ostringstream comment_stream;
-        comment_stream << "CAN message " << definition.name << " (ID 0x"
-                       << std::hex << std::uppercase << definition.can_id << std::dec << ")";
+        channel_group->Name(group.name);
+        // Plusieurs groupes peuvent partager un CAN ID (multiplexage) : record IDs séquentiels
+        channel_group->RecordId(++record_id);
         mdf::CgComment comment;
-        comment.Comment(comment_stream.str());
+        comment.Comment(group.comment);
         channel_group->SetCgComment(comment);
 
         auto* master_channel = channel_group->CreateChannel();
         if (!master_channel) {
             std::cerr << "Failed to create master channel for CAN ID 0x"
-                      << std::hex << definition.can_id << std::dec << std::endl;
+                      << std::hex << cg_info.can_id << std::dec << std::endl;
             continue;
         }
 
@@ -153,43 +467,30 @@ bool Mf4Writer::initialize_channel_groups() {
         master_channel->DataBytes(sizeof(double));
         master_channel->Decimals(9);
 
-        ChannelGroupInfo cg_info;
-        cg_info.channel_group = channel_group;
-        cg_info.master_channel = master_channel;
-        cg_info.message_name = definition.name;
-
-        for (const auto& signal_def : definition.signals) {
+        for (auto& channel_template : group.channels) {
             auto* channel = channel_group->CreateChannel();
             if (!channel) {
-                std::cerr << "Failed to create channel " << signal_def.name
-                          << " for CAN ID 0x" << std::hex << definition.can_id << std::dec << std::endl;
+                std::cerr << "Failed to create channel " << channel_template.name
+                          << " for CAN ID 0x" << std::hex << cg_info.can_id << std::dec << std::endl;
                 continue;
             }
 
-            channel->Name(signal_def.name);
-            if (!signal_def.unit.empty()) {
-                channel->Unit(signal_def.unit);
+            channel->Name(channel_template.name);
+            if (!channel_template.unit.empty()) {
+                channel->Unit(channel_template.unit);
             }
             channel->DataType(mdf::ChannelDataType::FloatLe);
             channel->DataBytes(sizeof(double));
-
-            std::ostringstream channel_comment;
-            channel_comment << "Signal " << signal_def.name << " from CAN ID 0x"
-                            << std::hex << definition.can_id << std::dec;
-            if (!signal_def.unit.empty()) {
-                channel_comment << " [" << signal_def.unit << "]";
-            }
-            channel->Description(channel_comment.str());
-
-            cg_info.channels.emplace(signal_def.name, channel);
+            channel->Description(channel_template.description);
+            channel_template.info->channel = channel;
         }
 
-        channel_groups_.emplace(definition.can_id, std::move(cg_info));
-        std::cout << "Configured channel group: " << definition.name
-                  << " with " << definition.signals.size() << " signals." << std::endl;
+        cg_info.channel_group = channel_group;
+        cg_info.master_channel = master_channel;
+        ++configured;
     }
 
-    if (channel_groups_.empty()) {
+    if (configured == 0) {
         std::cerr << "No channel groups configured for MF4 writer." << std::endl;
         return false;
     }
@@ -198,11 +499,13 @@ bool Mf4Writer::initialize_channel_groups() {
 }
 
 bool Mf4Writer::create_new_file() {
+    const auto rotation_start = std::chrono::steady_clock::now();
+    const bool rotation = mdf_writer_ != nullptr;
     close_current_file();
+    const auto open_start = std::chrono::steady_clock::now();
     
     current_file_path_ = generate_filename();
     current_file_size_ = 0;
-    channel_groups_.clear();
     measurement_started_ = false;
     measurement_start_ns_ = 0;
     measurement_start_system_ = std::chrono::system_clock::time_point{};
@@ -222,6 +525,9 @@ bool Mf4Writer::create_new_file() {
         if (!load_dbc_definitions()) {
             return false;
         }
+        if (!layout_template_ready_) {
+            build_layout_template();
+        }
 
         if (!initialize_channel_groups()) {
             return false;
@@ -230,14 +536,42 @@ bool Mf4Writer::create_new_file() {
         // Initialize measurement after channel configuration
         mdf_writer_->InitMeasurement();
 
+        // Le fichier existe maintenant : préallocation, synchronisation contrôlée et checkpoints
+        checkpointer_.reset();
+        storage_.open(current_file_path_, storage_policy_.rotation_bytes + PREALLOCATION_SLACK, storage_policy_);
+        if (retention_) {
+            retention_->notify_file_opened(current_file_path_);
+        }
+
         // DO NOT start measurement yet - defer until first sample
         // This prevents timestamp resets when frames arrive before StartMeasurement
         measurement_started_ = false;
-        
-        std::cout << "Created new MF4 file: " << current_file_path_ << std::endl;
+        if (shared_time_base_) {
+            // Sauf en shards : début commun de la fenêtre, connu avant le premier enregistrement
+            start_measurement(0, time_base_.steady);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        last_open_ms_ = std::chrono::duration<double, std::milli>(now - open_start).count();
+        std::cout << "Created new MF4 file: " << current_file_path_ << " (" << layout_template_.size()
+                  << " channel groups in " << std::fixed << std::setprecision(1) << last_open_ms_ << " ms)"
+                  << std::defaultfloat << std::endl;
+        if (rotation) {
+            const double rotation_ms = std::chrono::duration<double, std::milli>(now - rotation_start).count();
+            ++rotation_stats_.count;
+            rotation_stats_.last_ms = rotation_ms;
+            rotation_stats_.max_ms = std::max(rotation_stats_.max_ms, rotation_ms);
+            rotation_stats_.total_ms += rotation_ms;
+            std::cout << "MF4 rotation took " << std::fixed << std::setprecision(1) << rotation_ms << " ms (finalize "
+                      << last_finalize_ms_ << " ms, open " << last_open_ms_ << " ms)" << std::defaultfloat << std::endl;
+        }
         return true;
     } catch (const std::exception& e) {
         std::cerr << "Error creating MF4 file: " << e.what() << std::endl;
+        // Partition probablement pleine : libérer de la place pour la prochaine tentative
+        if (retention_) {
+            retention_->request_check();
+        }
         return false;
     }
 }
@@ -245,6 +579,9 @@ bool Mf4Writer::create_new_file() {
 void Mf4Writer::close_current_file() {
     if (mdf_writer_) {
         try {
+            // Plus de checkpoint pendant que mdflib réécrit les en-têtes
+            storage_.quiesce();
+
             // Stop measurement first, then finalize
             if (measurement_started_) {
                 const auto stop_system = std::chrono::system_clock::now();
@@ -252,55 +589,381 @@ void Mf4Writer::close_current_file() {
                     stop_system.time_since_epoch()).count();
                 mdf_writer_->StopMeasurement(stop_ns);
             }
+            const auto finalize_start = std::chrono::steady_clock::now();
             mdf_writer_->FinalizeMeasurement();
             
             // Force flush to disk before reset
             std::cout << "Finalizing MF4 file to disk..." << std::endl;
             mdf_writer_.reset();
+
+            // mdflib a fermé le fichier : sync final et troncature à la taille réelle
+            storage_.close();
+            last_finalize_ms_ = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - finalize_start).count();
+
+            // Avant la notification : la rétention traite le fichier et son annexe ensemble
+            write_stats_sidecar();
+            append_manifest_entry();
             
+            if (retention_ && !current_file_path_.empty()) {
+                retention_->notify_file_closed(current_file_path_);
+            }
+
             if (!current_file_path_.empty()) {
                 std::cout << "Closed MF4 file: " << current_file_path_ 
-              << " (size: " << current_file_size_ << " bytes)" << std::endl;
+              << " (size: " << current_file_size_ << " bytes, "
+              << checkpointer_.checkpoint_count() << " checkpoints)" << std::endl;
             }
         } catch (const std::exception& e) {
             std::cerr << "Error closing MF4 file: " << e.what() << std::endl;
         }
     }
     
+    // Les entrées de channel_groups_ restent : rattachées au fichier suivant
     data_group_ = nullptr;
-    channel_groups_.clear();
     measurement_started_ = false;
     measurement_start_ns_ = 0;
     measurement_start_system_ = std::chrono::system_clock::time_point{};
     measurement_start_steady_ = std::chrono::steady_clock::time_point{};
 }
 
-ChannelGroupInfo* Mf4Writer::get_or_create_channel_group(uint32_t can_id) {
-    auto it = channel_groups_.find(can_id);
-    if (it != channel_groups_.end()) {
+void Mf4Writer::write_stats_sidecar() const {
+    if (current_file_path_.empty()) {
+        return;
+    }
+
+    // Ordre stable d'un fichier à l'autre : CAN ID puis layout, signaux par nom
+    std::vector<std::pair<uint64_t, const ChannelGroupInfo*>> groups;
+    for (const auto& [key, cg_info] : channel_groups_) {
+        if (cg_info.sample_count > 0) {
+            groups.emplace_back((key << 32) | (key >> 32), &cg_info);
+        }
+    }
+    std::sort(groups.begin(), groups.end());
+
+    std::ostringstream json;
+    json << std::setprecision(12);
+    json << "{\n  \"file\": " << json_string(std::filesystem::path(current_file_path_).filename().string())
+         << ",\n  \"start_ns\": " << measurement_start_ns_
+         << ",\n  \"messages\": [";
+    const char* message_separator = "";
+    for (const auto& [order, cg_info] : groups) {
+        json << message_separator << "\n    {\"name\": " << json_string(cg_info->message_name)
+             << ", \"can_id\": " << cg_info->can_id;
+        if (!cg_info->mux_label.empty()) {
+            json << ", \"mux\": " << json_string(cg_info->mux_label);
+        }
+        json << ", \"samples\": " << cg_info->sample_count << ", \"signals\": [";
+
+        std::vector<std::pair<const std::string*, const ChannelInfo*>> channels;
+        for (const auto& [name, channel_info] : cg_info->channels) {
+            if (channel_info.stats.count > 0) {
+                channels.emplace_back(&name, &channel_info);
+            }
+        }
+        std::sort(channels.begin(), channels.end(),
+                  [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+        const char* signal_separator = "";
+        for (const auto& [name, channel_info] : channels) {
+            const SignalStats& stats = channel_info->stats;
+            json << signal_separator << "\n      {\"name\": " << json_string(*name)
+                 << ", \"unit\": " << json_string(channel_info->unit)
+                 << ", \"count\": " << stats.count
+                 << ", \"min\": " << stats.min
+                 << ", \"max\": " << stats.max
+                 << ", \"mean\": " << stats.mean()
+                 << ", \"first_ns\": " << stats.first_ns
+                 << ", \"last_ns\": " << stats.last_ns
+                 << ", \"nan\": " << stats.nan_count
+                 << ", \"sanitized\": " << stats.sanitized_count << "}";
+            signal_separator = ",";
+        }
+        json << "]}";
+        message_separator = ",";
+    }
+    json << "\n  ]\n}\n";
+
+    // Écriture puis renommage : un lecteur ne voit jamais d'annexe tronquée
+    const std::string sidecar_path = current_file_path_ + STATS_SIDECAR_SUFFIX;
+    const std::string temporary_path = sidecar_path + ".tmp";
+    {
+        std::ofstream out(temporary_path, std::ios::trunc);
+        out << json.str();
+        if (!out.flush()) {
+            std::cerr << "Cannot write statistics file " << temporary_path << std::endl;
+            std::error_code ec;
+            std::filesystem::remove(temporary_path, ec);
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temporary_path, sidecar_path, ec);
+    if (ec) {
+        std::cerr << "Cannot write statistics file " << sidecar_path << ": " << ec.message() << std::endl;
+    }
+}
+
+void Mf4Writer::append_manifest_entry() {
+    if (current_file_path_.empty()) {
+        return;
+    }
+    ++file_sequence_;
+
+    // Fin de l'index temporel sur le fichier finalisé (enregistrements
+    // écrits par mdflib depuis le dernier checkpoint)
+    bool indexed = false;
+    uint64_t file_size = 0;
+    const int fd = open(current_file_path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        indexed = checkpointer_.finish(fd);
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            file_size = static_cast<uint64_t>(st.st_size);
+        }
+        ::close(fd);
+    }
+
+    uint64_t first_ns = UINT64_MAX;
+    uint64_t last_ns = 0;
+    std::map<uint32_t, uint64_t> samples_by_id;
+    for (const auto& [key, cg_info] : channel_groups_) {
+        if (cg_info.sample_count == 0) {
+            continue;
+        }
+        samples_by_id[cg_info.can_id] += cg_info.sample_count;
+        for (const auto& [name, channel_info] : cg_info.channels) {
+            if (channel_info.stats.count > 0) {
+                first_ns = std::min(first_ns, channel_info.stats.first_ns);
+                last_ns = std::max(last_ns, channel_info.stats.last_ns);
+            }
+        }
+    }
+    if (first_ns == UINT64_MAX) {
+        first_ns = 0;
+    }
+
+    std::ostringstream line;
+    line << "{\"session\": " << json_string(session_id_)
+         << ", \"sequence\": " << file_sequence_;
+    if (shard_count_ > 1) {
+        // Fichiers d'une même fenêtre : même "window" et même début de mesure dans tous les shards
+        line << ", \"window\": " << window_
+             << ", \"shard\": " << shard_index_
+             << ", \"shards\": " << shard_count_
+             << ", \"start_ns\": " << measurement_start_ns_;
+    }
+    line << ", \"file\": " << json_string(std::filesystem::path(current_file_path_).filename().string())
+         << ", \"size\": " << file_size
+         << ", \"open_ms\": " << std::fixed << std::setprecision(3) << last_open_ms_
+         << ", \"finalize_ms\": " << last_finalize_ms_ << std::defaultfloat
+         << ", \"first_ns\": " << first_ns
+         << ", \"last_ns\": " << last_ns
+         << ", \"can_ids\": [";
+    const char* separator = "";
+    for (const auto& [can_id, samples] : samples_by_id) {
+        line << separator << "[" << can_id << ", " << samples << "]";
+        separator = ", ";
+    }
+    line << "], \"slice_s\": " << checkpointer_.time_index().slice_seconds
+         << ", \"slices\": [";
+    separator = "";
+    if (indexed) {
+        for (const auto& slice : checkpointer_.time_index().slices) {
+            const auto time_ns = measurement_start_ns_ + static_cast<uint64_t>(std::llround(slice.time_s * 1e9));
+            line << separator << "[" << time_ns << ", " << slice.offset << "]";
+            separator = ", ";
+        }
+    }
+    line << "]}\n";
+
+    // Une seule écriture en O_APPEND : une ligne n'est jamais entrelacée ni réécrite
+    const std::string manifest_path = (std::filesystem::path(output_directory_) / MANIFEST_FILE).string();
+    const int manifest_fd = open(manifest_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (manifest_fd < 0) {
+        std::cerr << "Cannot open manifest " << manifest_path << ": " << strerror(errno) << std::endl;
+        return;
+    }
+    const std::string text = line.str();
+    if (write(manifest_fd, text.data(), text.size()) != static_cast<ssize_t>(text.size())) {
+        std::cerr << "Cannot append to manifest " << manifest_path << ": " << strerror(errno) << std::endl;
+    }
+    ::close(manifest_fd);
+}
+
+ChannelGroupInfo* Mf4Writer::get_or_create_channel_group(uint32_t can_id, uint32_t layout_id) {
+    auto it = channel_groups_.find(channel_group_key(can_id, layout_id));
+    if (it != channel_groups_.end() && it->second.channel_group) {
         return &it->second;
     }
     
     std::cerr << "No channel group configured for CAN ID 0x"
-              << std::hex << can_id << std::dec << std::endl;
+              << std::hex << can_id << std::dec << " (layout " << layout_id << ")" << std::endl;
     return nullptr;
 }
 
-mdf::IChannel* Mf4Writer::get_or_create_channel(ChannelGroupInfo* cg_info, const DecodedSignal& signal) {
+ChannelInfo* Mf4Writer::get_or_create_channel(ChannelGroupInfo* cg_info, const std::string& signal_name) {
     if (!cg_info || !cg_info->channel_group) {
         return nullptr;
     }
     
-    auto it = cg_info->channels.find(signal.signal_name);
-    if (it != cg_info->channels.end()) {
-        return it->second;
+    auto it = cg_info->channels.find(signal_name);
+    if (it != cg_info->channels.end() && it->second.channel) {
+        return &it->second;
     }
     
-    std::cerr << "Signal " << signal.signal_name
+    std::cerr << "Signal " << signal_name
               << " not configured in channel group " << cg_info->message_name << std::endl;
     return nullptr;
 }
 
+void Mf4Writer::start_measurement(uint32_t can_id, std::chrono::steady_clock::time_point first_timestamp) {
+    if (shared_time_base_) {
+        // Base de la fenêtre, la marge des enregistrements en retard y est déjà
+        measurement_start_steady_ = time_base_.steady;
+        measurement_start_system_ = time_base_.system;
+    } else {
+        // Anchor timebase to first frame timestamp (minus the margin of late records)
+        measurement_start_steady_ = first_timestamp - anchor_margin_;
+        measurement_start_system_ = std::chrono::system_clock::now() - std::chrono::duration_cast<std::chrono::system_clock::duration>(anchor_margin_);
+    }
+    measurement_start_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        measurement_start_system_.time_since_epoch()).count();
+    
+    mdf_writer_->StartMeasurement(measurement_start_ns_);
+    measurement_started_ = true;
+    
+    if (shared_time_base_) {
+        std::cout << "🚀 Started MF4 measurement of shard " << shard_index_ << " on the time base of window "
+                  << window_ << std::endl;
+    } else {
+        std::cout << "🚀 Started MF4 measurement anchored to first CAN frame (ID 0x" 
+                  << std::hex << can_id << std::dec << ")" << std::endl;
+    }
+}
+
+bool Mf4Writer::accept_timestamp(uint32_t can_id, std::chrono::steady_clock::time_point timestamp) const {
+    // PROTECTION: Reject messages with timestamps older than our measurement start
+    // This can happen during file rotation or if there are buffered old messages
+    auto delta = timestamp - measurement_start_steady_;
+    if (delta < std::chrono::steady_clock::duration::zero()) {
+        if (++rejected_count_ <= 10) {  // Log only first 10 rejections to avoid spam
+            auto delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(delta).count();
+            std::cerr << "🚫 REJECTED old message (CAN ID 0x" << std::hex << can_id << std::dec 
+                      << ", " << delta_ms << "ms before measurement start)" << std::endl;
+        }
+        return false;
+    }
+    return true;
+}
+
+double Mf4Writer::sanitize_value(double value, ChannelInfo& channel_info) {
+    // PROTECTION: Sanitize extreme signal values
+    if (std::isnan(value) || std::isinf(value)) {
+        std::cerr << "🔧 SANITIZED NaN/Inf signal: " << channel_info.name 
+                  << " (was " << value << ") -> 0.0" << std::endl;
+        ++channel_info.stats.nan_count;
+        return 0.0;
+    }
+    if (std::abs(value) > 1e12) {
+        std::cerr << "🔧 SANITIZED extreme signal: " << channel_info.name 
+                  << " (was " << value << ") -> clamped" << std::endl;
+        ++channel_info.stats.sanitized_count;
+        return (value > 0) ? 1e12 : -1e12;
+    }
+    return value;
+}
+
+bool Mf4Writer::resolve_record_layout(ChannelGroupInfo& cg_info) {
+    // Offsets fixés par InitMeasurement : valeurs FloatLe de 8 octets, sans
+    // recouvrement, dans le tampon d'enregistrement ; sinon SetChannelValue
+    cg_info.layout_resolved = true;
+    cg_info.direct_record = false;
+    if (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__ || !cg_info.master_channel) {
+        return false;
+    }
+    cg_info.master_offset = cg_info.master_channel->ByteOffset();
+    std::vector<uint32_t> offsets{cg_info.master_offset};
+    for (auto& entry : cg_info.channels) {
+        if (!entry.second.channel) {
+            continue;
+        }
+        entry.second.byte_offset = entry.second.channel->ByteOffset();
+        offsets.push_back(entry.second.byte_offset);
+    }
+    std::sort(offsets.begin(), offsets.end());
+    const size_t record_bytes = cg_info.channel_group->SampleBuffer().size();
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        const size_t end = static_cast<size_t>(offsets[i]) + sizeof(double);
+        if (end > record_bytes || (i + 1 < offsets.size() && end > offsets[i + 1])) {
+            std::cerr << "Unexpected record layout in channel group " << cg_info.message_name
+                      << ", writing it channel by channel" << std::endl;
+            return false;
+        }
+    }
+    cg_info.direct_record = true;
+    return true;
+}
+
+template <typename SignalAt>
+const std::vector<ChannelInfo*>& Mf4Writer::resolve_channels(ChannelGroupInfo& cg_info, size_t count, SignalAt signal_at) {
+    bool same = cg_info.resolved_indexes.size() == count;
+    for (size_t i = 0; i < count && same; ++i) {
+        const uint32_t index = signal_at(i).second;
+        same = index != UINT32_MAX && index == cg_info.resolved_indexes[i];
+    }
+    if (!same) {
+        // Groupes hors DBC (index UINT32_MAX) : résolution par nom à chaque écriture
+        cg_info.resolved_channels.clear();
+        cg_info.resolved_indexes.clear();
+        for (size_t i = 0; i < count; ++i) {
+            const auto signal = signal_at(i);
+            cg_info.resolved_channels.push_back(get_or_create_channel(&cg_info, signal.first));
+            cg_info.resolved_indexes.push_back(signal.second);
+        }
+    }
+    return cg_info.resolved_channels;
+}
+
+size_t Mf4Writer::append_samples(ChannelGroupInfo& cg_info, ChannelInfo* const* channels, const double* const* values,
+                                 size_t channel_count, const std::chrono::steady_clock::time_point* timestamps, size_t count) {
+    if (!cg_info.layout_resolved) {
+        resolve_record_layout(cg_info);
+    }
+    std::vector<uint8_t>& record = cg_info.channel_group->SampleBuffer();
+    size_t written = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!accept_timestamp(cg_info.can_id, timestamps[i])) {
+            continue;
+        }
+        const uint64_t timestamp_ns = compute_absolute_timestamp(timestamps[i]);
+        const double relative_seconds = compute_relative_seconds(timestamps[i]);
+        if (cg_info.direct_record) {
+            std::memcpy(record.data() + cg_info.master_offset, &relative_seconds, sizeof(double));
+        } else if (cg_info.master_channel) {
+            cg_info.master_channel->SetChannelValue(relative_seconds);
+        }
+        for (size_t c = 0; c < channel_count; ++c) {
+            ChannelInfo* const channel_info = channels[c];
+            if (!channel_info) {
+                continue;
+            }
+            const double safe_value = sanitize_value(values[c][i], *channel_info);
+            if (cg_info.direct_record) {
+                std::memcpy(record.data() + channel_info->byte_offset, &safe_value, sizeof(double));
+            } else {
+                channel_info->channel->SetChannelValue(safe_value);
+            }
+            channel_info->stats.add(safe_value, timestamp_ns);
+        }
+        // Save the complete sample to the channel group (all signals at once)
+        mdf_writer_->SaveSample(*cg_info.channel_group, timestamp_ns);
+        ++cg_info.sample_count;
+        ++written;
+    }
+    return written;
+}
+
 void Mf4Writer::write_can_message_internal(const CanMessage& message) {
     if (!mdf_writer_ || !data_group_ || message.signals.empty()) {
         return;
@@ -308,8 +971,7 @@ void Mf4Writer::write_can_message_internal(const CanMessage& message) {
     
     // PROTECTION: Don't write if we're shutting down
     if (shutdown_requested_.load()) {
-        static int dropped_count = 0;
-        if (++dropped_count <= 5) {
+        if (++dropped_messages_ <= 5) {
             std::cout << "🛑 Dropping message during shutdown (CAN ID 0x" 
                       << std::hex << message.can_id << std::dec << ")" << std::endl;
         }
@@ -318,33 +980,14 @@ void Mf4Writer::write_can_message_internal(const CanMessage& message) {
 
     // Start measurement on first sample to anchor timebase to first frame
     if (!measurement_started_) {
-        measurement_start_steady_ = message.timestamp;  // Anchor to first frame timestamp
-        measurement_start_system_ = std::chrono::system_clock::now();
-        measurement_start_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
-            measurement_start_system_.time_since_epoch()).count();
-        
-        mdf_writer_->StartMeasurement(measurement_start_ns_);
-        measurement_started_ = true;
-        
-        std::cout << "🚀 Started MF4 measurement anchored to first CAN frame (ID 0x" 
-                  << std::hex << message.can_id << std::dec << ")" << std::endl;
+        start_measurement(message.can_id, message.timestamp);
     }
-    
-    // PROTECTION: Reject messages with timestamps older than our measurement start
-    // This can happen during file rotation or if there are buffered old messages
-    auto delta = message.timestamp - measurement_start_steady_;
-    if (delta < std::chrono::steady_clock::duration::zero()) {
-        static int rejected_count = 0;
-        if (++rejected_count <= 10) {  // Log only first 10 rejections to avoid spam
-            auto delta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(delta).count();
-            std::cerr << "🚫 REJECTED old message (CAN ID 0x" << std::hex << message.can_id << std::dec 
-                      << ", " << delta_ms << "ms before measurement start)" << std::endl;
-        }
+    if (!accept_timestamp(message.can_id, message.timestamp)) {
         return;  // Skip this message
     }
     
     // Obtenir ou créer le channel group pour ce message CAN
-    auto* cg_info = get_or_create_channel_group(message.can_id);
+    auto* cg_info = get_or_create_channel_group(message.can_id, message.layout_id);
     if (!cg_info) {
         return;
     }
@@ -355,8 +998,7 @@ void Mf4Writer::write_can_message_internal(const CanMessage& message) {
         const double relative_seconds = compute_relative_seconds(message.timestamp);
 
         // Debug: Log suspicious timestamps
-        static int message_count = 0;
-        message_count++;
+        const uint64_t message_count = ++message_count_;
         
         // Only flag truly suspicious timestamps (not the first message at 0.0)
         if ((relative_seconds < 0.0 || relative_seconds > 1000000.0) && message_count > 1) {
@@ -373,33 +1015,16 @@ void Mf4Writer::write_can_message_internal(const CanMessage& message) {
             std::cerr << "   Signals in message: " << message.signals.size() << std::endl;
         }
 
-        if (cg_info->master_channel) {
-            cg_info->master_channel->SetChannelValue(relative_seconds);
-        }
-        
-        // Set values for all channels in this message
+        // Un enregistrement : chaque valeur vue comme un tableau d'un élément
+        const auto& channels = resolve_channels(*cg_info, message.signals.size(), [&](size_t i) {
+            const DecodedSignal& signal = message.signals[i];
+            return std::pair<const std::string&, uint32_t>(signal.signal_name, signal.signal_index);
+        });
+        block_values_.clear();
         for (const auto& signal : message.signals) {
-            auto* channel = get_or_create_channel(cg_info, signal);
-            if (channel) {
-                double safe_value = signal.value;
-                
-                // PROTECTION: Sanitize extreme signal values
-                if (std::isnan(safe_value) || std::isinf(safe_value)) {
-                    std::cerr << "🔧 SANITIZED NaN/Inf signal: " << signal.signal_name 
-                              << " (was " << signal.value << ") -> 0.0" << std::endl;
-                    safe_value = 0.0;
-                } else if (std::abs(safe_value) > 1e12) {
-                    std::cerr << "🔧 SANITIZED extreme signal: " << signal.signal_name 
-                              << " (was " << signal.value << ") -> clamped" << std::endl;
-                    safe_value = (safe_value > 0) ? 1e12 : -1e12;
-                }
-                
-                channel->SetChannelValue(safe_value);
-            }
+            block_values_.push_back(&signal.value);
         }
-        
-        // Save the complete sample to the channel group (all signals at once)
-        mdf_writer_->SaveSample(*cg_info->channel_group, timestamp_ns);
+        append_samples(*cg_info, channels.data(), block_values_.data(), channels.size(), &message.timestamp, 1);
         
         // Debug: Log occasionally with signal values
         if (message_count % 100 == 0) {
@@ -423,18 +1048,19 @@ void Mf4Writer::write_can_message_internal(const CanMessage& message) {
         }
         
         // Special logging for the last few messages before stopping
-        static bool stopping_logged = false;
-        if (message_count > 990 && !stopping_logged) {
+        if (message_count > 990 && !stopping_logged_) {
             std::cout << "📊 Final messages - Message #" << message_count 
                       << ", time=" << std::fixed << std::setprecision(6) << relative_seconds << "s" << std::endl;
             for (const auto& signal : message.signals) {
                 std::cout << "  " << signal.signal_name << " = " << signal.value << std::endl;
             }
-            if (message_count > 999) stopping_logged = true;
+            if (message_count > 999) stopping_logged_ = true;
         }
         
         // Update file size estimation
-        current_file_size_ += (message.signals.size() + 1) * sizeof(double) + sizeof(uint64_t) + 64;
+        const size_t written = (message.signals.size() + 1) * sizeof(double) + sizeof(uint64_t) + 64;
+        current_file_size_ += written;
+        storage_.notify_written(written);
         
     } catch (const std::exception& e) {
         std::cerr << "Error writing CAN message to MF4: " << e.what() << std::endl;
@@ -470,17 +1096,31 @@ double Mf4Writer::compute_relative_seconds(const std::chrono::steady_clock::time
     return static_cast<double>(delta_ns.count()) / 1'000'000'000.0;
 }
 
+bool Mf4Writer::prepare() {
+    if (!load_dbc_definitions()) {
+        std::cerr << "MF4 Writer cannot start without DBC definitions." << std::endl;
+        return false;
+    }
+
+    // Fichiers laissés non finalisés par une coupure d'alimentation
+    if (!recovery_done_) {
+        recover_unfinalized_files();
+        recovery_done_ = true;
+    }
+    return true;
+}
+
 bool Mf4Writer::start() {
     if (mdf_writer_) {
         std::cerr << "MF4 Writer already started" << std::endl;
         return false;
     }
 
-    if (!load_dbc_definitions()) {
-        std::cerr << "MF4 Writer cannot start without DBC definitions." << std::endl;
+    if (!prepare()) {
         return false;
     }
 
+    shutdown_requested_.store(false);
     if (!create_new_file()) {
         std::cerr << "MF4 Writer failed to create initial MF4 file." << std::endl;
         return false;
@@ -489,21 +1129,140 @@ bool Mf4Writer::start() {
     return true;
 }
 
+void Mf4Writer::recover_unfinalized_files() {
+    std::error_code ec;
+    std::vector<std::filesystem::path> candidates;
+    for (const auto& entry : std::filesystem::directory_iterator(output_directory_, ec)) {
+        if (entry.is_regular_file(ec) && entry.path().extension() == ".mf4") {
+            candidates.push_back(entry.path());
+        }
+    }
+
+    for (const auto& path : candidates) {
+        const auto result = repair_mf4_file(path.string());
+        if (result.repaired) {
+            std::cout << "🔧 Recovered unfinalized MF4 file " << path.string() << ": " << result.message << std::endl;
+        } else if (result.needed) {
+            std::cerr << "⚠️  Cannot recover MF4 file " << path.string() << ": " << result.message << std::endl;
+        }
+    }
+}
+
+bool Mf4Writer::rotate_if_full() {
+    // Shards : rotation commune décidée par le ShardedMf4Writer (rotate())
+    if (shared_time_base_ || current_file_size_ < storage_policy_.rotation_bytes) {
+        return true;
+    }
+    std::cout << "MF4 file reached max size, rotating..." << std::endl;
+    if (create_new_file()) {
+        if (rotation_listener_) {
+            rotation_listener_();
+        }
+        return true;
+    }
+    std::cerr << "Failed to rotate MF4 file. Message dropped." << std::endl;
+    if (!is_running()) {
+        // Plus de fichier ouvert : le collecteur s'arrête proprement
+        SignalHandler::request_shutdown();
+    }
+    return false;
+}
+
+bool Mf4Writer::rotate(const MeasurementTimeBase& base, uint64_t window) {
+    set_time_base(base, window);
+    if (create_new_file()) {
+        return true;
+    }
+    std::cerr << "Failed to rotate MF4 shard " << shard_index_ << " to window " << window << std::endl;
+    if (!is_running()) {
+        SignalHandler::request_shutdown();
+    }
+    return false;
+}
+
 void Mf4Writer::write_can_message(const CanMessage& message) {
     if (!mdf_writer_) {
         std::cerr << "MF4 Writer backend not available. Dropping message." << std::endl;
+        ++dropped_messages_;
+        return;
+    }
+    if (!rotate_if_full()) {
+        ++dropped_messages_;
         return;
     }
 
-    if (current_file_size_ >= MAX_FILE_SIZE) {
-        std::cout << "MF4 file reached max size, rotating..." << std::endl;
-        if (!create_new_file()) {
-            std::cerr << "Failed to rotate MF4 file. Message dropped." << std::endl;
-            return;
+    write_can_message_internal(message);
+}
+
+void Mf4Writer::write_message_block(const MessageBlock& block) {
+    if (!mdf_writer_) {
+        std::cerr << "MF4 Writer backend not available. Dropping message block." << std::endl;
+        dropped_messages_ += block.frame_count;
+        return;
+    }
+    if (!rotate_if_full()) {
+        dropped_messages_ += block.frame_count;
+        return;
+    }
+    if (!data_group_ || block.frame_count == 0 || block.signals->empty()) {
+        return;
+    }
+    if (shutdown_requested_.load()) {
+        if (dropped_messages_.fetch_add(block.frame_count) < 5) {
+            std::cout << "🛑 Dropping message block during shutdown (CAN ID 0x" 
+                      << std::hex << block.can_id << std::dec << ")" << std::endl;
         }
+        return;
     }
 
-    write_can_message_internal(message);
+    if (!measurement_started_) {
+        start_measurement(block.can_id, block.timestamps[0]);
+    }
+    auto* cg_info = get_or_create_channel_group(block.can_id, block.layout_id);
+    if (!cg_info) {
+        return;
+    }
+    const std::vector<BlockSignal>& signals = *block.signals;
+    const auto& channels = resolve_channels(*cg_info, signals.size(), [&](size_t i) {
+        return std::pair<const std::string&, uint32_t>(signals[i].name, signals[i].signal_index);
+    });
+    block_values_.clear();
+    for (size_t s = 0; s < signals.size(); ++s) {
+        block_values_.push_back(block.column(s));
+    }
+
+    try {
+        const size_t written_frames = append_samples(*cg_info, channels.data(), block_values_.data(),
+                                                     signals.size(), block.timestamps, block.frame_count);
+
+        // Même estimation de taille que write_can_message_internal, par trame
+        const size_t written = written_frames * ((signals.size() + 1) * sizeof(double) + sizeof(uint64_t) + 64);
+        current_file_size_ += written;
+        storage_.notify_written(written);
+    } catch (const std::exception& e) {
+        std::cerr << "Error writing CAN message block to MF4: " << e.what() << std::endl;
+    }
+}
+
+void Mf4Writer::write_event(const StreamEvent& event) {
+    if (!mdf_writer_ || shutdown_requested_.load()) {
+        return;
+    }
+    auto* header = mdf_writer_->Header();
+    auto* mdf_event = header ? header->CreateEvent() : nullptr;
+    if (!mdf_event) {
+        std::cerr << "Cannot create MF4 event " << event.name << std::endl;
+        return;
+    }
+    // Bloc EV écrit avec l'en-tête à la finalisation du fichier ; temps relatif au début de la mesure
+    mdf_event->Name(event.name);
+    mdf_event->Description(event.description);
+    mdf_event->Type(mdf::EventType::Marker);
+    mdf_event->Sync(mdf::SyncType::SyncTime);
+    mdf_event->Range(mdf::RangeType::RangePoint);
+    mdf_event->Cause(mdf::EventCause::CauseError);
+    mdf_event->SyncValue(static_cast<int64_t>(std::llround(compute_relative_seconds(event.timestamp) * 1e9)));
+    mdf_event->SyncFactor(1e-9);
 }
 
 void Mf4Writer::stop() {
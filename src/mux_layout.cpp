@@ -0,0 +1,211 @@
+#include "mux_layout.h"
+#include <iostream>
+#include <set>
+#include <dbcppp/Network.h>
+
+bool MuxLayoutTable::is_switch(const dbcppp::ISignal* signal) const {
+    for (const auto& guard : guards_) {
+        if (guard.switch_signal == signal) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MuxLayoutTable::build_node(const BuildState& state, uint32_t& node_index) {
+    node_index = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+
+    if (state.pending.empty()) {
+        if (layouts_.size() >= MAX_LAYOUTS) {
+            return false;
+        }
+
+        MuxLayout layout;
+        layout.id = static_cast<uint32_t>(layouts_.size());
+        layout.label = state.label;
+        for (size_t i = 0; i < signals_.size(); ++i) {
+            if (state.active[i]) {
+                layout.signals.push_back(signals_[i]);
+            }
+        }
+        nodes_[node_index].layout = layout.id;
+        layouts_.emplace_back(std::move(layout));
+        return true;
+    }
+
+    const dbcppp::ISignal* switch_signal = state.pending.front();
+    nodes_[node_index].switch_signal = switch_signal;
+
+    // Valeurs du switch référencées par les signaux qu'il contrôle
+    std::set<uint64_t> values;
+    for (size_t i = 0; i < signals_.size(); ++i) {
+        const Guard& guard = guards_[i];
+        if (guard.switch_signal != switch_signal || state.active[i]) {
+            continue;
+        }
+        for (const auto& [from, to] : guard.ranges) {
+            if (to < from || to - from >= MAX_RANGE_WIDTH) {
+                return false;
+            }
+            for (uint64_t offset = 0; offset <= to - from; ++offset) {
+                values.insert(from + offset);
+            }
+        }
+    }
+
+    const std::string prefix = state.label.empty() ? "" : state.label + "_";
+
+    for (uint64_t value : values) {
+        BuildState child_state;
+        child_state.active = state.active;
+        child_state.pending.assign(state.pending.begin() + 1, state.pending.end());
+        child_state.label = prefix + switch_signal->Name() + std::to_string(value);
+
+        for (size_t i = 0; i < signals_.size(); ++i) {
+            const Guard& guard = guards_[i];
+            if (guard.switch_signal != switch_signal || child_state.active[i]) {
+                continue;
+            }
+            for (const auto& [from, to] : guard.ranges) {
+                if (value >= from && value <= to) {
+                    child_state.active[i] = true;
+                    if (is_switch(signals_[i])) {
+                        child_state.pending.push_back(signals_[i]);
+                    }
+                    break;
+                }
+            }
+        }
+
+        uint32_t child = 0;
+        if (!build_node(child_state, child)) {
+            return false;
+        }
+        nodes_[node_index].children.emplace(value, child);
+    }
+
+    // Valeur inconnue du DBC : seuls les signaux déjà actifs restent valides
+    BuildState default_state;
+    default_state.active = state.active;
+    default_state.pending.assign(state.pending.begin() + 1, state.pending.end());
+    default_state.label = prefix + switch_signal->Name() + "Other";
+
+    uint32_t default_child = 0;
+    if (!build_node(default_state, default_child)) {
+        return false;
+    }
+    nodes_[node_index].default_child = default_child;
+    return true;
+}
+
+bool MuxLayoutTable::build(const dbcppp::IMessage& message) {
+    nodes_.clear();
+    layouts_.clear();
+    signals_.clear();
+    guards_.clear();
+    multiplexed_ = false;
+
+    for (const auto& signal : message.Signals()) {
+        signals_.push_back(&signal);
+    }
+    guards_.resize(signals_.size());
+
+    auto find_signal = [this](const std::string& name) -> const dbcppp::ISignal* {
+        for (const auto* signal : signals_) {
+            if (signal->Name() == name) {
+                return signal;
+            }
+        }
+        return nullptr;
+    };
+
+    for (size_t i = 0; i < signals_.size(); ++i) {
+        const dbcppp::ISignal& signal = *signals_[i];
+        Guard& guard = guards_[i];
+
+        if (signal.SignalMultiplexerValues_Size() > 0) {
+            // Multiplexage étendu : SG_MUL_VAL_ donne le switch et les plages de valeurs
+            const auto& mux_value = signal.SignalMultiplexerValues_Get(0);
+            guard.switch_signal = find_signal(mux_value.SwitchName());
+            for (const auto& range : mux_value.ValueRanges()) {
+                guard.ranges.emplace_back(range.from, range.to);
+            }
+        } else if (signal.MultiplexerIndicator() == dbcppp::ISignal::EMultiplexer::MuxValue) {
+            guard.switch_signal = message.MuxSignal();
+            const uint64_t value = signal.MultiplexerSwitchValue();
+            guard.ranges.emplace_back(value, value);
+        }
+
+        if (guard.switch_signal == &signal) {
+            guard.switch_signal = nullptr;
+        }
+        if (guard.switch_signal) {
+            multiplexed_ = true;
+        }
+    }
+
+    BuildState root;
+    root.active.resize(signals_.size(), false);
+    for (size_t i = 0; i < signals_.size(); ++i) {
+        if (!guards_[i].switch_signal) {
+            root.active[i] = true;
+            if (is_switch(signals_[i])) {
+                root.pending.push_back(signals_[i]);
+            }
+        }
+    }
+
+    uint32_t root_index = 0;
+    if (multiplexed_ && !root.pending.empty() && build_node(root, root_index)) {
+        return true;
+    }
+
+    const bool failed = multiplexed_;
+    if (failed) {
+        std::cerr << "Multiplexing of message " << message.Name()
+                  << " cannot be resolved, decoding all signals" << std::endl;
+    }
+
+    // Repli : un seul layout avec tous les signaux
+    nodes_.assign(1, Node{});
+    layouts_.clear();
+    MuxLayout layout;
+    layout.signals = signals_;
+    layouts_.emplace_back(std::move(layout));
+    multiplexed_ = false;
+    return !failed;
+}
+
+void MuxLayoutTable::retain_signals(const std::function<bool(const dbcppp::ISignal&)>& keep) {
+    for (auto& layout : layouts_) {
+        std::vector<const dbcppp::ISignal*> retained;
+        retained.reserve(layout.signals.size());
+        for (const auto* signal : layout.signals) {
+            if (keep(*signal)) {
+                retained.push_back(signal);
+            }
+        }
+        layout.signals.swap(retained);
+    }
+}
+
+bool MuxLayoutTable::has_signals() const {
+    for (const auto& layout : layouts_) {
+        if (!layout.signals.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const MuxLayout& MuxLayoutTable::resolve(const uint8_t* data) const {
+    uint32_t index = 0;
+    while (nodes_[index].switch_signal) {
+        const Node& node = nodes_[index];
+        const uint64_t value = node.switch_signal->Decode(data);
+        auto it = node.children.find(value);
+        index = (it != node.children.end()) ? it->second : node.default_child;
+    }
+    return layouts_[nodes_[index].layout];
+}
@@ -0,0 +1,44 @@
+#include "output_sink.h"
+#include <iostream>
+
+void OutputSink::write_message_block(const MessageBlock& block) {
+    CanMessage message;
+    for (size_t i = 0; i < block.frame_count; ++i) {
+        block.to_message(i, message);
+        write_can_message(message);
+    }
+}
+
+bool SinkFanout::start() {
+    for (size_t i = 0; i < sinks_.size(); ++i) {
+        if (!sinks_[i]->start()) {
+            std::cerr << "Output " << sinks_[i]->name() << " failed to start" << std::endl;
+            while (i > 0) {
+                sinks_[--i]->stop();
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+void SinkFanout::stop() {
+    for (OutputSink* sink : sinks_) {
+        sink->stop();
+    }
+}
+
+void SinkFanout::dbc_changed(const std::shared_ptr<const dbcppp::INetwork>& network) {
+    for (OutputSink* sink : sinks_) {
+        sink->dbc_changed(network);
+    }
+}
+
+bool SinkFanout::is_running() const {
+    for (const OutputSink* sink : sinks_) {
+        if (!sink->is_running()) {
+            return false;
+        }
+    }
+    return !sinks_.empty();
+}
@@ -0,0 +1,317 @@
+#include "retention_manager.h"
+#include "thread_tuning.h"
+#include "signal_stats.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+#include <cerrno>
+#include <cstring>
+#include <sys/statvfs.h>
+#include <sys/stat.h>
+
+namespace {
+
+constexpr auto RESCAN_INTERVAL = std::chrono::minutes(10);
+const char* const FILE_PREFIXES[] = {"can_data_", "event_"};
+const char* const FILE_EXTENSIONS[] = {".mf4", ".cck"};
+
+// Horodatage du nom (YYYYMMDD_HHMMSS...), vide si le fichier n'est pas géré
+std::string file_time_key(const std::filesystem::path& path) {
+    const std::string extension = path.extension().string();
+    if (std::none_of(std::begin(FILE_EXTENSIONS), std::end(FILE_EXTENSIONS),
+                     [&](const char* managed) { return extension == managed; })) {
+        return std::string();
+    }
+    const std::string name = path.filename().string();
+    for (const char* prefix : FILE_PREFIXES) {
+        const size_t length = std::strlen(prefix);
+        if (name.compare(0, length, prefix) == 0) {
+            return name.substr(length);
+        }
+    }
+    return std::string();
+}
+
+}  // namespace
+
+std::string RetentionPolicy::describe() const {
+    if (!enabled()) {
+        return "unlimited";
+    }
+    std::ostringstream oss;
+    const char* separator = "";
+    if (max_bytes > 0) {
+        oss << "max " << max_bytes / (1024 * 1024) << " MB";
+        separator = ", ";
+    }
+    if (max_files > 0) {
+        oss << separator << "max " << max_files << " files";
+        separator = ", ";
+    }
+    if (min_free_bytes > 0) {
+        oss << separator << "keep " << min_free_bytes / (1024 * 1024) << " MB free";
+    }
+    oss << (archive_dir.empty() ? ", delete oldest" : ", move oldest to " + archive_dir);
+    return oss.str();
+}
+
+RetentionManager::RetentionManager(const std::string& output_dir, const RetentionPolicy& policy)
+    : output_directory_(output_dir)
+    , policy_(policy) {
+}
+
+RetentionManager::~RetentionManager() {
+    stop();
+}
+
+bool RetentionManager::start() {
+    if (thread_) {
+        return true;
+    }
+    if (!policy_.enabled()) {
+        return true;
+    }
+
+    if (!policy_.archive_dir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(policy_.archive_dir, ec);
+        if (ec) {
+            std::cerr << "Retention: cannot create archive directory " << policy_.archive_dir
+                      << ": " << ec.message() << std::endl;
+            return false;
+        }
+        struct stat output_st;
+        struct stat archive_st;
+        archive_on_output_device_ = stat(output_directory_.c_str(), &output_st) == 0
+                                    && stat(policy_.archive_dir.c_str(), &archive_st) == 0
+                                    && output_st.st_dev == archive_st.st_dev;
+        if (archive_on_output_device_ && policy_.min_free_bytes > 0) {
+            std::cerr << "⚠️  Retention: archive directory " << policy_.archive_dir << " is on the same filesystem as "
+                      << output_directory_ << ", files are deleted (not archived) to keep free space" << std::endl;
+        }
+    }
+
+    // Premier passage synchrone : le writer n'a pas encore ouvert de fichier
+    scan_directory();
+    enforce({});
+
+    stop_requested_ = false;
+    abort_enforce_.store(false);
+    thread_ = std::make_unique<std::thread>(&RetentionManager::retention_loop, this);
+    std::cout << "Retention manager started (" << policy_.describe() << ", "
+              << files_.size() << " files, " << total_bytes_ / (1024 * 1024) << " MB)" << std::endl;
+    return true;
+}
+
+void RetentionManager::stop() {
+    if (!thread_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    // Un passage de rétention en cours s'arrête au fichier suivant : l'arrêt
+    // n'attend qu'une suppression (ou un déplacement vers l'archive)
+    abort_enforce_.store(true);
+    condition_.notify_one();
+    if (thread_->joinable()) {
+        thread_->join();
+    }
+    thread_.reset();
+}
+
+void RetentionManager::notify_file_opened(const std::string& path) {
+    if (!thread_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_files_.push_back(path);
+}
+
+void RetentionManager::notify_file_closed(const std::string& path) {
+    if (!thread_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_files_.push_back(path);
+        active_files_.erase(std::remove(active_files_.begin(), active_files_.end(), path), active_files_.end());
+        check_requested_ = true;
+    }
+    condition_.notify_one();
+}
+
+void RetentionManager::request_check() {
+    if (!thread_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        check_requested_ = true;
+    }
+    condition_.notify_one();
+}
+
+void RetentionManager::retention_loop() {
+    apply_background_priority("mf4-retention");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_requested_) {
+        condition_.wait_for(lock, policy_.check_interval, [this] { return stop_requested_ || check_requested_; });
+        if (stop_requested_) {
+            break;
+        }
+        check_requested_ = false;
+        std::vector<std::string> closed;
+        closed.swap(closed_files_);
+        const std::vector<std::string> active = active_files_;
+        lock.unlock();
+
+        if (std::chrono::steady_clock::now() - last_scan_ >= RESCAN_INTERVAL) {
+            scan_directory();
+        } else {
+            for (const auto& path : closed) {
+                add_file(path);
+            }
+        }
+        enforce(active);
+
+        lock.lock();
+    }
+}
+
+void RetentionManager::scan_directory() {
+    files_.clear();
+    total_bytes_ = 0;
+    last_scan_ = std::chrono::steady_clock::now();
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(output_directory_, ec)) {
+        std::error_code entry_ec;
+        if (!entry.is_regular_file(entry_ec) || file_time_key(entry.path()).empty()) {
+            continue;
+        }
+        const uint64_t size = entry.file_size(entry_ec);
+        if (!entry_ec) {
+            files_.push_back({entry.path().string(), size});
+            total_bytes_ += size;
+        }
+    }
+    if (ec) {
+        std::cerr << "Retention: cannot scan " << output_directory_ << ": " << ec.message() << std::endl;
+    }
+
+    // Enregistrement continu et événements mélangés, triés sur l'horodatage du nom
+    std::sort(files_.begin(), files_.end(), [](const FileEntry& a, const FileEntry& b) {
+        return file_time_key(a.path) < file_time_key(b.path);
+    });
+}
+
+void RetentionManager::add_file(const std::string& path) {
+    std::error_code ec;
+    const uint64_t size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return;
+    }
+    for (const auto& file : files_) {
+        if (file.path == path) {
+            return;
+        }
+    }
+    // Les notifications arrivent dans l'ordre de rotation
+    files_.push_back({path, size});
+    total_bytes_ += size;
+}
+
+uint64_t RetentionManager::free_bytes() const {
+    struct statvfs st;
+    if (statvfs(output_directory_.c_str(), &st) != 0) {
+        return UINT64_MAX;
+    }
+    return static_cast<uint64_t>(st.f_bavail) * static_cast<uint64_t>(st.f_frsize);
+}
+
+void RetentionManager::enforce(const std::vector<std::string>& active_files) {
+    // Les fichiers actifs peuvent apparaître dans le cache après un rescan
+    std::vector<FileEntry> active_entries;
+    for (auto it = files_.begin(); it != files_.end();) {
+        if (std::find(active_files.begin(), active_files.end(), it->path) != active_files.end()) {
+            active_entries.push_back(*it);
+            total_bytes_ -= it->size;
+            it = files_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    while (!abort_enforce_.load()) {
+        const bool over_count = policy_.max_files > 0 && files_.size() > policy_.max_files;
+        const bool over_bytes = policy_.max_bytes > 0 && total_bytes_ > policy_.max_bytes;
+        const bool low_space = policy_.min_free_bytes > 0 && free_bytes() < policy_.min_free_bytes;
+        if (!over_count && !over_bytes && !low_space) {
+            break;
+        }
+        if (files_.empty()) {
+            if (low_space) {
+                std::cerr << "⚠️  Retention: less than " << policy_.min_free_bytes / (1024 * 1024)
+                          << " MB free on " << output_directory_ << " and no finished file left to remove" << std::endl;
+            }
+            break;
+        }
+        // Déplacer vers une archive sur la même partition ne libère pas d'espace
+        if (!remove_oldest(!(low_space && archive_on_output_device_))) {
+            break;
+        }
+    }
+
+    for (const auto& entry : active_entries) {
+        files_.push_back(entry);
+        total_bytes_ += entry.size;
+    }
+}
+
+void RetentionManager::dispose(const std::string& path, bool archive, std::error_code& ec) const {
+    if (!archive || policy_.archive_dir.empty()) {
+        std::filesystem::remove(path, ec);
+        return;
+    }
+    const auto target = std::filesystem::path(policy_.archive_dir) / std::filesystem::path(path).filename();
+    std::filesystem::rename(path, target, ec);
+    if (ec && ec.value() == EXDEV) {
+        // Autre partition : copie puis suppression
+        ec.clear();
+        std::filesystem::copy_file(path, target, std::filesystem::copy_options::overwrite_existing, ec);
+        if (!ec) {
+            std::filesystem::remove(path, ec);
+        }
+    }
+}
+
+bool RetentionManager::remove_oldest(bool archive) {
+    const FileEntry oldest = files_.front();
+    files_.pop_front();
+    total_bytes_ -= oldest.size;
+
+    std::error_code ec;
+    archive = archive && !policy_.archive_dir.empty();
+    dispose(oldest.path, archive, ec);
+    if (!ec) {
+        if (!archive) {
+            std::cout << "🗑️  Retention: removed " << oldest.path << " (" << oldest.size << " bytes)" << std::endl;
+        } else {
+            std::cout << "📦 Retention: archived " << oldest.path << " to " << policy_.archive_dir << std::endl;
+        }
+        // L'annexe de statistiques suit son fichier ; absente pour les .cck et les anciens fichiers
+        std::error_code sidecar_ec;
+        dispose(oldest.path + STATS_SIDECAR_SUFFIX, archive, sidecar_ec);
+    }
+
+    if (ec) {
+        std::cerr << "Retention: cannot remove " << oldest.path << ": " << ec.message() << std::endl;
+        // Fichier disparu entre-temps : on continue, sinon on abandonne ce passage
+        return ec == std::errc::no_such_file_or_directory;
+    }
+    return true;
+}
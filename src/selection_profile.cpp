@@ -0,0 +1,150 @@
+#include "selection_profile.h"
+#include "json_value.h"
+#include <iostream>
+#include <stdexcept>
+#include <fnmatch.h>
+#include <linux/can.h>
+#include <dbcppp/Network.h>
+
+bool SelectionProfile::matches(const std::string& pattern, const std::string& name) {
+    return fnmatch(pattern.c_str(), name.c_str(), 0) == 0;
+}
+
+bool SelectionProfile::load(const std::string& path) {
+    JsonValue root;
+    std::string error;
+    if (!JsonValue::parse_file(path, root, error)) {
+        std::cerr << "Error: Cannot parse selection profile " << path << ": " << error << std::endl;
+        return false;
+    }
+
+    const JsonValue* messages = root.find("messages");
+    if (!messages || !messages->is_array()) {
+        std::cerr << "Error: Selection profile " << path << " has no \"messages\" array" << std::endl;
+        return false;
+    }
+
+    entries_.clear();
+    for (const auto& item : messages->as_array()) {
+        Entry entry;
+        const JsonValue* id = item.find("id");
+        const JsonValue* name = item.find("name");
+
+        if (id) {
+            try {
+                unsigned long value = 0;
+                if (id->is_number()) {
+                    if (id->as_number() < 0) {
+                        throw std::invalid_argument("id");
+                    }
+                    value = static_cast<unsigned long>(id->as_number());
+                } else if (id->is_string()) {
+                    const std::string& text = id->as_string();
+                    size_t pos = 0;
+                    value = std::stoul(text, &pos, 0);
+                    if (pos != text.size() || text.front() == '-') {
+                        throw std::invalid_argument(text);
+                    }
+                } else {
+                    throw std::invalid_argument("id");
+                }
+                // Même forme que msg.Id() de dbcppp : CAN_EFF_FLAG sur les IDs étendus
+                if (value > CAN_SFF_MASK) {
+                    value |= CAN_EFF_FLAG;
+                }
+                if ((value & ~static_cast<unsigned long>(CAN_EFF_FLAG)) > CAN_EFF_MASK) {
+                    throw std::out_of_range("id");
+                }
+                entry.can_id = static_cast<uint32_t>(value);
+                entry.has_id = true;
+            } catch (const std::exception&) {
+                std::cerr << "Error: Invalid message id in selection profile " << path << std::endl;
+                return false;
+            }
+        }
+        if (name && name->is_string()) {
+            entry.name_pattern = name->as_string();
+        }
+        if (!entry.has_id && entry.name_pattern.empty()) {
+            std::cerr << "Error: Selection profile entry needs an \"id\" or a \"name\" in " << path << std::endl;
+            return false;
+        }
+
+        if (const JsonValue* signals = item.find("signals")) {
+            if (!signals->is_array()) {
+                std::cerr << "Error: \"signals\" must be an array in selection profile " << path << std::endl;
+                return false;
+            }
+            for (const auto& signal : signals->as_array()) {
+                if (signal.is_string()) {
+                    entry.signal_patterns.push_back(signal.as_string());
+                }
+            }
+        }
+
+        entries_.emplace_back(std::move(entry));
+    }
+
+    path_ = path;
+    std::cout << "Selection profile loaded: " << path << " (" << entries_.size() << " entries)" << std::endl;
+    return true;
+}
+
+bool SelectionProfile::entry_matches(const Entry& entry, uint32_t can_id, const std::string& message_name) const {
+    if (entry.has_id && entry.can_id != can_id) {
+        return false;
+    }
+    return entry.name_pattern.empty() || matches(entry.name_pattern, message_name);
+}
+
+void SelectionProfile::report_unmatched(const dbcppp::INetwork& network) const {
+    for (const auto& entry : entries_) {
+        bool matched = false;
+        for (const auto& msg : network.Messages()) {
+            if (entry_matches(entry, static_cast<uint32_t>(msg.Id()), msg.Name())) {
+                matched = true;
+                break;
+            }
+        }
+        if (matched) {
+            continue;
+        }
+        std::cerr << "⚠️  Selection profile entry";
+        if (entry.has_id) {
+            std::cerr << " id 0x" << std::hex << std::uppercase
+                      << (entry.can_id & ((entry.can_id & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK))
+                      << std::dec << std::nouppercase << ((entry.can_id & CAN_EFF_FLAG) ? " (extended)" : "");
+        }
+        if (!entry.name_pattern.empty()) {
+            std::cerr << " name '" << entry.name_pattern << "'";
+        }
+        std::cerr << " matches no DBC message" << std::endl;
+    }
+}
+
+bool SelectionProfile::select_message(uint32_t can_id, const std::string& message_name) const {
+    for (const auto& entry : entries_) {
+        if (entry_matches(entry, can_id, message_name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SelectionProfile::select_signal(uint32_t can_id, const std::string& message_name,
+                                     const std::string& signal_name) const {
+    for (const auto& entry : entries_) {
+        if (!entry_matches(entry, can_id, message_name)) {
+            continue;
+        }
+        if (entry.signal_patterns.empty()) {
+            return true;
+        }
+        for (const auto& pattern : entry.signal_patterns) {
+            if (matches(pattern, signal_name)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
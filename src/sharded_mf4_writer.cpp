@@ -0,0 +1,346 @@
+#include "sharded_mf4_writer.h"
+#include <algorithm>
+#include <iostream>
+
+ShardedMf4Writer::ShardedMf4Writer(const Mf4Writer& prototype, size_t count) {
+    count = std::max<size_t>(count, 1);
+    for (size_t index = 0; index < count; ++index) {
+        auto shard = std::make_unique<Shard>();
+        shard->index = index;
+        shard->writer = prototype.clone_configuration();
+        shard->writer->set_shard(index, count);
+        if (index > 0) {
+            // Réparation du répertoire par le premier shard seulement
+            shard->writer->skip_recovery();
+        }
+        shards_.push_back(std::move(shard));
+    }
+}
+
+ShardedMf4Writer::~ShardedMf4Writer() {
+    stop();
+}
+
+bool ShardedMf4Writer::prepare() {
+    // Le premier shard répare les fichiers non finalisés, les autres ne font
+    // que charger leur layout ; aucun fichier n'est encore ouvert
+    for (auto& shard : shards_) {
+        if (!shard->writer->prepare()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MeasurementTimeBase ShardedMf4Writer::time_base_at(std::chrono::steady_clock::time_point first_timestamp) const {
+    // Même marge que le début de mesure d'un writer seul (enregistrements en retard du décodage par blocs)
+    MeasurementTimeBase base;
+    base.steady = first_timestamp - shards_.front()->writer->anchor_margin();
+    base.system = std::chrono::system_clock::now() - std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::steady_clock::now() - base.steady);
+    return base;
+}
+
+bool ShardedMf4Writer::start() {
+    if (running_) {
+        std::cerr << "MF4 shards already started" << std::endl;
+        return false;
+    }
+    if (!prepare()) {
+        return false;
+    }
+
+    ++window_;
+    rotation_request_.store(window_);
+    last_timestamp_ = std::chrono::steady_clock::now();
+    const MeasurementTimeBase base = time_base_at(last_timestamp_);
+    for (size_t index = 0; index < shards_.size(); ++index) {
+        Shard& shard = *shards_[index];
+        shard.window.store(window_);
+        shard.writer->set_time_base(base, window_);
+        if (!shard.writer->start()) {
+            std::cerr << "MF4 shard " << index << " failed to start" << std::endl;
+            for (size_t started = 0; started < index; ++started) {
+                shards_[started]->writer->stop();
+            }
+            return false;
+        }
+    }
+
+    stopping_.store(false);
+    has_deadline_.store(false);
+    for (auto& shard : shards_) {
+        shard->queue.reopen();
+        Shard* worker = shard.get();
+        shard->thread = std::make_unique<std::thread>([this, worker]() { shard_loop(*worker); });
+    }
+    running_ = true;
+    std::cout << "MF4 writer sharded over " << shards_.size() << " threads (window " << window_ << ")" << std::endl;
+    return true;
+}
+
+void ShardedMf4Writer::set_stop_deadline(std::chrono::steady_clock::time_point deadline) {
+    stop_deadline_.store(deadline.time_since_epoch().count());
+    has_deadline_.store(true);
+}
+
+bool ShardedMf4Writer::deadline_reached() const {
+    return stopping_.load() && has_deadline_.load()
+           && std::chrono::steady_clock::now().time_since_epoch().count() >= stop_deadline_.load();
+}
+
+void ShardedMf4Writer::stop_threads() {
+    stopping_.store(true);
+    for (auto& shard : shards_) {
+        shard->queue.close();
+    }
+    for (auto& shard : shards_) {
+        if (shard->thread && shard->thread->joinable()) {
+            shard->thread->join();
+        }
+        shard->thread.reset();
+    }
+}
+
+void ShardedMf4Writer::stop() {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+    // Les files sont vidées dans les fichiers encore ouverts (jusqu'à
+    // l'échéance d'arrêt), puis chaque fichier est finalisé
+    stop_threads();
+    for (auto& shard : shards_) {
+        shard->writer->stop();
+    }
+    std::cout << "MF4 shards stopped" << std::endl;
+}
+
+bool ShardedMf4Writer::is_running() const {
+    if (!running_) {
+        return false;
+    }
+    for (const auto& shard : shards_) {
+        if (!shard->writer->is_running()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ShardedMf4Writer::shard_loop(Shard& shard) {
+    apply_thread_tuning("mf4-shard-" + std::to_string(shard.index), thread_tuning_);
+    Mf4Writer& writer = *shard.writer;
+    const size_t rotation_bytes = writer.storage_policy().rotation_bytes;
+
+    Item item;
+    while (shard.queue.wait_and_pop(item)) {
+        release(shard, item);
+        if (deadline_reached()) {
+            // Échéance d'arrêt : le reste de la file n'est pas écrit
+            uint64_t abandoned = item.messages;
+            while (shard.queue.pop(item)) {
+                release(shard, item);
+                abandoned += item.messages;
+            }
+            dropped_messages_ += abandoned;
+            std::cerr << "⚠️  MF4 shard " << shard.index << " reached the stop deadline, "
+                      << abandoned << " queued messages dropped" << std::endl;
+            break;
+        }
+
+        switch (item.kind) {
+            case Item::Kind::Message:
+                writer.write_can_message(item.message);
+                break;
+            case Item::Kind::Block: {
+                MessageBlock block;
+                block.can_id = item.can_id;
+                block.layout_id = item.layout_id;
+                block.frame_count = item.frame_count;
+                block.stride = item.frame_count;
+                block.signals = item.block_signals.get();
+                block.timestamps = item.timestamps.data();
+                block.values = item.values.data();
+                writer.write_message_block(block);
+                break;
+            }
+            case Item::Kind::Event:
+                writer.write_event(item.event);
+                break;
+            case Item::Kind::Rotate:
+                writer.rotate(item.time_base, item.window);
+                shard.window.store(item.window);
+                break;
+            case Item::Kind::DbcChanged:
+                writer.set_time_base(item.time_base, item.window);
+                writer.dbc_changed(item.network);
+                shard.window.store(item.window);
+                break;
+        }
+
+        // Fichier plein : tous les shards passent à la fenêtre suivante. Une
+        // demande pour une fenêtre déjà ouverte est ignorée par le routage.
+        if (writer.current_file_size() >= rotation_bytes) {
+            const uint64_t requested = shard.window.load() + 1;
+            uint64_t current = rotation_request_.load();
+            while (current < requested && !rotation_request_.compare_exchange_weak(current, requested)) {
+            }
+        }
+    }
+}
+
+bool ShardedMf4Writer::push(Shard& shard, Item item, bool required) {
+    item.bytes += sizeof(Item);
+    if (!required && shard.queued_bytes.load() + item.bytes > MAX_QUEUED_BYTES) {
+        if (item.kind == Item::Kind::Event) {
+            ++dropped_events_;
+            std::cerr << "⚠️  MF4 shard " << shard.index << " queue full, event " << item.event.name
+                      << " dropped" << std::endl;
+        } else if (dropped_messages_.fetch_add(item.messages) == 0) {
+            std::cerr << "⚠️  MF4 shard " << shard.index << " cannot keep up, dropping messages" << std::endl;
+        }
+        return false;
+    }
+    shard.queued_bytes.fetch_add(item.bytes);
+    shard.queue.push(std::move(item));
+    return true;
+}
+
+void ShardedMf4Writer::rotate_all(std::chrono::steady_clock::time_point timestamp) {
+    // Un seul marqueur en attente par shard : la rotation attend qu'un shard
+    // en retard ait ouvert le fichier de la fenêtre courante
+    for (const auto& shard : shards_) {
+        if (shard->window.load() != window_) {
+            return;
+        }
+    }
+    ++window_;
+    const MeasurementTimeBase base = time_base_at(timestamp);
+    std::cout << "MF4 shard file reached max size, rotating all shards to window " << window_ << std::endl;
+    // Marqueurs jamais refusés : chaque shard change de fichier au même point du flux
+    for (auto& shard : shards_) {
+        Item item;
+        item.kind = Item::Kind::Rotate;
+        item.time_base = base;
+        item.window = window_;
+        push(*shard, std::move(item), true);
+    }
+    if (rotation_listener_) {
+        rotation_listener_();
+    }
+}
+
+void ShardedMf4Writer::write_can_message(const CanMessage& message) {
+    if (!running_) {
+        ++dropped_messages_;
+        return;
+    }
+    if (rotation_request_.load(std::memory_order_relaxed) > window_) {
+        rotate_all(message.timestamp);
+    }
+    last_timestamp_ = std::max(last_timestamp_, message.timestamp);
+
+    Item item;
+    item.kind = Item::Kind::Message;
+    item.messages = 1;
+    item.message = message;
+    item.bytes = message.signals.size() * sizeof(DecodedSignal);
+    for (const auto& signal : message.signals) {
+        item.bytes += signal.signal_name.size() + signal.unit.size();
+    }
+    push(shard_of(message.can_id), std::move(item));
+}
+
+void ShardedMf4Writer::write_message_block(const MessageBlock& block) {
+    if (!running_) {
+        dropped_messages_ += block.frame_count;
+        return;
+    }
+    if (block.frame_count == 0 || block.signals->empty()) {
+        return;
+    }
+    if (rotation_request_.load(std::memory_order_relaxed) > window_) {
+        rotate_all(block.timestamps[0]);
+    }
+    last_timestamp_ = std::max(last_timestamp_, block.timestamps[block.frame_count - 1]);
+
+    auto& signals = block_signals_[block.signals];
+    if (!signals) {
+        signals = std::make_shared<const std::vector<BlockSignal>>(*block.signals);
+    }
+
+    Item item;
+    item.kind = Item::Kind::Block;
+    item.messages = block.frame_count;
+    item.can_id = block.can_id;
+    item.layout_id = block.layout_id;
+    item.frame_count = block.frame_count;
+    item.block_signals = signals;
+    item.timestamps.assign(block.timestamps, block.timestamps + block.frame_count);
+    // Colonnes recopiées sans le stride du décodeur
+    item.values.reserve(signals->size() * block.frame_count);
+    for (size_t s = 0; s < signals->size(); ++s) {
+        item.values.insert(item.values.end(), block.column(s), block.column(s) + block.frame_count);
+    }
+    item.bytes = item.timestamps.size() * sizeof(item.timestamps[0]) + item.values.size() * sizeof(double);
+    push(shard_of(block.can_id), std::move(item));
+}
+
+void ShardedMf4Writer::write_event(const StreamEvent& event) {
+    if (!running_) {
+        return;
+    }
+    for (auto& shard : shards_) {
+        Item item;
+        item.kind = Item::Kind::Event;
+        item.event = event;
+        item.bytes = event.name.size() + event.description.size();
+        push(*shard, std::move(item));
+    }
+}
+
+void ShardedMf4Writer::dbc_changed(const std::shared_ptr<const dbcppp::INetwork>& network) {
+    // Les plans de décodage par blocs sont reconstruits avec le nouveau DBC
+    block_signals_.clear();
+    if (!running_) {
+        for (auto& shard : shards_) {
+            shard->writer->dbc_changed(network);
+        }
+        return;
+    }
+
+    // Nouvelle fenêtre pour tous les shards ; les messages suivants ne sont
+    // pas plus anciens que le dernier routé (ordre du flux). Un marqueur par
+    // rechargement, dont la fréquence est bornée par le décodeur (anti-rebond)
+    ++window_;
+    const MeasurementTimeBase base = time_base_at(last_timestamp_);
+    for (auto& shard : shards_) {
+        Item item;
+        item.kind = Item::Kind::DbcChanged;
+        item.network = network;
+        item.time_base = base;
+        item.window = window_;
+        push(*shard, std::move(item), true);
+    }
+}
+
+uint64_t ShardedMf4Writer::dropped_messages() const {
+    uint64_t dropped = dropped_messages_.load();
+    for (const auto& shard : shards_) {
+        dropped += shard->writer->dropped_messages();
+    }
+    return dropped;
+}
+
+RotationStats ShardedMf4Writer::rotation_stats() const {
+    RotationStats total;
+    for (const auto& shard : shards_) {
+        const RotationStats& stats = shard->writer->rotation_stats();
+        total.count += stats.count;
+        total.total_ms += stats.total_ms;
+        total.max_ms = std::max(total.max_ms, stats.max_ms);
+        total.last_ms = std::max(total.last_ms, stats.last_ms);
+    }
+    return total;
+}
@@ -1,46 +1,129 @@
 #include "signal_handler.h"
 #include <csignal>
+#include <cstring>
+#include <cerrno>
 #include <iostream>
 #include <atomic>
-#include <functional>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
 
 std::atomic<bool> SignalHandler::shutdown_requested_(false);
-std::function<void()> SignalHandler::cleanup_callback_;
+std::atomic<bool> SignalHandler::reload_requested_(false);
+int SignalHandler::signal_fd_ = -1;
+int SignalHandler::event_fd_ = -1;
+int SignalHandler::epoll_fd_ = -1;
 
-void SignalHandler::signal_handler(int signum) {
-    const char* signal_name = "UNKNOWN";
-    
+static const char* signal_name(int signum) {
     switch (signum) {
-        case SIGINT:
-            signal_name = "SIGINT";
-            break;
-        case SIGTERM:
-            signal_name = "SIGTERM";
-            break;
-        case SIGHUP:
-            signal_name = "SIGHUP";
-            break;
+        case SIGINT: return "SIGINT";
+        case SIGTERM: return "SIGTERM";
+        case SIGHUP: return "SIGHUP";
+        default: return "UNKNOWN";
     }
-    
-    std::cout << "\nReceived signal " << signal_name << " (" << signum << "), initiating graceful shutdown..." << std::endl;
+}
+
+// Repli si signalfd est indisponible : seules des opérations async-signal-safe
+void SignalHandler::signal_handler(int signum) {
+    if (signum == SIGHUP) {
+        reload_requested_.store(true);
+        if (event_fd_ >= 0) {
+            const uint64_t one = 1;
+            ssize_t rc = write(event_fd_, &one, sizeof(one));
+            (void)rc;
+        }
+        return;
+    }
+    request_shutdown();
+}
+
+void SignalHandler::on_signal(int signum) {
+    if (signum == SIGHUP) {
+        std::cout << "\nReceived signal SIGHUP, reloading DBC..." << std::endl;
+        reload_requested_.store(true);
+        return;
+    }
+    std::cout << "\nReceived signal " << signal_name(signum) << " (" << signum << "), initiating graceful shutdown..." << std::endl;
     
     shutdown_requested_.store(true);
-    
-    // Call cleanup callback if set
-    if (cleanup_callback_) {
-        cleanup_callback_();
+}
+
+void SignalHandler::request_shutdown() {
+    shutdown_requested_.store(true);
+    if (event_fd_ >= 0) {
+        const uint64_t one = 1;
+        ssize_t rc = write(event_fd_, &one, sizeof(one));
+        (void)rc;
     }
 }
 
 void SignalHandler::install_handlers() {
-    // Install signal handlers for graceful shutdown
-    std::signal(SIGINT, signal_handler);   // Ctrl+C
-    std::signal(SIGTERM, signal_handler);  // Termination request
-    std::signal(SIGHUP, signal_handler);   // Hangup
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ >= 0 && event_fd_ >= 0) {
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = event_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event);
+    }
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);   // Ctrl+C
+    sigaddset(&mask, SIGTERM);  // Termination request
+    sigaddset(&mask, SIGHUP);   // Rechargement du DBC
+
+    // Signaux bloqués dans ce thread et hérités par les threads créés ensuite
+    if (pthread_sigmask(SIG_BLOCK, &mask, nullptr) == 0) {
+        signal_fd_ = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    }
+
+    if (signal_fd_ >= 0 && epoll_fd_ >= 0) {
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = signal_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, signal_fd_, &event);
+        std::cout << "Signal handlers installed (SIGINT, SIGTERM, SIGHUP via signalfd)" << std::endl;
+        return;
+    }
+
+    std::cerr << "signalfd unavailable (" << strerror(errno) << "), using classic signal handlers" << std::endl;
+    pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+    std::signal(SIGHUP, signal_handler);
     
     std::cout << "Signal handlers installed (SIGINT, SIGTERM, SIGHUP)" << std::endl;
 }
 
-void SignalHandler::set_cleanup_callback(std::function<void()> callback) {
-    cleanup_callback_ = std::move(callback);
+bool SignalHandler::wait_for_shutdown(int timeout_ms) {
+    if (shutdown_requested_.load()) {
+        return true;
+    }
+    if (epoll_fd_ < 0) {
+        // Pas d'epoll : dernier recours, attente bornée
+        usleep(static_cast<useconds_t>(timeout_ms < 0 ? 100000 : timeout_ms * 1000));
+        return shutdown_requested_.load();
+    }
+
+    struct epoll_event events[2];
+    const int count = epoll_wait(epoll_fd_, events, 2, timeout_ms);
+    for (int i = 0; i < count; ++i) {
+        if (events[i].data.fd == signal_fd_) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd_, &info, sizeof(info)) == static_cast<ssize_t>(sizeof(info))) {
+                on_signal(static_cast<int>(info.ssi_signo));
+            }
+        } else if (events[i].data.fd == event_fd_) {
+            // Le compteur reste à zéro une fois lu : shutdown_requested_ fait foi
+            uint64_t value = 0;
+            ssize_t rc = read(event_fd_, &value, sizeof(value));
+            (void)rc;
+        }
+    }
+    return shutdown_requested_.load();
 }
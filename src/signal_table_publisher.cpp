@@ -0,0 +1,123 @@
+#include "signal_table_publisher.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+
+static constexpr const char* SHM_DIRECTORY = "/dev/shm";
+
+static_assert(sizeof(can_shm_header) == 128, "can_shm_header layout changed");
+static_assert(sizeof(can_shm_entry) == 64, "can_shm_entry must fill one cache line");
+static_assert(sizeof(can_shm_name) == 128, "can_shm_name layout changed");
+
+SignalTablePublisher::~SignalTablePublisher() {
+    close();
+}
+
+bool SignalTablePublisher::create(const std::string& name, const std::vector<Entry>& entries) {
+    close();
+
+    const uint64_t entries_offset = sizeof(can_shm_header);
+    const uint64_t names_offset = entries_offset + entries.size() * sizeof(can_shm_entry);
+    const uint64_t total_size = names_offset + entries.size() * sizeof(can_shm_name);
+
+    // Nouveau segment sous un nom provisoire : le nom lu par les lecteurs
+    // reste à la table courante jusqu'à activate() (rechargement réussi)
+    const std::string staging = name + ".new";
+    shm_unlink(staging.c_str());   // reste d'un rechargement interrompu
+    const int fd = shm_open(staging.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        std::cerr << "Cannot create shared memory " << staging << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(total_size)) != 0) {
+        std::cerr << "Cannot size shared memory " << staging << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        shm_unlink(staging.c_str());
+        return false;
+    }
+    void* map = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Cannot map shared memory " << staging << ": " << strerror(errno) << std::endl;
+        shm_unlink(staging.c_str());
+        return false;
+    }
+
+    // ftruncate a mis le segment à zéro : séquences et compteurs partent de 0
+    auto* base = static_cast<uint8_t*>(map);
+    auto* names = reinterpret_cast<can_shm_name*>(base + names_offset);
+    auto* table_entries = reinterpret_cast<can_shm_entry*>(base + entries_offset);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        std::strncpy(names[i].name, entries[i].name.c_str(), CAN_SHM_NAME_SIZE - 1);
+        std::strncpy(names[i].unit, entries[i].unit.c_str(), CAN_SHM_UNIT_SIZE - 1);
+        names[i].can_id = entries[i].can_id;
+        table_entries[i].can_id = entries[i].can_id;
+    }
+
+    auto* header = reinterpret_cast<can_shm_header*>(base);
+    header->version = CAN_SHM_VERSION;
+    header->entry_count = static_cast<uint32_t>(entries.size());
+    header->entry_size = sizeof(can_shm_entry);
+    header->name_size = sizeof(can_shm_name);
+    header->writer_pid = static_cast<int32_t>(getpid());
+    header->entries_offset = entries_offset;
+    header->names_offset = names_offset;
+    header->total_size = total_size;
+    header->created_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    header->state = CAN_SHM_STATE_RUNNING;
+    // Magic en dernier : un lecteur ne valide qu'une table complète
+    __atomic_store_n(&header->magic, CAN_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    name_ = staging;
+    live_name_ = name;
+    live_ = false;
+    header_ = header;
+    entries_ = table_entries;
+    size_ = total_size;
+    std::cout << "Shared signal table " << name << ": " << entries.size() << " signals, "
+              << total_size / 1024 << " KB" << std::endl;
+    return true;
+}
+
+bool SignalTablePublisher::activate() {
+    if (!header_ || live_) {
+        return live_;
+    }
+    // Segments POSIX de glibc : fichiers de /dev/shm. rename() remplace
+    // l'ancienne table d'un coup ; ses lecteurs gardent leur mapping
+    const std::string from = std::string(SHM_DIRECTORY) + name_;
+    const std::string to = std::string(SHM_DIRECTORY) + live_name_;
+    if (std::rename(from.c_str(), to.c_str()) != 0) {
+        std::cerr << "Cannot publish shared memory " << live_name_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    name_ = live_name_;
+    live_ = true;
+    return true;
+}
+
+void SignalTablePublisher::close() {
+    if (!header_) {
+        return;
+    }
+    shm_unlink(name_.c_str());
+    retire();
+}
+
+void SignalTablePublisher::retire() {
+    if (!header_) {
+        return;
+    }
+    if (!live_) {
+        // Jamais publiée : le nom provisoire disparaît avec elle
+        shm_unlink(name_.c_str());
+    }
+    // Les lecteurs voient l'état arrêté et rouvrent le nom
+    __atomic_store_n(&header_->state, static_cast<uint32_t>(CAN_SHM_STATE_STOPPED), __ATOMIC_RELEASE);
+    munmap(header_, size_);
+    header_ = nullptr;
+    entries_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,210 @@
+#include "storage_file.h"
+#include "thread_tuning.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+StorageFile::~StorageFile() {
+    close();
+}
+
+bool StorageFile::open(const std::string& path, size_t expected_size, const StoragePolicy& policy) {
+    close();
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd_ < 0) {
+        std::cerr << "Storage: cannot open " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    path_ = path;
+    policy_ = policy;
+    preallocated_bytes_ = 0;
+    synced_offset_.store(0);
+    unsynced_bytes_ = 0;
+    bytes_since_checkpoint_ = 0;
+    stop_requested_ = false;
+    sync_requested_ = false;
+
+    // KEEP_SIZE : les extents sont réservés sans changer la taille vue par mdflib
+    if (policy_.preallocate && expected_size > 0) {
+        if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(expected_size)) == 0) {
+            preallocated_bytes_ = expected_size;
+        } else {
+            std::cerr << "Storage: fallocate of " << expected_size << " bytes failed for " << path
+                      << ": " << strerror(errno) << " (continuing without preallocation)" << std::endl;
+        }
+    }
+
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    const bool checkpoints = checkpoint_hook_ && policy_.checkpoint_interval.count() > 0;
+    if (policy_.sync_bytes > 0 || policy_.sync_interval.count() > 0 || checkpoints) {
+        sync_thread_ = std::make_unique<std::thread>(&StorageFile::sync_loop, this);
+    }
+    return true;
+}
+
+void StorageFile::notify_written(size_t bytes) {
+    if (!sync_thread_) {
+        return;
+    }
+
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        unsynced_bytes_ += bytes;
+        bytes_since_checkpoint_ += bytes;
+        if (policy_.sync_bytes > 0 && unsynced_bytes_ >= policy_.sync_bytes && !sync_requested_) {
+            sync_requested_ = true;
+            wake = true;
+        }
+    }
+    if (wake) {
+        condition_.notify_one();
+    }
+}
+
+void StorageFile::request_sync() {
+    if (!sync_thread_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sync_requested_ = true;
+    }
+    condition_.notify_one();
+}
+
+void StorageFile::sync_now() {
+    if (fd_ < 0) {
+        return;
+    }
+
+    if (fdatasync(fd_) != 0) {
+        std::cerr << "Storage: fdatasync failed for " << path_ << ": " << strerror(errno) << std::endl;
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        return;
+    }
+
+    // Les pages synchronisées sont propres : on les rend au noyau
+    const uint64_t size = static_cast<uint64_t>(st.st_size);
+    if (policy_.drop_cache && size > 0) {
+        posix_fadvise(fd_, 0, static_cast<off_t>(size), POSIX_FADV_DONTNEED);
+    }
+    synced_offset_.store(size);
+}
+
+void StorageFile::run_checkpoint() {
+    if (fd_ >= 0 && checkpoint_hook_) {
+        checkpoint_hook_(fd_);
+    }
+}
+
+void StorageFile::sync_loop() {
+    apply_thread_tuning("mf4-sync", ThreadTuning{});
+
+    using std::chrono::milliseconds;
+    const auto never = milliseconds(std::chrono::hours(24));
+    const auto sync_interval = policy_.sync_interval.count() > 0
+        ? std::chrono::duration_cast<milliseconds>(policy_.sync_interval) : never;
+    const auto checkpoint_interval = checkpoint_hook_ && policy_.checkpoint_interval.count() > 0
+        ? std::chrono::duration_cast<milliseconds>(policy_.checkpoint_interval) : never;
+    const auto interval = std::min(sync_interval, checkpoint_interval);
+    auto next_checkpoint = std::chrono::steady_clock::now() + checkpoint_interval;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_requested_) {
+        condition_.wait_for(lock, interval, [this] { return stop_requested_ || sync_requested_; });
+        if (stop_requested_) {
+            break;
+        }
+
+        // Checkpoint puis fdatasync : les longueurs patchées et les données sont durables ensemble
+        const auto now = std::chrono::steady_clock::now();
+        const bool checkpoint_due = now >= next_checkpoint && bytes_since_checkpoint_ > 0;
+        if (now >= next_checkpoint) {
+            next_checkpoint = now + checkpoint_interval;
+        }
+
+        const bool has_data = unsynced_bytes_ > 0 || sync_requested_ || checkpoint_due;
+        sync_requested_ = false;
+        unsynced_bytes_ = 0;
+        if (checkpoint_due) {
+            bytes_since_checkpoint_ = 0;
+        }
+        if (!has_data) {
+            continue;
+        }
+
+        lock.unlock();
+        if (checkpoint_due) {
+            run_checkpoint();
+        }
+        sync_now();
+        lock.lock();
+    }
+}
+
+void StorageFile::stop_sync_thread() {
+    if (sync_thread_) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_requested_ = true;
+        }
+        condition_.notify_one();
+        if (sync_thread_->joinable()) {
+            sync_thread_->join();
+        }
+        sync_thread_.reset();
+    }
+}
+
+void StorageFile::quiesce() {
+    if (!sync_thread_) {
+        return;
+    }
+    stop_sync_thread();
+
+    // Dernier point de reprise si la finalisation par mdflib est interrompue
+    if (policy_.checkpoint_interval.count() > 0 && checkpoint_hook_) {
+        run_checkpoint();
+        sync_now();
+    }
+}
+
+void StorageFile::close() {
+    stop_sync_thread();
+
+    if (fd_ < 0) {
+        return;
+    }
+
+    sync_now();
+
+    // Libère la préallocation au-delà de la taille réelle du fichier
+    struct stat st;
+    if (preallocated_bytes_ > 0 && fstat(fd_, &st) == 0) {
+        if (static_cast<size_t>(st.st_size) < preallocated_bytes_) {
+            fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, st.st_size,
+                      static_cast<off_t>(preallocated_bytes_) - st.st_size);
+        }
+        if (ftruncate(fd_, st.st_size) != 0) {
+            std::cerr << "Storage: cannot truncate " << path_ << ": " << strerror(errno) << std::endl;
+        } else {
+            fdatasync(fd_);
+        }
+    }
+
+    ::close(fd_);
+    fd_ = -1;
+    preallocated_bytes_ = 0;
+}
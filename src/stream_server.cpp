@@ -0,0 +1,540 @@
+#include "stream_server.h"
+#include "thread_tuning.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace {
+
+constexpr uint8_t STREAM_CATALOG = 1;
+constexpr uint8_t STREAM_BATCH = 2;
+constexpr uint8_t STREAM_SUBSCRIBE = 1;
+
+constexpr size_t BATCH_HEADER_SIZE = 4 + 1 + 8 + 4 + 4;
+constexpr size_t RECORD_SIZE = 4 + 4 + 8;
+constexpr uint32_t MAX_BATCH_RECORDS = 65536;
+constexpr size_t FLUSH_BYTES = 16 * 1024;             // envoi sans attendre l'échéance
+constexpr size_t MAX_CLIENT_MESSAGE = 1024 * 1024;
+
+void put_u8(std::vector<uint8_t>& out, uint8_t value) {
+    out.push_back(value);
+}
+
+void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void store_u32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void store_u64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void put_f64(std::vector<uint8_t>& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const size_t offset = out.size();
+    out.resize(offset + 8);
+    store_u64(out.data() + offset, bits);
+}
+
+uint32_t load_u32(const uint8_t* in) {
+    return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8)
+         | (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+}
+
+void put_string(std::vector<uint8_t>& out, const std::string& text) {
+    const size_t length = std::min<size_t>(text.size(), 255);
+    put_u8(out, static_cast<uint8_t>(length));
+    out.insert(out.end(), text.begin(), text.begin() + static_cast<std::ptrdiff_t>(length));
+}
+
+}  // namespace
+
+StreamServer::StreamServer(const StreamSettings& settings)
+    : settings_(settings) {
+}
+
+StreamServer::~StreamServer() {
+    stop();
+}
+
+bool StreamServer::start(const std::vector<SignalTablePublisher::Entry>& catalog) {
+    if (thread_) {
+        return true;
+    }
+    catalog_ = catalog;
+
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (settings_.socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Stream socket path too long: " << settings_.socket_path << std::endl;
+        return false;
+    }
+    std::strncpy(addr.sun_path, settings_.socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    auto fail = [&](const char* what) {
+        std::cerr << "Stream server: " << what << ": " << strerror(errno) << std::endl;
+        for (int* fd : {&listen_fd_, &epoll_fd_, &wake_fd_}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        return false;
+    };
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        return fail("cannot create socket");
+    }
+    // Socket laissée par une instance précédente
+    unlink(settings_.socket_path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        return fail(("cannot bind " + settings_.socket_path).c_str());
+    }
+    if (listen(listen_fd_, static_cast<int>(settings_.max_clients)) < 0) {
+        return fail("cannot listen");
+    }
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        return fail("cannot create event descriptors");
+    }
+    for (int fd : {listen_fd_, wake_fd_}) {
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            return fail("cannot register descriptor");
+        }
+    }
+
+    running_.store(true);
+    thread_ = std::make_unique<std::thread>(&StreamServer::server_loop, this);
+    std::cout << "Stream server listening on " << settings_.socket_path << " (" << catalog_.size()
+              << " signals, " << settings_.buffer_bytes / 1024 << " KB per subscriber)" << std::endl;
+    return true;
+}
+
+void StreamServer::stop() {
+    if (!thread_) {
+        return;
+    }
+    running_.store(false);
+    wake();
+    if (thread_->joinable()) {
+        thread_->join();
+    }
+    thread_.reset();
+
+    std::unique_lock<std::shared_mutex> lock(subscribers_mutex_);
+    for (const auto& subscriber : subscribers_) {
+        close(subscriber->fd);
+    }
+    subscribers_.clear();
+    has_subscribers_.store(false);
+    lock.unlock();
+
+    close(listen_fd_);
+    close(epoll_fd_);
+    close(wake_fd_);
+    listen_fd_ = epoll_fd_ = wake_fd_ = -1;
+    unlink(settings_.socket_path.c_str());
+    std::cout << "Stream server stopped" << std::endl;
+}
+
+void StreamServer::wake() {
+    const uint64_t one = 1;
+    ssize_t rc = write(wake_fd_, &one, sizeof(one));
+    (void)rc;
+}
+
+StreamServer::Batch StreamServer::make_catalog() const {
+    Batch batch;
+    put_u32(batch.bytes, 0);
+    put_u8(batch.bytes, STREAM_CATALOG);
+    put_u32(batch.bytes, static_cast<uint32_t>(catalog_.size()));
+    for (size_t i = 0; i < catalog_.size(); ++i) {
+        put_u32(batch.bytes, static_cast<uint32_t>(i));
+        put_u32(batch.bytes, catalog_[i].can_id);
+        put_string(batch.bytes, catalog_[i].name);
+        put_string(batch.bytes, catalog_[i].unit);
+    }
+    store_u32(batch.bytes.data(), static_cast<uint32_t>(batch.bytes.size() - 4));
+    return batch;
+}
+
+void StreamServer::publish(const CanMessage& message) {
+    if (!has_subscribers_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const uint64_t timestamp_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(message.timestamp.time_since_epoch()).count());
+
+    bool notify = false;
+    {
+        std::shared_lock<std::shared_mutex> lock(subscribers_mutex_);
+        for (const auto& subscriber : subscribers_) {
+            std::lock_guard<std::mutex> guard(subscriber->mutex);
+            if (!subscriber->subscribed) {
+                continue;
+            }
+            const auto& filter = subscriber->filter;
+            for (const auto& signal : message.signals) {
+                const uint32_t index = signal.signal_index;
+                if (index == UINT32_MAX || (!filter.empty() && (index >= filter.size() || !filter[index]))) {
+                    continue;
+                }
+                append_record(*subscriber, index, timestamp_ns, signal.value);
+            }
+            // Premier enregistrement du lot : le serveur arme l'échéance d'envoi
+            if (subscriber->open.records > 0 && !subscriber->wake_sent) {
+                subscriber->wake_sent = true;
+                notify = true;
+            }
+            if (subscriber->buffered >= FLUSH_BYTES && !subscriber->urgent_sent) {
+                subscriber->urgent_sent = true;
+                notify = true;
+            }
+        }
+    }
+    if (notify) {
+        wake();
+    }
+}
+
+void StreamServer::update_catalog(const std::vector<SignalTablePublisher::Entry>& catalog) {
+    if (!running_.load()) {
+        return;
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(subscribers_mutex_);
+        catalog_ = catalog;
+        const Batch message = make_catalog();
+        for (const auto& subscriber : subscribers_) {
+            std::lock_guard<std::mutex> guard(subscriber->mutex);
+            // Le lot en cours porte les anciens index : il part avant le catalogue
+            if (subscriber->open.records > 0) {
+                close_batch(*subscriber);
+            }
+            subscriber->subscribed = false;
+            subscriber->filter.clear();
+            subscriber->ready.push_back(message);
+            subscriber->buffered += message.bytes.size();
+        }
+    }
+    std::cout << "Stream server: catalog updated (" << catalog.size() << " signals), subscriptions reset" << std::endl;
+    wake();
+}
+
+void StreamServer::append_record(Subscriber& subscriber, uint32_t index, uint64_t timestamp_ns, double value) {
+    Batch& open = subscriber.open;
+    if (open.records > 0 && (timestamp_ns < subscriber.open_base_ns
+                             || timestamp_ns - subscriber.open_base_ns > UINT32_MAX
+                             || open.records >= MAX_BATCH_RECORDS)) {
+        close_batch(subscriber);
+    }
+
+    const size_t needed = RECORD_SIZE + (open.records == 0 ? BATCH_HEADER_SIZE : 0);
+    while (subscriber.buffered + needed > settings_.buffer_bytes) {
+        // Abonné trop lent : jamais d'attente côté pipeline
+        // Seuls les lots de données sont abandonnés : un catalogue perdu rendrait
+        // les index des lots suivants indéchiffrables
+        auto oldest = subscriber.policy == DropPolicy::DropOldest
+                    ? std::find_if(subscriber.ready.begin(), subscriber.ready.end(),
+                                   [](const Batch& batch) { return batch.records > 0; })
+                    : subscriber.ready.end();
+        if (oldest != subscriber.ready.end()) {
+            subscriber.dropped += oldest->records;
+            subscriber.dropped_total += oldest->records;
+            subscriber.buffered -= oldest->bytes.size();
+            subscriber.ready.erase(oldest);
+            continue;
+        }
+        ++subscriber.dropped;
+        ++subscriber.dropped_total;
+        return;
+    }
+
+    if (open.records == 0) {
+        open.bytes.clear();
+        open.bytes.reserve(std::min(settings_.buffer_bytes, FLUSH_BYTES + BATCH_HEADER_SIZE));
+        open.bytes.resize(BATCH_HEADER_SIZE);
+        subscriber.open_base_ns = timestamp_ns;
+        subscriber.open_since = std::chrono::steady_clock::now();
+    }
+    put_u32(open.bytes, index);
+    put_u32(open.bytes, static_cast<uint32_t>(timestamp_ns - subscriber.open_base_ns));
+    put_f64(open.bytes, value);
+    ++open.records;
+    subscriber.buffered += needed;
+}
+
+void StreamServer::close_batch(Subscriber& subscriber) {
+    Batch& open = subscriber.open;
+    if (open.records == 0) {
+        return;
+    }
+    uint8_t* header = open.bytes.data();
+    store_u32(header, static_cast<uint32_t>(open.bytes.size() - 4));
+    header[4] = STREAM_BATCH;
+    store_u64(header + 5, subscriber.open_base_ns);
+    store_u32(header + 13, subscriber.dropped);
+    store_u32(header + 17, open.records);
+    subscriber.dropped = 0;
+
+    subscriber.ready.push_back(std::move(open));
+    open = Batch{};
+    subscriber.wake_sent = false;
+    subscriber.urgent_sent = false;
+}
+
+void StreamServer::server_loop() {
+    apply_thread_tuning("stream-server", ThreadTuning{});
+    struct epoll_event events[16];
+
+    while (running_.load()) {
+        // Échéance du lot ouvert le plus ancien, sinon attente sans limite
+        int timeout_ms = -1;
+        const auto now = std::chrono::steady_clock::now();
+        for (const auto& subscriber : subscribers_) {
+            std::lock_guard<std::mutex> guard(subscriber->mutex);
+            if (subscriber->open.records == 0) {
+                continue;
+            }
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                subscriber->open_since + settings_.flush_interval - now).count();
+            const int wait = static_cast<int>(std::max<int64_t>(0, remaining));
+            timeout_ms = timeout_ms < 0 ? wait : std::min(timeout_ms, wait);
+        }
+
+        const int count = epoll_wait(epoll_fd_, events, 16, timeout_ms);
+        if (count < 0 && errno != EINTR) {
+            std::cerr << "Stream server epoll error: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                uint64_t value = 0;
+                ssize_t rc = read(wake_fd_, &value, sizeof(value));
+                (void)rc;
+                continue;
+            }
+            if (fd == listen_fd_) {
+                accept_client();
+                continue;
+            }
+
+            // Seul ce thread modifie la liste : lecture sans verrou
+            auto it = std::find_if(subscribers_.begin(), subscribers_.end(),
+                                   [fd](const std::shared_ptr<Subscriber>& subscriber) { return subscriber->fd == fd; });
+            if (it == subscribers_.end()) {
+                continue;
+            }
+            const auto subscriber = *it;
+            if ((events[i].events & EPOLLIN) && !read_client(*subscriber)) {
+                remove_client(subscriber);
+            } else if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+                remove_client(subscriber);
+            }
+        }
+
+        // Ferme les lots arrivés à échéance (ou assez gros) et envoie ce qui peut l'être
+        const auto flush_time = std::chrono::steady_clock::now();
+        const auto subscribers = subscribers_;
+        for (const auto& subscriber : subscribers) {
+            {
+                std::lock_guard<std::mutex> guard(subscriber->mutex);
+                if (subscriber->open.records > 0
+                    && (flush_time >= subscriber->open_since + settings_.flush_interval
+                        || subscriber->buffered >= FLUSH_BYTES)) {
+                    close_batch(*subscriber);
+                }
+            }
+            if (!send_pending(*subscriber)) {
+                remove_client(subscriber);
+            }
+        }
+    }
+}
+
+void StreamServer::accept_client() {
+    while (true) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "Stream server accept error: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+        if (subscribers_.size() >= settings_.max_clients) {
+            std::cerr << "Stream server: too many clients, connection refused" << std::endl;
+            close(fd);
+            continue;
+        }
+
+        auto subscriber = std::make_shared<Subscriber>();
+        subscriber->fd = fd;
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            continue;
+        }
+
+        {
+            std::unique_lock<std::shared_mutex> lock(subscribers_mutex_);
+            Batch catalog = make_catalog();
+            subscriber->buffered = catalog.bytes.size();
+            subscriber->ready.push_back(std::move(catalog));
+            subscribers_.push_back(subscriber);
+            has_subscribers_.store(true);
+        }
+        std::cout << "Stream client connected (" << subscribers_.size() << " clients)" << std::endl;
+    }
+}
+
+void StreamServer::remove_client(const std::shared_ptr<Subscriber>& subscriber) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, subscriber->fd, nullptr);
+    close(subscriber->fd);
+    {
+        std::unique_lock<std::shared_mutex> lock(subscribers_mutex_);
+        subscribers_.erase(std::remove(subscribers_.begin(), subscribers_.end(), subscriber), subscribers_.end());
+        has_subscribers_.store(!subscribers_.empty());
+    }
+    std::lock_guard<std::mutex> guard(subscriber->mutex);
+    std::cout << "Stream client disconnected (" << subscriber->dropped_total << " samples dropped)" << std::endl;
+}
+
+bool StreamServer::read_client(Subscriber& subscriber) {
+    uint8_t buffer[4096];
+    while (true) {
+        const ssize_t count = read(subscriber.fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            subscriber.inbox.insert(subscriber.inbox.end(), buffer, buffer + count);
+            continue;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        return false;  // fin de connexion ou erreur
+    }
+
+    size_t offset = 0;
+    while (subscriber.inbox.size() - offset >= 5) {
+        const uint32_t length = load_u32(subscriber.inbox.data() + offset);
+        if (length == 0 || length > MAX_CLIENT_MESSAGE) {
+            std::cerr << "Stream client sent an invalid message, disconnecting" << std::endl;
+            return false;
+        }
+        if (subscriber.inbox.size() - offset < 4 + static_cast<size_t>(length)) {
+            break;
+        }
+        const uint8_t* message = subscriber.inbox.data() + offset + 4;
+        handle_message(subscriber, message[0], message + 1, length - 1);
+        offset += 4 + length;
+    }
+    subscriber.inbox.erase(subscriber.inbox.begin(), subscriber.inbox.begin() + static_cast<std::ptrdiff_t>(offset));
+    return true;
+}
+
+void StreamServer::handle_message(Subscriber& subscriber, uint8_t type, const uint8_t* payload, size_t size) {
+    if (type != STREAM_SUBSCRIBE || size < 5) {
+        return;  // types inconnus ignorés
+    }
+    const DropPolicy policy = payload[0] == static_cast<uint8_t>(DropPolicy::DropOldest)
+                            ? DropPolicy::DropOldest : DropPolicy::DropNewest;
+    const uint32_t count = load_u32(payload + 1);
+    // Comparaison sans multiplication : 5 + count * 4 déborde sur size_t 32 bits (ARM)
+    if (count > (size - 5) / 4) {
+        return;
+    }
+
+    std::vector<bool> filter;
+    if (count > 0) {
+        std::shared_lock<std::shared_mutex> lock(subscribers_mutex_);
+        filter.assign(catalog_.size(), false);
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t index = load_u32(payload + 5 + 4 * i);
+            if (index < filter.size()) {
+                filter[index] = true;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(subscriber.mutex);
+    subscriber.subscribed = true;
+    subscriber.policy = policy;
+    subscriber.filter = std::move(filter);
+    std::cout << "Stream client subscribed to " << (count > 0 ? std::to_string(count) : std::string("all"))
+              << " signals (" << (policy == DropPolicy::DropOldest ? "drop oldest" : "drop newest") << ")" << std::endl;
+}
+
+bool StreamServer::send_pending(Subscriber& subscriber) {
+    while (true) {
+        if (subscriber.sent == subscriber.sending.bytes.size()) {
+            std::lock_guard<std::mutex> guard(subscriber.mutex);
+            if (subscriber.ready.empty()) {
+                break;
+            }
+            subscriber.sending = std::move(subscriber.ready.front());
+            subscriber.ready.pop_front();
+            subscriber.buffered -= subscriber.sending.bytes.size();
+            subscriber.sent = 0;
+        }
+
+        const ssize_t count = send(subscriber.fd, subscriber.sending.bytes.data() + subscriber.sent,
+                                   subscriber.sending.bytes.size() - subscriber.sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (count > 0) {
+            subscriber.sent += static_cast<size_t>(count);
+            continue;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            set_write_interest(subscriber, true);
+            return true;
+        }
+        return false;
+    }
+    set_write_interest(subscriber, false);
+    return true;
+}
+
+void StreamServer::set_write_interest(Subscriber& subscriber, bool enabled) {
+    if (subscriber.want_write == enabled) {
+        return;
+    }
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN | EPOLLRDHUP | (enabled ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    event.data.fd = subscriber.fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, subscriber.fd, &event);
+    subscriber.want_write = enabled;
+}
@@ -0,0 +1,246 @@
+#include "thread_tuning.h"
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <pthread.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+namespace {
+
+constexpr size_t STACK_PREFAULT_BYTES = 256 * 1024;
+
+// linux/ioprio.h n'est pas exporté par toutes les toolchains
+constexpr int IOPRIO_WHO_PROCESS = 1;
+constexpr int IOPRIO_CLASS_IDLE = 3;
+constexpr int IOPRIO_CLASS_SHIFT = 13;
+
+const char* policy_name(int policy) {
+    switch (policy) {
+        case SCHED_FIFO: return "fifo";
+        case SCHED_RR: return "rr";
+        default: return "other";
+    }
+}
+
+// Touche la pile pour éviter les défauts de page sur le chemin critique
+void prefault_stack() {
+    volatile unsigned char buffer[STACK_PREFAULT_BYTES];
+    for (size_t i = 0; i < sizeof(buffer); i += 4096) {
+        buffer[i] = 0;
+    }
+}
+
+// Entier décimal occupant toute la chaîne ("2x" refusé)
+bool parse_int(const std::string& text, int& value) {
+    try {
+        size_t pos = 0;
+        value = std::stoi(text, &pos);
+        return pos == text.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool valid_cpu(int cpu) {
+    return cpu >= 0 && cpu < CPU_SETSIZE;
+}
+
+bool parse_cpu_list(const std::string& text, std::vector<int>& cpus) {
+    cpus.clear();
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (item.empty()) {
+            return false;
+        }
+        const auto dash = item.find('-');
+        if (dash == std::string::npos) {
+            int cpu = 0;
+            if (!parse_int(item, cpu) || !valid_cpu(cpu)) {
+                return false;
+            }
+            cpus.push_back(cpu);
+            continue;
+        }
+        // Bornes vérifiées avant l'expansion de la plage
+        int first = 0;
+        int last = 0;
+        if (!parse_int(item.substr(0, dash), first) || !parse_int(item.substr(dash + 1), last)
+            || !valid_cpu(first) || !valid_cpu(last) || first > last) {
+            return false;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return !cpus.empty();
+}
+
+}  // namespace
+
+std::string ThreadTuning::describe() const {
+    std::ostringstream oss;
+    oss << "policy=" << policy_name(policy);
+    if (policy != SCHED_OTHER) {
+        oss << " priority=" << priority;
+    }
+    if (!cpus.empty()) {
+        oss << " cpus=";
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            oss << (i ? "," : "") << cpus[i];
+        }
+    }
+    return oss.str();
+}
+
+bool parse_sched_spec(const std::string& spec, std::string& stage, ThreadTuning& tuning, std::string& error) {
+    const auto first = spec.find(':');
+    if (first == std::string::npos) {
+        error = "expected STAGE:POLICY[:PRIO]";
+        return false;
+    }
+    stage = spec.substr(0, first);
+
+    const auto second = spec.find(':', first + 1);
+    const std::string policy = spec.substr(first + 1, second == std::string::npos ? std::string::npos : second - first - 1);
+
+    if (policy == "other") {
+        tuning.policy = SCHED_OTHER;
+        tuning.priority = 0;
+        return true;
+    }
+    if (policy == "fifo") {
+        tuning.policy = SCHED_FIFO;
+    } else if (policy == "rr") {
+        tuning.policy = SCHED_RR;
+    } else {
+        error = "unknown policy '" + policy + "' (expected other, fifo or rr)";
+        return false;
+    }
+
+    if (second == std::string::npos) {
+        error = "priority required for policy " + policy;
+        return false;
+    }
+
+    int priority = 0;
+    if (!parse_int(spec.substr(second + 1), priority)) {
+        error = "invalid priority";
+        return false;
+    }
+    const int min_priority = sched_get_priority_min(tuning.policy);
+    const int max_priority = sched_get_priority_max(tuning.policy);
+    if (priority < min_priority || priority > max_priority) {
+        std::ostringstream oss;
+        oss << "priority must be in [" << min_priority << ", " << max_priority << "]";
+        error = oss.str();
+        return false;
+    }
+    tuning.priority = priority;
+    return true;
+}
+
+bool parse_affinity_spec(const std::string& spec, std::string& stage, ThreadTuning& tuning, std::string& error) {
+    const auto colon = spec.find(':');
+    if (colon == std::string::npos) {
+        error = "expected STAGE:CPULIST";
+        return false;
+    }
+    stage = spec.substr(0, colon);
+    if (!parse_cpu_list(spec.substr(colon + 1), tuning.cpus)) {
+        error = "invalid CPU list '" + spec.substr(colon + 1) + "'";
+        return false;
+    }
+    return true;
+}
+
+void apply_thread_tuning(const std::string& thread_name, const ThreadTuning& tuning) {
+    // Nom visible dans top -H / perf (15 caractères max)
+    pthread_setname_np(pthread_self(), thread_name.substr(0, 15).c_str());
+
+    if (!tuning.cpus.empty()) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (int cpu : tuning.cpus) {
+            CPU_SET(cpu, &cpu_set);
+        }
+        const int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (rc != 0) {
+            std::cerr << "⚠️  " << thread_name << ": cannot set CPU affinity (" << tuning.describe()
+                      << "): " << strerror(rc) << std::endl;
+        }
+    }
+
+    if (tuning.policy != SCHED_OTHER) {
+        struct sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = tuning.priority;
+        const int rc = pthread_setschedparam(pthread_self(), tuning.policy, &param);
+        if (rc == EPERM) {
+            std::cerr << "⚠️  " << thread_name << ": insufficient privileges for " << policy_name(tuning.policy)
+                      << " priority " << tuning.priority
+                      << " (needs root, CAP_SYS_NICE or RLIMIT_RTPRIO), running with SCHED_OTHER" << std::endl;
+        } else if (rc != 0) {
+            std::cerr << "⚠️  " << thread_name << ": cannot set scheduling policy: " << strerror(rc) << std::endl;
+        }
+    }
+
+    if (tuning.prefault_stack) {
+        prefault_stack();
+    }
+
+    if (!tuning.is_default()) {
+        std::cout << "Thread " << thread_name << " tuned: " << tuning.describe() << std::endl;
+    }
+}
+
+void apply_background_priority(const std::string& thread_name) {
+    pthread_setname_np(pthread_self(), thread_name.substr(0, 15).c_str());
+
+    // Sous Linux, nice et ioprio s'appliquent au thread désigné par son TID
+    const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    if (setpriority(PRIO_PROCESS, tid, 19) != 0) {
+        std::cerr << "⚠️  " << thread_name << ": cannot lower priority: " << strerror(errno) << std::endl;
+    }
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, static_cast<int>(tid),
+                IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0) {
+        std::cerr << "⚠️  " << thread_name << ": cannot set idle I/O class: " << strerror(errno) << std::endl;
+    }
+}
+
+bool lock_process_memory(size_t prefault_bytes) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        const int err = errno;
+        if (err == EPERM || err == ENOMEM) {
+            std::cerr << "⚠️  mlockall failed: " << strerror(err)
+                      << " (needs root, CAP_IPC_LOCK or a larger RLIMIT_MEMLOCK), memory is not locked" << std::endl;
+        } else {
+            std::cerr << "⚠️  mlockall failed: " << strerror(err) << std::endl;
+        }
+        return false;
+    }
+
+    // La mémoire libérée reste dans le tas (verrouillé) au lieu d'être rendue au noyau
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    if (prefault_bytes > 0) {
+        auto* buffer = static_cast<unsigned char*>(std::malloc(prefault_bytes));
+        if (buffer) {
+            const long page_size = sysconf(_SC_PAGESIZE);
+            for (size_t i = 0; i < prefault_bytes; i += static_cast<size_t>(page_size)) {
+                buffer[i] = 0;
+            }
+            std::free(buffer);
+        }
+    }
+
+    std::cout << "Process memory locked (" << prefault_bytes / (1024 * 1024) << " MB heap prefaulted)" << std::endl;
+    return true;
+}
@@ -0,0 +1,441 @@
+#include "transport_reader.h"
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <dbcppp/Network.h>
+#include "signal_handler.h"
+
+// Les en-têtes du noyau de la chaîne croisée peuvent précéder J1939 (5.4) ou ISO-TP (5.10)
+#if __has_include(<linux/can/j1939.h>)
+#include <linux/can/j1939.h>
+#define HAVE_CAN_J1939 1
+#endif
+#if __has_include(<linux/can/isotp.h>)
+#include <linux/can/isotp.h>
+#define HAVE_CAN_ISOTP 1
+#endif
+
+static constexpr int READ_BATCH_PAYLOADS = 64;
+static constexpr size_t J1939_TP_MAX_SIZE = 1785;    // 255 paquets de 7 octets
+static constexpr size_t ISOTP_MAX_SIZE = 4095;       // champ de longueur de 12 bits
+static constexpr size_t SPARE_BUFFERS = 16;
+
+const TransportChannel TRANSPORT_CHANNELS[TRANSPORT_CHANNEL_COUNT] = {
+    {"TP_Length", "B", "Payload bytes reassembled by the kernel"},
+    {"TP_SourceAddress", "", "J1939 source address of the sender"},
+    {"TP_DestinationAddress", "", "J1939 destination address (255 = global, BAM)"},
+};
+
+bool parse_transport_protocol(const std::string& name, TransportProtocol& protocol) {
+    if (name == "j1939") {
+        protocol = TransportProtocol::J1939;
+        return true;
+    }
+    if (name == "isotp") {
+        protocol = TransportProtocol::IsoTp;
+        return true;
+    }
+    return false;
+}
+
+const char* transport_protocol_name(TransportProtocol protocol) {
+    switch (protocol) {
+        case TransportProtocol::J1939: return "J1939";
+        case TransportProtocol::IsoTp: return "ISO-TP";
+        default: return "none";
+    }
+}
+
+bool is_transport_message(const dbcppp::IMessage& message, TransportProtocol protocol) {
+    if (protocol == TransportProtocol::None || message.MessageSize() <= 8) {
+        return false;
+    }
+    return protocol != TransportProtocol::J1939 || (static_cast<uint32_t>(message.Id()) & CAN_EFF_FLAG);
+}
+
+uint32_t transport_key(uint32_t can_id, TransportProtocol protocol) {
+    return protocol == TransportProtocol::J1939 ? j1939_pgn(can_id) : can_id;
+}
+
+bool TransportInbox::push(uint32_t key, uint8_t source_address, uint8_t destination_address,
+                          const uint8_t* bytes, size_t length, size_t padded_size,
+                          std::chrono::steady_clock::time_point timestamp, uint64_t& sequence) {
+    std::vector<uint8_t> data;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.size() >= MAX_PENDING) {
+            ++dropped_;
+            return false;
+        }
+        if (!spare_.empty()) {
+            data = std::move(spare_.back());
+            spare_.pop_back();
+        }
+    }
+
+    // Copie hors verrou : le décodeur n'attend pas le reader
+    data.assign(padded_size, 0);
+    std::memcpy(data.data(), bytes, length);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.emplace_back();
+    TransportPayload& payload = pending_.back();
+    payload.sequence = sequence = next_sequence_++;
+    payload.key = key;
+    payload.source_address = source_address;
+    payload.destination_address = destination_address;
+    payload.length = length;
+    payload.data = std::move(data);
+    payload.timestamp = timestamp;
+    return true;
+}
+
+bool TransportInbox::take(uint64_t sequence, TransportPayload& payload) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto recycle = [this](std::vector<uint8_t>& data) {
+        if (data.capacity() > 0 && spare_.size() < SPARE_BUFFERS) {
+            spare_.push_back(std::move(data));
+        }
+    };
+    // Charges dont la pseudo-trame a été écartée (échéance d'arrêt)
+    while (!pending_.empty() && pending_.front().sequence < sequence) {
+        recycle(pending_.front().data);
+        pending_.pop_front();
+    }
+    if (pending_.empty() || pending_.front().sequence != sequence) {
+        return false;
+    }
+    recycle(payload.data);
+    payload = std::move(pending_.front());
+    pending_.pop_front();
+    return true;
+}
+
+uint64_t TransportInbox::dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+}
+
+TransportReader::TransportReader(const std::string& interface, TransportProtocol protocol, TransportInbox* inbox)
+    : interface_name_(interface)
+    , protocol_(protocol)
+    , running_(false)
+    , inbox_(inbox) {
+}
+
+TransportReader::~TransportReader() {
+    stop();
+}
+
+bool TransportReader::open_j1939_socket(int ifindex) {
+#ifdef HAVE_CAN_J1939
+    const int fd = socket(PF_CAN, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_J1939);
+    if (fd < 0) {
+        std::cerr << "Error creating J1939 socket (can-j1939 module loaded?): " << strerror(errno) << std::endl;
+        return false;
+    }
+    socket_fds_.push_back(fd);
+
+    // Écoute de tout le trafic, pas seulement celui adressé à ce nœud
+    const int enable = 1;
+    if (setsockopt(fd, SOL_CAN_J1939, SO_J1939_PROMISC, &enable, sizeof(enable)) < 0) {
+        std::cerr << "Error enabling J1939 promiscuous mode: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Le noyau ne remonte que les PGN du DBC, y compris leurs envois en une trame
+    if (flows_.size() <= J1939_FILTER_MAX) {
+        std::vector<struct j1939_filter> filters(flows_.size());
+        for (size_t i = 0; i < flows_.size(); ++i) {
+            std::memset(&filters[i], 0, sizeof(filters[i]));
+            filters[i].pgn = flows_[i].key;
+            filters[i].pgn_mask = J1939_PGN_MAX;
+        }
+        if (setsockopt(fd, SOL_CAN_J1939, SO_J1939_FILTER, filters.data(),
+                       static_cast<socklen_t>(filters.size() * sizeof(struct j1939_filter))) < 0) {
+            std::cerr << "Error setting SO_J1939_FILTER: " << strerror(errno) << std::endl;
+            return false;
+        }
+    } else {
+        std::cerr << "Warning: " << flows_.size() << " transport PGNs exceed J1939_FILTER_MAX ("
+                  << J1939_FILTER_MAX << "), kernel PGN filtering disabled" << std::endl;
+    }
+
+    struct sockaddr_can addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ifindex;
+    addr.can_addr.j1939.name = J1939_NO_NAME;
+    addr.can_addr.j1939.pgn = J1939_NO_PGN;
+    addr.can_addr.j1939.addr = J1939_NO_ADDR;
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "Error binding J1939 socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+    socket_flows_.push_back(0);
+    return true;
+#else
+    (void)ifindex;
+    std::cerr << "J1939 sockets are not supported by this build (kernel headers without linux/can/j1939.h)" << std::endl;
+    return false;
+#endif
+}
+
+bool TransportReader::open_isotp_sockets(int ifindex) {
+#ifdef HAVE_CAN_ISOTP
+    for (size_t i = 0; i < flows_.size(); ++i) {
+        const int fd = socket(PF_CAN, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_ISOTP);
+        if (fd < 0) {
+            std::cerr << "Error creating ISO-TP socket (can-isotp module loaded?): " << strerror(errno) << std::endl;
+            return false;
+        }
+        socket_fds_.push_back(fd);
+
+        // Écoute seule : les trames de contrôle de flux restent celles du vrai destinataire
+        struct can_isotp_options options;
+        std::memset(&options, 0, sizeof(options));
+        options.flags = CAN_ISOTP_LISTEN_MODE;
+        if (setsockopt(fd, SOL_CAN_ISOTP, CAN_ISOTP_OPTS, &options, sizeof(options)) < 0) {
+            std::cerr << "Error setting ISO-TP listen mode: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        // tx_id n'est jamais émis en écoute, le noyau exige seulement qu'il diffère de rx_id
+        struct sockaddr_can addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.can_family = AF_CAN;
+        addr.can_ifindex = ifindex;
+        addr.can_addr.tp.rx_id = flows_[i].can_id;
+        addr.can_addr.tp.tx_id = flows_[i].can_id ^ 0x1;
+        if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+            std::cerr << "Error binding ISO-TP socket for " << flows_[i].name << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        socket_flows_.push_back(i);
+    }
+    return true;
+#else
+    (void)ifindex;
+    std::cerr << "ISO-TP sockets are not supported by this build (kernel headers without linux/can/isotp.h)" << std::endl;
+    return false;
+#endif
+}
+
+void TransportReader::close_sockets() {
+    for (int fd : socket_fds_) {
+        close(fd);
+    }
+    socket_fds_.clear();
+    socket_flows_.clear();
+    if (epoll_fd_ >= 0) {
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+    if (stop_fd_ >= 0) {
+        close(stop_fd_);
+        stop_fd_ = -1;
+    }
+}
+
+void TransportReader::forward(uint32_t key, uint8_t source_address, uint8_t destination_address, size_t length) {
+    const auto now = std::chrono::steady_clock::now();
+    uint64_t sequence = 0;
+    if (!inbox_->push(key, source_address, destination_address, buffer_.data(), length, padded_size_, now, sequence)) {
+        const uint64_t dropped = inbox_->dropped();
+        if ((dropped & (dropped - 1)) == 0) {
+            std::cerr << "⚠️  Transport payloads dropped, decoder behind: " << dropped << std::endl;
+        }
+        return;
+    }
+    ++received_;
+
+    // Le décodeur reprend la charge à cette position du flux
+    CanFrame marker;
+    marker.can_id = TRANSPORT_FRAME_ID;
+    marker.can_dlc = 0;
+    std::memcpy(marker.data, &sequence, sizeof(sequence));
+    marker.timestamp = now;
+    output_queue_->push(std::move(marker));
+}
+
+bool TransportReader::receive_payloads(int fd, size_t socket_index) {
+    for (int batch = 0; batch < READ_BATCH_PAYLOADS; ++batch) {
+        struct sockaddr_can peer;
+        std::memset(&peer, 0, sizeof(peer));
+        struct iovec iov;
+        iov.iov_base = buffer_.data();
+        iov.iov_len = buffer_.size();
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(uint64_t)) * 4];
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_name = &peer;
+        message.msg_namelen = sizeof(peer);
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        const ssize_t nbytes = recvmsg(fd, &message, 0);
+        if (nbytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            // Transfert interrompu côté noyau (abandon, délai) : la charge est perdue, pas le socket
+            if (errno == ECOMM || errno == EILSEQ || errno == ETIMEDOUT || errno == EBADMSG) {
+                continue;
+            }
+            std::cerr << transport_protocol_name(protocol_) << " read error: " << strerror(errno) << std::endl;
+            return false;
+        }
+        if (message.msg_flags & MSG_TRUNC) {
+            std::cerr << "⚠️  " << transport_protocol_name(protocol_) << " payload larger than "
+                      << buffer_.size() << " bytes dropped" << std::endl;
+            continue;
+        }
+
+        const size_t length = static_cast<size_t>(nbytes);
+#ifdef HAVE_CAN_J1939
+        if (protocol_ == TransportProtocol::J1939) {
+            uint8_t destination = J1939_NO_ADDR;
+            for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+                if (cmsg->cmsg_level == SOL_CAN_J1939 && cmsg->cmsg_type == SCM_J1939_DEST_ADDR) {
+                    std::memcpy(&destination, CMSG_DATA(cmsg), sizeof(destination));
+                }
+            }
+            forward(peer.can_addr.j1939.pgn, peer.can_addr.j1939.addr, destination, length);
+            continue;
+        }
+#endif
+        forward(flows_[socket_flows_[socket_index]].key, 0xFF, 0xFF, length);
+    }
+    return true;
+}
+
+void TransportReader::reader_loop() {
+    struct epoll_event events[16];
+
+    apply_thread_tuning("tp-reader", thread_tuning_);
+    std::cout << transport_protocol_name(protocol_) << " transport reader thread started" << std::endl;
+
+    bool failed = false;
+    while (running_.load() && !failed) {
+        const int count = epoll_wait(epoll_fd_, events, 16, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Transport epoll error: " << strerror(errno) << std::endl;
+            failed = true;
+            break;
+        }
+        for (int i = 0; i < count && !failed; ++i) {
+            const uint32_t index = events[i].data.u32;
+            if (index >= socket_fds_.size()) {
+                continue;  // stop_fd_ : running_ est déjà à false
+            }
+            failed = !receive_payloads(socket_fds_[index], index);
+        }
+    }
+
+    if (failed) {
+        SignalHandler::request_shutdown();
+    } else {
+        // Charges déjà réassemblées avant l'arrêt
+        for (size_t i = 0; i < socket_fds_.size(); ++i) {
+            receive_payloads(socket_fds_[i], i);
+        }
+    }
+
+    std::cout << transport_protocol_name(protocol_) << " transport reader thread stopped ("
+              << received_ << " payloads)" << std::endl;
+}
+
+bool TransportReader::start(std::shared_ptr<ThreadSafeQueue<CanFrame>> queue) {
+    if (running_.load()) {
+        std::cerr << "Transport reader already running" << std::endl;
+        return false;
+    }
+    if (!queue || !inbox_) {
+        std::cerr << "Invalid output queue provided" << std::endl;
+        return false;
+    }
+    if (flows_.empty()) {
+        std::cout << "No DBC message longer than 8 bytes for " << transport_protocol_name(protocol_)
+                  << ", transport reader not started" << std::endl;
+        return true;
+    }
+    output_queue_ = queue;
+
+    const unsigned int ifindex = if_nametoindex(interface_name_.c_str());
+    if (ifindex == 0) {
+        std::cerr << "Error getting interface index for " << interface_name_
+                  << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    size_t largest = protocol_ == TransportProtocol::J1939 ? J1939_TP_MAX_SIZE : ISOTP_MAX_SIZE;
+    for (const auto& flow : flows_) {
+        largest = std::max(largest, flow.size);
+    }
+    buffer_.assign(largest, 0);
+    padded_size_ = largest + TRANSPORT_PADDING;
+
+    const bool opened = protocol_ == TransportProtocol::J1939 ? open_j1939_socket(static_cast<int>(ifindex))
+                                                              : open_isotp_sockets(static_cast<int>(ifindex));
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (!opened || epoll_fd_ < 0 || stop_fd_ < 0) {
+        if (opened) {
+            std::cerr << "Error creating transport reader event descriptors: " << strerror(errno) << std::endl;
+        }
+        close_sockets();
+        return false;
+    }
+    for (size_t i = 0; i <= socket_fds_.size(); ++i) {
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<uint32_t>(i);   // socket_fds_.size() : stop_fd_
+        const int fd = i < socket_fds_.size() ? socket_fds_[i] : stop_fd_;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            std::cerr << "Error registering transport reader descriptor: " << strerror(errno) << std::endl;
+            close_sockets();
+            return false;
+        }
+    }
+
+    std::cout << transport_protocol_name(protocol_) << " transport sockets opened on " << interface_name_
+              << " for " << flows_.size() << " messages (up to " << largest << " bytes)" << std::endl;
+    running_.store(true);
+    reader_thread_ = std::make_unique<std::thread>(&TransportReader::reader_loop, this);
+    return true;
+}
+
+void TransportReader::stop() {
+    if (running_.load()) {
+        running_.store(false);
+
+        const uint64_t one = 1;
+        ssize_t rc = write(stop_fd_, &one, sizeof(one));
+        (void)rc;
+
+        if (reader_thread_ && reader_thread_->joinable()) {
+            reader_thread_->join();
+        }
+
+        close_sockets();
+        output_queue_.reset();
+        reader_thread_.reset();
+
+        std::cout << "Transport reader stopped" << std::endl;
+    }
+}
@@ -0,0 +1,242 @@
+#include "trigger.h"
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+struct Token {
+    enum Kind { Identifier, Number, Operator, And, Or, End, Invalid } kind = End;
+    std::string text;
+};
+
+class Tokenizer {
+private:
+    const std::string& text_;
+    size_t pos_ = 0;
+
+public:
+    explicit Tokenizer(const std::string& text) : text_(text) {}
+
+    Token next() {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+            ++pos_;
+        }
+        Token token;
+        if (pos_ >= text_.size()) {
+            return token;
+        }
+
+        const char c = text_[pos_];
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            const size_t start = pos_;
+            while (pos_ < text_.size() && (std::isalnum(static_cast<unsigned char>(text_[pos_]))
+                                           || text_[pos_] == '_' || text_[pos_] == '.')) {
+                ++pos_;
+            }
+            token.kind = Token::Identifier;
+            token.text = text_.substr(start, pos_ - start);
+            return token;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.') {
+            const char* begin = text_.c_str() + pos_;
+            char* end = nullptr;
+            std::strtod(begin, &end);
+            if (end == begin) {
+                token.kind = Token::Invalid;
+                token.text = std::string(1, c);
+                return token;
+            }
+            token.kind = Token::Number;
+            token.text = text_.substr(pos_, static_cast<size_t>(end - begin));
+            pos_ += static_cast<size_t>(end - begin);
+            return token;
+        }
+
+        const std::string two = text_.substr(pos_, 2);
+        if (two == "&&" || two == "||") {
+            token.kind = two == "&&" ? Token::And : Token::Or;
+            token.text = two;
+            pos_ += 2;
+            return token;
+        }
+        if (two == "==" || two == "!=" || two == "<=" || two == ">=") {
+            token.kind = Token::Operator;
+            token.text = two;
+            pos_ += 2;
+            return token;
+        }
+        if (c == '<' || c == '>') {
+            token.kind = Token::Operator;
+            token.text = std::string(1, c);
+            ++pos_;
+            return token;
+        }
+
+        token.kind = Token::Invalid;
+        token.text = std::string(1, c);
+        return token;
+    }
+};
+
+}  // namespace
+
+size_t TriggerEngine::slot_for(const std::string& name) {
+    SignalRef ref;
+    const auto dot = name.find('.');
+    if (dot == std::string::npos) {
+        ref.signal = name;
+    } else {
+        ref.message = name.substr(0, dot);
+        ref.signal = name.substr(dot + 1);
+    }
+
+    for (size_t i = 0; i < refs_.size(); ++i) {
+        if (refs_[i].message == ref.message && refs_[i].signal == ref.signal) {
+            return i;
+        }
+    }
+    refs_.push_back(ref);
+    values_.push_back(0.0);
+    valid_.push_back(false);
+    return refs_.size() - 1;
+}
+
+bool TriggerEngine::add_expression(const std::string& text, std::string& error) {
+    Expression expression;
+    expression.text = text;
+    expression.clauses.emplace_back();
+
+    // En cas d'erreur, les signaux ajoutés par cette expression sont retirés
+    const size_t ref_count = refs_.size();
+    auto fail = [&](const std::string& message) {
+        refs_.resize(ref_count);
+        values_.resize(ref_count);
+        valid_.resize(ref_count);
+        error = message;
+        return false;
+    };
+
+    Tokenizer tokenizer(text);
+    while (true) {
+        const Token name = tokenizer.next();
+        if (name.kind != Token::Identifier) {
+            return fail("expected signal name, got '" + name.text + "'");
+        }
+        const Token op = tokenizer.next();
+        if (op.kind != Token::Operator) {
+            return fail("expected comparison operator after '" + name.text + "'");
+        }
+        const Token value = tokenizer.next();
+        if (value.kind != Token::Number) {
+            return fail("expected number after '" + name.text + " " + op.text + "'");
+        }
+
+        Condition condition;
+        condition.slot = slot_for(name.text);
+        condition.threshold = std::strtod(value.text.c_str(), nullptr);
+        if (op.text == "==") condition.op = Op::Eq;
+        else if (op.text == "!=") condition.op = Op::Ne;
+        else if (op.text == "<") condition.op = Op::Lt;
+        else if (op.text == "<=") condition.op = Op::Le;
+        else if (op.text == ">") condition.op = Op::Gt;
+        else condition.op = Op::Ge;
+        expression.clauses.back().push_back(condition);
+
+        const Token link = tokenizer.next();
+        if (link.kind == Token::End) {
+            break;
+        }
+        if (link.kind == Token::Or) {
+            expression.clauses.emplace_back();
+        } else if (link.kind != Token::And) {
+            return fail("expected && or || instead of '" + link.text + "'");
+        }
+    }
+
+    expressions_.push_back(std::move(expression));
+    return true;
+}
+
+void TriggerEngine::bind_signal(uint32_t can_id, const std::string& message_name, const std::string& signal_name) {
+    for (size_t i = 0; i < refs_.size(); ++i) {
+        SignalRef& ref = refs_[i];
+        if (ref.signal != signal_name || (!ref.message.empty() && ref.message != message_name)) {
+            continue;
+        }
+        ref.bound = true;
+        watched_[can_id][signal_name].push_back(i);
+    }
+}
+
+std::vector<std::string> TriggerEngine::unbound_signals() const {
+    std::vector<std::string> names;
+    for (const auto& ref : refs_) {
+        if (!ref.bound) {
+            names.push_back(ref.message.empty() ? ref.signal : ref.message + "." + ref.signal);
+        }
+    }
+    return names;
+}
+
+bool TriggerEngine::evaluate(const Expression& expression) const {
+    for (const auto& clause : expression.clauses) {
+        bool all = true;
+        for (const auto& condition : clause) {
+            if (!valid_[condition.slot]) {
+                all = false;
+                break;
+            }
+            const double value = values_[condition.slot];
+            bool match = false;
+            switch (condition.op) {
+                case Op::Eq: match = value == condition.threshold; break;
+                case Op::Ne: match = value != condition.threshold; break;
+                case Op::Lt: match = value < condition.threshold; break;
+                case Op::Le: match = value <= condition.threshold; break;
+                case Op::Gt: match = value > condition.threshold; break;
+                case Op::Ge: match = value >= condition.threshold; break;
+            }
+            if (!match) {
+                all = false;
+                break;
+            }
+        }
+        if (all) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::string* TriggerEngine::update(const CanMessage& message) {
+    const auto watched = watched_.find(message.can_id);
+    if (watched == watched_.end()) {
+        return nullptr;
+    }
+
+    bool changed = false;
+    for (const auto& signal : message.signals) {
+        const auto slots = watched->second.find(signal.signal_name);
+        if (slots == watched->second.end()) {
+            continue;
+        }
+        for (size_t slot : slots->second) {
+            values_[slot] = signal.value;
+            valid_[slot] = true;
+        }
+        changed = true;
+    }
+    if (!changed) {
+        return nullptr;
+    }
+
+    const std::string* fired = nullptr;
+    for (auto& expression : expressions_) {
+        const bool state = evaluate(expression);
+        if (state && !expression.state && !fired) {
+            fired = &expression.text;
+        }
+        expression.state = state;
+    }
+    return fired;
+}
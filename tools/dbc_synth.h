@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+
+// Génération de fichiers DBC synthétiques pour decode_bench et decode_fuzz.
+// Les positions sont données dans l'ordre des bits du message, comme un
+// outil de messagerie les affiche : bit 0 = LSB de l'octet 0 en Intel,
+// MSB de l'octet 0 en Motorola.
+
+namespace dbc_synth {
+
+struct Signal {
+    std::string name;
+    uint32_t start = 0;         // Intel : LSB ; Motorola : position linéaire du MSB
+    uint32_t length = 8;
+    bool motorola = false;
+    bool is_signed = false;
+    double factor = 1.0;
+    double offset = 0.0;
+    int value_type = 0;         // SIG_VALTYPE_ : 0 entier, 1 float, 2 double
+    int mux = -1;               // -2 : switch (M), >= 0 : mN, -1 : non multiplexé
+};
+
+struct Message {
+    uint32_t can_id = 0;        // CAN_EFF_FLAG pour un identifiant étendu
+    std::string name;
+    uint32_t size = 8;
+    std::vector<Signal> signals;
+};
+
+// Position linéaire Motorola (0 = MSB de l'octet 0) -> start bit DBC (sawtooth)
+inline uint32_t motorola_start_bit(uint32_t linear) {
+    return (linear / 8) * 8 + 7 - linear % 8;
+}
+
+// Vrai si le signal tient dans un message de size octets
+inline bool fits(const Signal& signal, uint32_t size) {
+    return signal.length > 0 && signal.start + signal.length <= size * 8;
+}
+
+inline std::string to_dbc(const std::vector<Message>& messages) {
+    std::ostringstream oss;
+    oss << std::setprecision(17);
+    oss << "VERSION \"\"\n\nNS_ :\n\nBS_:\n\nBU_: ECU\n\n";
+    for (const auto& message : messages) {
+        oss << "BO_ " << message.can_id << " " << message.name << ": " << message.size << " ECU\n";
+        for (const auto& signal : message.signals) {
+            const uint32_t start = signal.motorola ? motorola_start_bit(signal.start) : signal.start;
+            oss << " SG_ " << signal.name;
+            if (signal.mux == -2) {
+                oss << " M";
+            } else if (signal.mux >= 0) {
+                oss << " m" << signal.mux;
+            }
+            oss << " : " << start << "|" << signal.length << "@" << (signal.motorola ? "0" : "1")
+                << (signal.is_signed ? "-" : "+") << " (" << signal.factor << "," << signal.offset
+                << ") [0|0] \"\" Vector__XXX\n";
+        }
+        oss << "\n";
+    }
+    for (const auto& message : messages) {
+        for (const auto& signal : message.signals) {
+            if (signal.value_type != 0) {
+                oss << "SIG_VALTYPE_ " << message.can_id << " " << signal.name << " : " << signal.value_type << ";\n";
+            }
+        }
+    }
+    return oss.str();
+}
+
+inline bool write_dbc(const std::string& path, const std::vector<Message>& messages) {
+    std::ofstream file(path, std::ios::trunc);
+    file << to_dbc(messages);
+    return static_cast<bool>(file);
+}
+
+}  // namespace dbc_synth
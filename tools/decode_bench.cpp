@@ -0,0 +1,248 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <linux/can.h>
+#include <dbcppp/Network.h>
+#include "dbc_decoder.h"
+#include "dbc_synth.h"
+
+// Micro-benchmark du chemin de décodage (DbcDecoder::decode_offline, même
+// code que le pipeline) sur des layouts synthétiques couvrant les cas du
+// décodage : ordre des octets, signe, longueurs et alignements, facteur
+// d'échelle, identifiants étendus et multiplexage. Compilé pour le PC
+// (make bench) ; ns/trame et ns/signal sur des charges aléatoires, puis
+// ns/trame du décodage par blocs de BATCH_MAX_FRAMES trames (--batch-decode),
+// "-" pour un message décodé trame par trame (multiplexé).
+
+namespace {
+
+using dbc_synth::Message;
+using dbc_synth::Signal;
+
+constexpr size_t PAYLOAD_POOL = 1024;
+
+struct Scenario {
+    std::string label;
+    uint32_t can_id;
+};
+
+Message make_message(uint32_t can_id, const std::string& name) {
+    Message message;
+    message.can_id = can_id;
+    message.name = name;
+    return message;
+}
+
+void add_signal(Message& message, uint32_t start, uint32_t length, bool motorola, bool is_signed,
+                double factor = 1.0, double offset = 0.0, int mux = -1) {
+    Signal signal;
+    signal.name = message.name + "_S" + std::to_string(message.signals.size());
+    signal.start = start;
+    signal.length = length;
+    signal.motorola = motorola;
+    signal.is_signed = is_signed;
+    signal.factor = factor;
+    signal.offset = offset;
+    signal.mux = mux;
+    message.signals.push_back(signal);
+}
+
+// Un message par cas ; signaux de 32 bits au plus pour rester sous le seuil
+// des valeurs suspectes du décodeur (journalisées, ce qui fausserait la mesure)
+std::vector<Message> build_scenarios(std::vector<Scenario>& scenarios) {
+    std::vector<Message> messages;
+    auto add = [&](Message message, const std::string& label) {
+        scenarios.push_back({label, message.can_id});
+        messages.push_back(std::move(message));
+    };
+
+    Message m = make_message(0x100, "IntelU8Aligned");
+    for (uint32_t i = 0; i < 8; ++i) add_signal(m, i * 8, 8, false, false);
+    add(m, "intel u8 aligned x8");
+
+    m = make_message(0x101, "IntelU16Scaled");
+    for (uint32_t i = 0; i < 4; ++i) add_signal(m, i * 16, 16, false, false, 0.1, -40.0);
+    add(m, "intel u16 scaled x4");
+
+    m = make_message(0x102, "IntelS12Unaligned");
+    for (uint32_t i = 0; i < 5; ++i) add_signal(m, 2 + i * 12, 12, false, true, 0.5);
+    add(m, "intel s12 unaligned x5");
+
+    m = make_message(0x103, "IntelFlags");
+    for (uint32_t i = 0; i < 32; ++i) add_signal(m, i * 2, 1, false, false);
+    add(m, "intel 1-bit flags x32");
+
+    m = make_message(0x104, "IntelU32");
+    for (uint32_t i = 0; i < 2; ++i) add_signal(m, i * 32, 32, false, false);
+    add(m, "intel u32 x2");
+
+    m = make_message(0x105, "MotorolaU16");
+    for (uint32_t i = 0; i < 4; ++i) add_signal(m, i * 16, 16, true, false);
+    add(m, "motorola u16 x4");
+
+    m = make_message(0x106, "MotorolaS13Unaligned");
+    for (uint32_t i = 0; i < 4; ++i) add_signal(m, 3 + i * 13, 13, true, true, 0.25);
+    add(m, "motorola s13 unaligned x4");
+
+    m = make_message(0x107, "MotorolaU32Scaled");
+    for (uint32_t i = 0; i < 2; ++i) add_signal(m, i * 32, 32, true, false, 0.001, 100.0);
+    add(m, "motorola u32 scaled x2");
+
+    m = make_message(CAN_EFF_FLAG | 0x18FEF100, "ExtendedMixed");
+    for (uint32_t i = 0; i < 8; ++i) add_signal(m, i * 8, 8, false, i % 2 == 1, i % 3 == 0 ? 1.0 : 0.4);
+    add(m, "extended id u8/s8 x8");
+
+    m = make_message(0x108, "Multiplexed");
+    add_signal(m, 0, 2, false, false, 1.0, 0.0, -2);
+    add_signal(m, 8, 8, false, false);
+    for (int value = 0; value < 4; ++value) {
+        for (uint32_t i = 0; i < 3; ++i) add_signal(m, 16 + i * 16, 16, false, false, 0.01, 0.0, value);
+    }
+    add(m, "multiplexed 5 of 14");
+
+    m = make_message(0x109, "Mixed");
+    add_signal(m, 0, 16, false, false, 0.05);
+    add_signal(m, 16, 12, true, true, 0.1, -50.0);
+    for (uint32_t i = 0; i < 4; ++i) add_signal(m, 32 + i, 1, false, false);
+    add_signal(m, 40, 8, false, false, 1.0, -40.0);
+    add_signal(m, 48, 16, true, false);
+    add(m, "mixed realistic x8");
+
+    return messages;
+}
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [--frames N] [--dbc FILE]\n"
+              << "Measures DbcDecoder decode cost per frame and per signal on random payloads.\n"
+              << "  --frames N   Frames decoded per message (default: 200000)\n"
+              << "  --dbc FILE   Benchmark every message of FILE instead of the built-in layouts\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t frames = 200000;
+    std::string dbc_file;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            frames = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--dbc" && i + 1 < argc) {
+            dbc_file = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+    if (frames == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<Scenario> scenarios;
+    std::string temporary_file;
+    if (dbc_file.empty()) {
+        const auto messages = build_scenarios(scenarios);
+        temporary_file = (std::filesystem::temp_directory_path() / "decode_bench.dbc").string();
+        if (!dbc_synth::write_dbc(temporary_file, messages)) {
+            std::cerr << "Cannot write " << temporary_file << std::endl;
+            return 1;
+        }
+        dbc_file = temporary_file;
+    } else {
+        std::ifstream idbc(dbc_file);
+        const auto network = dbcppp::INetwork::LoadDBCFromIs(idbc);
+        if (!network) {
+            std::cerr << "Cannot load " << dbc_file << std::endl;
+            return 1;
+        }
+        for (const auto& message : network->Messages()) {
+            scenarios.push_back({message.Name(), static_cast<uint32_t>(message.Id())});
+        }
+    }
+
+    DbcDecoder decoder(dbc_file);
+    decoder.set_batch_decode(BATCH_MAX_FRAMES);
+    const bool loaded = decoder.load_offline();
+    if (!temporary_file.empty()) {
+        std::filesystem::remove(temporary_file);
+    }
+    if (!loaded) {
+        return 1;
+    }
+
+    std::mt19937_64 random(42);
+    std::vector<CanFrame> pool(PAYLOAD_POOL);
+    CanMessage decoded;
+    for (auto& frame : pool) {
+        frame.can_dlc = 8;
+        frame.timestamp = std::chrono::steady_clock::now();
+        const uint64_t payload = random();
+        std::memcpy(frame.data, &payload, sizeof(frame.data));
+    }
+
+    std::cout << std::left << std::setw(32) << "layout" << std::right << std::setw(10) << "signals"
+              << std::setw(12) << "ns/frame" << std::setw(12) << "ns/signal" << std::setw(12) << "ns/blk-frm" << std::endl;
+    std::cout << "Block kernels: " << BatchDecodePlan::kernel_isa() << std::endl;
+
+    uint64_t total_signals = 0;
+    double total_ns = 0.0;
+    double total_block_ns = 0.0;
+    size_t block_scenarios = 0;
+    for (const auto& scenario : scenarios) {
+        for (auto& frame : pool) {
+            frame.can_id = scenario.can_id;
+        }
+        // Premier décodage hors mesure (journal de la première trame, allocations)
+        decoder.decode_offline(pool[0], decoded);
+
+        uint64_t signals = 0;
+        const auto started = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < frames; ++i) {
+            if (decoder.decode_offline(pool[i % PAYLOAD_POOL], decoded)) {
+                signals += decoded.signals.size();
+            }
+        }
+        const double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+
+        // Même charges par blocs ; PAYLOAD_POOL est un multiple de BATCH_MAX_FRAMES
+        MessageBlock block;
+        double block_ns = -1.0;
+        if (decoder.decode_block_offline(pool.data(), BATCH_MAX_FRAMES, block)) {
+            const auto block_started = std::chrono::steady_clock::now();
+            for (size_t done = 0; done < frames; done += BATCH_MAX_FRAMES) {
+                decoder.decode_block_offline(&pool[done % PAYLOAD_POOL], std::min(BATCH_MAX_FRAMES, frames - done), block);
+            }
+            block_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - block_started).count();
+            total_block_ns += block_ns;
+            ++block_scenarios;
+        }
+
+        total_signals += signals;
+        total_ns += elapsed_ns;
+        std::cout << std::left << std::setw(32) << scenario.label << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << static_cast<double>(signals) / static_cast<double>(frames)
+                  << std::setw(12) << elapsed_ns / static_cast<double>(frames)
+                  << std::setw(12) << (signals > 0 ? elapsed_ns / static_cast<double>(signals) : 0.0);
+        if (block_ns >= 0.0) {
+            std::cout << std::setw(12) << block_ns / static_cast<double>(frames) << std::endl;
+        } else {
+            std::cout << std::setw(12) << "-" << std::endl;
+        }
+    }
+
+    std::cout << std::left << std::setw(32) << "all" << std::right << std::setw(10) << "" << std::setw(12)
+              << total_ns / static_cast<double>(frames * scenarios.size())
+              << std::setw(12) << (total_signals > 0 ? total_ns / static_cast<double>(total_signals) : 0.0)
+              << std::setw(12) << (block_scenarios > 0 ? total_block_ns / static_cast<double>(frames * block_scenarios) : 0.0)
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,343 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <streambuf>
+#include <linux/can.h>
+#include <dbcppp/Network.h>
+#include "dbc_decoder.h"
+#include "dbc_synth.h"
+
+// Fuzzer différentiel du décodage : layouts DBC et charges aléatoires,
+// chaque trame est décodée par DbcDecoder::decode_offline (le chemin du
+// pipeline, y compris un éventuel décodage optimisé) et comparée bit à bit à
+// la référence dbcppp Decode/RawToPhys, avec résolution du multiplexage.
+// Les mêmes charges passent ensuite par le décodage par blocs
+// (DbcDecoder::decode_block_offline) des messages non multiplexés.
+// Le DBC d'un cas en échec est conservé pour le rejouer.
+
+namespace {
+
+using dbc_synth::Message;
+using dbc_synth::Signal;
+
+// Flux vide : le décodeur journalise les valeurs aberrantes, fréquentes ici
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct FuzzSettings {
+    uint64_t seed = 0;
+    size_t layouts = 200;
+    size_t frames = 2000;
+    std::string keep_dir = ".";
+};
+
+uint64_t pick(std::mt19937_64& random, uint64_t low, uint64_t high) {
+    return std::uniform_int_distribution<uint64_t>(low, high)(random);
+}
+
+Signal random_signal(std::mt19937_64& random, const std::string& name) {
+    Signal signal;
+    signal.name = name;
+    signal.motorola = pick(random, 0, 1) == 1;
+    signal.value_type = 0;
+
+    // Surtout des longueurs courantes, mais toutes les longueurs 1..64 sortent
+    switch (pick(random, 0, 5)) {
+        case 0: signal.length = 1; break;
+        case 1: signal.length = static_cast<uint32_t>(8 * pick(random, 1, 4)); break;
+        case 2: signal.length = 64; break;
+        default: signal.length = static_cast<uint32_t>(pick(random, 1, 64)); break;
+    }
+    if (pick(random, 0, 9) == 0 && (signal.length == 32 || signal.length == 64)) {
+        signal.value_type = signal.length == 32 ? 1 : 2;
+    }
+    signal.start = static_cast<uint32_t>(pick(random, 0, 64 - signal.length));
+    if (pick(random, 0, 3) == 0) {
+        // Aligné sur l'octet : chemins rapides éventuels
+        signal.start -= signal.start % 8;
+    }
+    signal.is_signed = signal.value_type == 0 && signal.length > 1 && pick(random, 0, 1) == 1;
+
+    if (signal.value_type == 0 && pick(random, 0, 2) != 0) {
+        static const double FACTORS[] = {0.1, 0.5, 0.01, 0.05, 0.001, 0.25, 2.0, 1e-6, 3.14159};
+        signal.factor = FACTORS[pick(random, 0, sizeof(FACTORS) / sizeof(FACTORS[0]) - 1)];
+        signal.offset = static_cast<double>(static_cast<int64_t>(pick(random, 0, 2000)) - 1000) / 4.0;
+    }
+    return signal;
+}
+
+std::vector<Message> random_layout(std::mt19937_64& random, size_t layout_index) {
+    std::vector<Message> messages;
+    const size_t message_count = pick(random, 1, 8);
+    for (size_t m = 0; m < message_count; ++m) {
+        Message message;
+        message.name = "L" + std::to_string(layout_index) + "_M" + std::to_string(m);
+        if (pick(random, 0, 3) == 0) {
+            message.can_id = CAN_EFF_FLAG | static_cast<uint32_t>(pick(random, 0x800, CAN_EFF_MASK));
+        } else {
+            message.can_id = static_cast<uint32_t>(pick(random, 0, CAN_SFF_MASK));
+        }
+        bool duplicate = false;
+        for (const auto& other : messages) {
+            duplicate = duplicate || other.can_id == message.can_id;
+        }
+        if (duplicate) {
+            continue;
+        }
+
+        // Multiplexage simple : un switch de 1 à 4 bits, signaux m0..mN
+        const bool multiplexed = pick(random, 0, 3) == 0;
+        int mux_values = 0;
+        if (multiplexed) {
+            Signal mux;
+            mux.name = message.name + "_Mux";
+            mux.length = static_cast<uint32_t>(pick(random, 1, 4));
+            mux.start = static_cast<uint32_t>(pick(random, 0, 64 - mux.length));
+            mux.motorola = pick(random, 0, 1) == 1;
+            mux.mux = -2;
+            mux_values = 1 << mux.length;
+            message.signals.push_back(mux);
+        }
+
+        const size_t signal_count = pick(random, 1, 12);
+        for (size_t s = 0; s < signal_count; ++s) {
+            Signal signal = random_signal(random, message.name + "_S" + std::to_string(s));
+            if (multiplexed && pick(random, 0, 2) != 0) {
+                // Certaines valeurs du switch restent sans signal (layout par défaut)
+                signal.mux = static_cast<int>(pick(random, 0, static_cast<uint64_t>(mux_values)));
+            }
+            message.signals.push_back(signal);
+        }
+        messages.push_back(std::move(message));
+    }
+    return messages;
+}
+
+// Signaux attendus d'après dbcppp seul : hors multiplexage, le switch et les
+// signaux mN dont N est la valeur brute du switch
+std::map<std::string, double> reference_decode(const dbcppp::IMessage& message, const uint8_t* data) {
+    std::map<std::string, double> expected;
+    const dbcppp::ISignal* mux = message.MuxSignal();
+    const uint64_t switch_value = mux ? mux->Decode(data) : 0;
+    for (const auto& signal : message.Signals()) {
+        if (signal.MultiplexerIndicator() == dbcppp::ISignal::EMultiplexer::MuxValue
+            && (!mux || signal.MultiplexerSwitchValue() != switch_value)) {
+            continue;
+        }
+        expected[signal.Name()] = signal.RawToPhys(signal.Decode(data));
+    }
+    return expected;
+}
+
+bool same_value(double a, double b) {
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+std::string hex_payload(const uint8_t* data) {
+    std::ostringstream oss;
+    for (int i = 0; i < 8; ++i) {
+        oss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(data[i]);
+    }
+    return oss.str();
+}
+
+// Retourne le nombre d'écarts pour un layout
+size_t fuzz_layout(const FuzzSettings& settings, std::mt19937_64& random, size_t layout_index,
+                   uint64_t& frames_checked, uint64_t& signals_checked) {
+    const auto messages = random_layout(random, layout_index);
+    const std::string path = (std::filesystem::temp_directory_path()
+                              / ("decode_fuzz_" + std::to_string(settings.seed) + "_" + std::to_string(layout_index) + ".dbc")).string();
+    if (!dbc_synth::write_dbc(path, messages)) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return 1;
+    }
+
+    std::ifstream idbc(path);
+    const auto reference = dbcppp::INetwork::LoadDBCFromIs(idbc);
+    if (!reference) {
+        std::cerr << "dbcppp rejected generated layout " << path << std::endl;
+        return 1;
+    }
+
+    NullBuffer null_buffer;
+    std::streambuf* const cout_buffer = std::cout.rdbuf(&null_buffer);
+    std::streambuf* const cerr_buffer = std::cerr.rdbuf(&null_buffer);
+    DbcDecoder decoder(path);
+    decoder.set_batch_decode(BATCH_MAX_FRAMES);
+    const bool loaded = decoder.load_offline();
+
+    size_t mismatches = 0;
+    std::vector<std::string> reports;
+    CanFrame frame;
+    frame.can_dlc = 8;
+    frame.timestamp = std::chrono::steady_clock::now();
+    CanMessage decoded;
+    std::vector<uint64_t> payloads;
+    for (size_t f = 0; loaded && f < settings.frames && reports.size() < 10; ++f) {
+        const uint64_t payload = random();
+        payloads.push_back(payload);
+        std::memcpy(frame.data, &payload, sizeof(frame.data));
+        for (const auto& message : reference->Messages()) {
+            frame.can_id = static_cast<uint32_t>(message.Id());
+            const auto expected = reference_decode(message, frame.data);
+            const bool has_message = decoder.decode_offline(frame, decoded);
+            ++frames_checked;
+
+            std::map<std::string, double> actual;
+            if (has_message) {
+                for (const auto& signal : decoded.signals) {
+                    actual[signal.signal_name] = signal.value;
+                }
+            }
+            signals_checked += expected.size();
+            if (actual.size() == expected.size()
+                && std::equal(actual.begin(), actual.end(), expected.begin(), [](const auto& a, const auto& b) {
+                       return a.first == b.first && same_value(a.second, b.second);
+                   })) {
+                continue;
+            }
+
+            ++mismatches;
+            std::ostringstream report;
+            report << std::setprecision(17) << "  " << message.Name() << " payload " << hex_payload(frame.data) << ":";
+            for (const auto& [name, value] : expected) {
+                auto it = actual.find(name);
+                if (it == actual.end()) {
+                    report << "\n    " << name << " missing (expected " << value << ")";
+                } else if (!same_value(it->second, value)) {
+                    report << "\n    " << name << " = " << it->second << ", expected " << value;
+                }
+            }
+            for (const auto& [name, value] : actual) {
+                if (expected.find(name) == expected.end()) {
+                    report << "\n    " << name << " = " << value << " not expected";
+                }
+            }
+            reports.push_back(report.str());
+        }
+    }
+
+    // Décodage par blocs, mêmes charges
+    std::vector<CanFrame> block_frames;
+    MessageBlock block;
+    for (const auto& message : reference->Messages()) {
+        block_frames.assign(payloads.size(), frame);
+        for (size_t f = 0; f < payloads.size(); ++f) {
+            block_frames[f].can_id = static_cast<uint32_t>(message.Id());
+            std::memcpy(block_frames[f].data, &payloads[f], sizeof(frame.data));
+        }
+        for (size_t first = 0; loaded && first < block_frames.size() && reports.size() < 10; first += BATCH_MAX_FRAMES) {
+            const size_t count = std::min(BATCH_MAX_FRAMES, block_frames.size() - first);
+            if (!decoder.decode_block_offline(&block_frames[first], count, block)) {
+                break;  // multiplexé : trame par trame seulement
+            }
+            for (size_t f = 0; f < count; ++f) {
+                const auto expected = reference_decode(message, block_frames[first + f].data);
+                ++frames_checked;
+                signals_checked += expected.size();
+                std::ostringstream report;
+                report << std::setprecision(17);
+                for (size_t s = 0; s < block.signals->size(); ++s) {
+                    const std::string& name = (*block.signals)[s].name;
+                    const double value = block.column(s)[f];
+                    auto it = expected.find(name);
+                    if (it == expected.end()) {
+                        report << "\n    " << name << " = " << value << " not expected";
+                    } else if (!same_value(value, it->second)) {
+                        report << "\n    " << name << " = " << value << ", expected " << it->second;
+                    }
+                }
+                if (block.signals->size() != expected.size()) {
+                    report << "\n    " << block.signals->size() << " signals, expected " << expected.size();
+                }
+                if (report.tellp() > 0) {
+                    ++mismatches;
+                    reports.push_back("  " + message.Name() + " payload " + hex_payload(block_frames[first + f].data)
+                                      + " (block decode):" + report.str());
+                }
+            }
+        }
+    }
+    std::cout.rdbuf(cout_buffer);
+    std::cerr.rdbuf(cerr_buffer);
+
+    if (!loaded) {
+        std::cout << "Layout " << layout_index << ": decoder rejected " << path << std::endl;
+        return 1;
+    }
+    if (mismatches == 0) {
+        std::filesystem::remove(path);
+        return 0;
+    }
+
+    const auto kept = std::filesystem::path(settings.keep_dir) / std::filesystem::path(path).filename();
+    std::error_code ec;
+    std::filesystem::copy_file(path, kept, std::filesystem::copy_options::overwrite_existing, ec);
+    std::filesystem::remove(path);
+    std::cout << "Layout " << layout_index << ": " << mismatches << " mismatching frames, DBC kept in "
+              << (ec ? path : kept.string()) << std::endl;
+    for (const auto& report : reports) {
+        std::cout << report << std::endl;
+    }
+    return mismatches;
+}
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [--seed N] [--layouts N] [--frames N] [--keep-dir DIR]\n"
+              << "Compares DbcDecoder against dbcppp Decode/RawToPhys on random DBC layouts\n"
+              << "and random payloads. Exit status 2 on any mismatch.\n"
+              << "  --seed N      Random seed (default: time based, printed)\n"
+              << "  --layouts N   Random DBC files to generate (default: 200)\n"
+              << "  --frames N    Random payloads per layout (default: 2000)\n"
+              << "  --keep-dir D  Where failing DBC files are kept (default: .)\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    FuzzSettings settings;
+    settings.seed = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) {
+            settings.seed = std::strtoull(argv[++i], nullptr, 0);
+        } else if (arg == "--layouts" && i + 1 < argc) {
+            settings.layouts = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            settings.frames = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--keep-dir" && i + 1 < argc) {
+            settings.keep_dir = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    std::cout << "Decode fuzzer, seed " << settings.seed << " (replay with --seed " << settings.seed << ")" << std::endl;
+    std::mt19937_64 random(settings.seed);
+    uint64_t frames_checked = 0;
+    uint64_t signals_checked = 0;
+    size_t failed_layouts = 0;
+    for (size_t layout = 0; layout < settings.layouts; ++layout) {
+        if (fuzz_layout(settings, random, layout, frames_checked, signals_checked) > 0) {
+            ++failed_layouts;
+        }
+    }
+
+    std::cout << settings.layouts << " layouts, " << frames_checked << " frames, " << signals_checked
+              << " signals checked: " << (failed_layouts == 0 ? "OK" : std::to_string(failed_layouts) + " layouts FAILED")
+              << std::endl;
+    return failed_layouts == 0 ? 0 : 2;
+}
@@ -0,0 +1,63 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "mf4_repair.h"
+
+// Réparation hors ligne des fichiers MF4 laissés non finalisés par une coupure
+// d'alimentation (le collecteur fait la même chose au démarrage).
+
+static void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [--dry-run] FILE|DIRECTORY...\n"
+              << "Repairs MF4 files left unfinalized by a power loss: data block length,\n"
+              << "record counters and partial trailing record.\n"
+              << "  --dry-run   Report what would be repaired without writing\n";
+}
+
+int main(int argc, char* argv[]) {
+    bool dry_run = false;
+    std::vector<std::filesystem::path> files;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--dry-run" || arg == "-n") {
+            dry_run = true;
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (std::filesystem::is_directory(arg)) {
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(arg, ec)) {
+                if (entry.is_regular_file(ec) && entry.path().extension() == ".mf4") {
+                    files.push_back(entry.path());
+                }
+            }
+        } else {
+            files.emplace_back(arg);
+        }
+    }
+
+    if (files.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    int failures = 0;
+    for (const auto& file : files) {
+        const auto result = repair_mf4_file(file.string(), dry_run);
+        const char* status = "ok";
+        if (!result.needed) {
+            // Fichier illisible ou dans un format non géré : laissé tel quel
+            status = result.message == "already finalized" ? "ok" : "skipped";
+        } else if (dry_run) {
+            status = "needs repair";
+        } else if (result.repaired) {
+            status = "repaired";
+        } else {
+            status = "FAILED";
+            ++failures;
+        }
+        std::cout << file.string() << ": " << status << " (" << result.message << ")" << std::endl;
+    }
+    return failures == 0 ? 0 : 2;
+}